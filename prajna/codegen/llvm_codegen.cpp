@@ -1,5 +1,6 @@
 #include "prajna/codegen/llvm_codegen.h"
 
+#include "llvm/Analysis/LoopInfo.h"
 #include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constant.h"
@@ -17,6 +18,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/Type.h"
@@ -27,6 +29,9 @@
 #include "llvm/Linker/Linker.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Scalar/LoopInterchange.h"
+#include "llvm/Transforms/Scalar/LoopPassManager.h"
+#include "llvm/Transforms/Scalar/LoopUnrollAndJamPass.h"
 #include "prajna/global_config.hpp"
 #include "prajna/helper.hpp"
 #include "prajna/ir/ir.hpp"
@@ -58,8 +63,42 @@ class LlvmCodegen : public prajna::ir::Visitor {
         return self;
     }
 
+    /// @brief 生成模块里用到的类型. llvm类型都属于static_llvm_context, 生成后缓存在ir类型上,
+    /// 之后的模块不会重复生成, 故codegen的开销只和模块本身相关
+    void EmitTypesUsedBy(std::shared_ptr<ir::Module> ir_module) {
+        for (auto ir_global_alloca : ir_module->global_allocas) {
+            this->EmitType(ir_global_alloca->type);
+        }
+
+        std::function<void(std::shared_ptr<ir::Block>)> emit_block_types =
+            [&](std::shared_ptr<ir::Block> ir_block) {
+                for (auto &ir_value : *ir_block) {
+                    this->EmitType(ir_value->type);
+                    if (auto ir_instruction = Cast<ir::Instruction>(ir_value)) {
+                        for (int64_t i = 0; i < ir_instruction->OperandSize(); ++i) {
+                            this->EmitType(ir_instruction->GetOperand(i)->type);
+                        }
+                    }
+                    if (auto ir_sub_block = Cast<ir::Block>(ir_value)) {
+                        emit_block_types(ir_sub_block);
+                    }
+                }
+            };
+
+        for (auto ir_function : ir_module->functions) {
+            this->EmitType(ir_function->function_type);
+            this->EmitType(ir_function->type);
+            for (auto ir_parameter : ir_function->parameters) {
+                this->EmitType(ir_parameter->type);
+            }
+            for (auto ir_block : ir_function->blocks) {
+                emit_block_types(ir_block);
+            }
+        }
+    }
+
     void EmitType(std::shared_ptr<ir::Type> ir_type) {
-        if (ir_type->llvm_type) return;
+        if (!ir_type || ir_type->llvm_type) return;
 
         // 对于不完备的类型, codegen时选择跳过
         if (auto ir_real_number_type = Cast<ir::RealNumberType>(ir_type)) {
@@ -165,7 +204,8 @@ class LlvmCodegen : public prajna::ir::Visitor {
     }
 
     void Visit(std::shared_ptr<ir::Module> ir_module) override {
-        PRAJNA_ASSERT(ir::Verify(ir_module));
+        // Transform退出时已验证过
+        PRAJNA_ASSERT(ir::Verify(ir_module, ir::VerifyLevel::pass));
 
         PRAJNA_ASSERT(!ir_module->llvm_module);
         ir_module->llvm_module = new llvm::Module(ir_module->Name(), static_llvm_context);
@@ -199,6 +239,12 @@ class LlvmCodegen : public prajna::ir::Visitor {
             }
         }
 
+        // 初始值引用了函数, 故在声明函数后再设置
+        for (auto ir_global_alloca : ir_module->global_allocas) {
+            if (ir_global_alloca->initialize_functions.empty()) continue;
+            this->EmitGlobalAllocaInitializer(ir_global_alloca);
+        }
+
         for (std::shared_ptr<ir::Function> ir_function : ir_module->functions) {
             if (!ir_function->IsDeclaration()) {
                 if (ir_target == prajna::ir::Target::host &&
@@ -211,6 +257,23 @@ class LlvmCodegen : public prajna::ir::Visitor {
         }
     }
 
+    /// @brief 由函数指针组成的常量结构体(如虚表), 生成为只读的全局变量
+    void EmitGlobalAllocaInitializer(std::shared_ptr<ir::GlobalAlloca> ir_global_alloca) {
+        PRAJNA_ASSERT(!ir_global_alloca->is_external);
+        auto llvm_global_variable =
+            static_cast<llvm::GlobalVariable *>(ir_global_alloca->llvm_value);
+        auto llvm_struct_type = llvm::cast<llvm::StructType>(llvm_global_variable->getValueType());
+        std::vector<llvm::Constant *> llvm_constants;
+        for (auto ir_function : ir_global_alloca->initialize_functions) {
+            PRAJNA_ASSERT(ir_function->llvm_value);
+            llvm_constants.push_back(static_cast<llvm::Constant *>(ir_function->llvm_value));
+        }
+        PRAJNA_ASSERT(llvm_constants.size() == llvm_struct_type->getNumElements());
+        llvm_global_variable->setInitializer(
+            llvm::ConstantStruct::get(llvm_struct_type, llvm_constants));
+        llvm_global_variable->setConstant(true);
+    }
+
     void EmitFunctionDeclaration(std::shared_ptr<ir::Function> ir_function) {
         std::string function_fullname =
             MangledNameForGpuLLVMBackend(ir_function->Fullname(), this->ir_target);
@@ -514,9 +577,34 @@ class LlvmCodegen : public prajna::ir::Visitor {
         ir_jump_branch->NextBlock()->ApplyVisitor(this->shared_from_this());
 
         PRAJNA_ASSERT(ir_jump_branch->NextBlock()->llvm_value);
-        ir_jump_branch->llvm_value = llvm::BranchInst::Create(
+        auto llvm_branch = llvm::BranchInst::Create(
             static_cast<llvm::BasicBlock *>(ir_jump_branch->NextBlock()->llvm_value),
             llvm_basic_block);
+        ir_jump_branch->llvm_value = llvm_branch;
+
+        // 标注过的循环的回边, 见MarkCanonicalLoopPass
+        if (ir_jump_branch->annotation_dict.count("canonical")) {
+            llvm_branch->setMetadata(llvm::LLVMContext::MD_loop,
+                                     this->CreateLoopMetadata(ir_jump_branch));
+        }
+    }
+
+    llvm::MDNode *CreateLoopMetadata(std::shared_ptr<ir::internal::JumpBranch> ir_jump_branch) {
+        // 第一个元素需指向自身, 先占位
+        llvm::SmallVector<llvm::Metadata *, 4> llvm_loop_properties = {nullptr};
+        llvm_loop_properties.push_back(llvm::MDNode::get(
+            static_llvm_context, llvm::MDString::get(static_llvm_context, "llvm.loop.mustprogress")));
+        llvm_loop_properties.push_back(llvm::MDNode::get(
+            static_llvm_context,
+            llvm::MDString::get(static_llvm_context, CANONICAL_LOOP_METADATA)));
+        if (ir_jump_branch->annotation_dict.count("unroll_and_jam")) {
+            llvm_loop_properties.push_back(llvm::MDNode::get(
+                static_llvm_context,
+                llvm::MDString::get(static_llvm_context, "llvm.loop.unroll_and_jam.enable")));
+        }
+        auto llvm_loop_id = llvm::MDNode::getDistinct(static_llvm_context, llvm_loop_properties);
+        llvm_loop_id->replaceOperandWith(0, llvm_loop_id);
+        return llvm_loop_id;
     }
 
     void Visit(
@@ -754,10 +842,7 @@ class LlvmCodegen : public prajna::ir::Visitor {
 std::shared_ptr<ir::Module> LlvmCodegen(std::shared_ptr<ir::Module> ir_module) {
     auto llvm_codegen = LlvmCodegen::Create(ir_module->target);
 
-    // emit type
-    for (auto type : ir::global_context.created_types) {
-        llvm_codegen->EmitType(type);
-    }
+    llvm_codegen->EmitTypesUsedBy(ir_module);
     ir_module->ApplyVisitor(llvm_codegen);
 
     for (auto ir_sub_module : ir_module->modules) {
@@ -819,6 +904,32 @@ inline void LinkNvptxLibdeviceBitcodeFiles(llvm::Module &llvm_module, llvm::LLVM
     linker.linkInModule(std::move(uq_llvm_libdevice_module));
 }
 
+/// @brief 只对MarkCanonicalLoopPass标注过的循环嵌套运行循环交换或unroll-and-jam,
+/// 而不是打开llvm全局的enable-loopinterchange/enable-unroll-and-jam选项.
+/// 两者都会先做依赖分析, 合法时才变换
+template <typename LoopNestPass_>
+class CanonicalLoopNestPass : public llvm::PassInfoMixin<CanonicalLoopNestPass<LoopNestPass_>> {
+   public:
+    explicit CanonicalLoopNestPass(LoopNestPass_ loop_nest_pass)
+        : _loop_nest_pass(std::move(loop_nest_pass)) {}
+
+    llvm::PreservedAnalyses run(llvm::LoopNest &llvm_loop_nest,
+                                llvm::LoopAnalysisManager &llvm_loop_analysis_manager,
+                                llvm::LoopStandardAnalysisResults &llvm_analysis_results,
+                                llvm::LPMUpdater &llvm_updater) {
+        if (!llvm::findOptionMDForLoop(&llvm_loop_nest.getOutermostLoop(),
+                                       CANONICAL_LOOP_METADATA)) {
+            return llvm::PreservedAnalyses::all();
+        }
+
+        return _loop_nest_pass.run(llvm_loop_nest, llvm_loop_analysis_manager,
+                                   llvm_analysis_results, llvm_updater);
+    }
+
+   private:
+    LoopNestPass_ _loop_nest_pass;
+};
+
 void GenerateLlvmPass(std::shared_ptr<ir::Module> ir_module) {
     LLVMInitializeNativeTarget();
     LLVMInitializeNativeAsmPrinter();
@@ -861,6 +972,15 @@ void GenerateLlvmPass(std::shared_ptr<ir::Module> ir_module) {
             optimization_level = llvm::OptimizationLevel::O3;
             break;
     }
+    if (optimization_level_int >= 2) {
+        // llvm默认的pipeline不包含循环交换和unroll-and-jam
+        PB.registerLoopOptimizerEndEPCallback(
+            [=](llvm::LoopPassManager &LPM, llvm::OptimizationLevel level) {
+                LPM.addPass(CanonicalLoopNestPass(llvm::LoopInterchangePass()));
+                LPM.addPass(CanonicalLoopNestPass(
+                    llvm::LoopUnrollAndJamPass(static_cast<int>(level.getSpeedupLevel()))));
+            });
+    }
     llvm::ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(optimization_level);
 
     MPM.run(*ir_module->llvm_module, MAM);
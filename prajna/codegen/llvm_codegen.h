@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 #include "llvm/IR/Module.h"
 #include "prajna/ir/ir.hpp"
@@ -11,6 +12,9 @@ class Module;
 
 namespace prajna::codegen {
 
+/// @brief MarkCanonicalLoopPass标注的循环在llvm.loop元数据里的属性名
+inline const std::string CANONICAL_LOOP_METADATA = "prajna.loop.canonical";
+
 std::shared_ptr<ir::Module> LlvmCodegen(std::shared_ptr<ir::Module> ir_modul);
 
 std::shared_ptr<ir::Module> LlvmPass(std::shared_ptr<ir::Module> ir_module);
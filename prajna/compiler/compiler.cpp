@@ -1,16 +1,23 @@
 #include "prajna/compiler/compiler.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <list>
+#include <optional>
+#include <set>
+#include <type_traits>
 
 #include "boost/algorithm/string.hpp"
 #include "prajna/assert.hpp"
 #include "prajna/codegen/llvm_codegen.h"
 #include "prajna/exception.hpp"
+#include "prajna/helper.hpp"
 #include "prajna/jit/execution_engine.h"
 #include "prajna/logger.hpp"
 #include "prajna/lowering/lower.h"
 #include "prajna/parser/parse.h"
+#include "prajna/source_manager.hpp"
 #include "prajna/transform/transform.h"
 #include "prajna/transform/utility.hpp"
 
@@ -55,6 +62,97 @@ inline std::shared_ptr<lowering::SymbolTable> CreateSymbolTableTree(
     return symbol_table_tree;
 }
 
+inline void NameModule(std::shared_ptr<ir::Module> ir_module, std::string file_name) {
+    ir_module->Name(file_name);
+    ir_module->Fullname(file_name);
+    for (auto ir_sub_module : ir_module->modules) {
+        if (ir_sub_module == nullptr) continue;
+        std::string sub_module_name =
+            ir_module->Name() + "_" + ir::TargetToString(ir_sub_module->target);
+        ir_sub_module->Name(sub_module_name);
+        ir_sub_module->Fullname(sub_module_name);
+    }
+}
+
+template <typename AstStatement_>
+constexpr bool IS_REPL_DEFINITION =
+    std::is_same_v<AstStatement_, ast::Use> || std::is_same_v<AstStatement_, ast::Module> ||
+    std::is_same_v<AstStatement_, ast::Function> || std::is_same_v<AstStatement_, ast::Struct> ||
+    std::is_same_v<AstStatement_, ast::InterfacePrototype> ||
+    std::is_same_v<AstStatement_, ast::ImplementType> ||
+    std::is_same_v<AstStatement_, ast::ImplementInterfaceForType> ||
+    std::is_same_v<AstStatement_, ast::Template> ||
+    std::is_same_v<AstStatement_, ast::TemplateStatement> ||
+    std::is_same_v<AstStatement_, ast::SpecialStatement>;
+
+/// @brief 交互模式下顶层定义所在行的源码, 表达式和变量声明等每次都需执行, 返回std::nullopt
+inline std::optional<std::string> GetReplDefinitionSource(
+    const ast::Statement& ast_statement, std::shared_ptr<SourceBuffer> source_buffer) {
+    return boost::apply_visitor(
+        [=](const auto& ast_x) -> std::optional<std::string> {
+            if constexpr (IS_REPL_DEFINITION<std::decay_t<decltype(ast_x)>>) {
+                if (ast_x.first_position.line < 1) return std::nullopt;
+
+                std::string source;
+                for (auto line = ast_x.first_position.line; line <= ast_x.last_position.line;
+                     ++line) {
+                    source.append(source_buffer->Line(line));
+                    source.push_back('\n');
+                }
+                return source;
+            } else {
+                return std::nullopt;
+            }
+        },
+        ast_statement);
+}
+
+/// @brief 交互模式下顶层定义的名字, 用于识别同一个定义的修改; 没有名字的定义返回std::nullopt
+inline std::optional<std::string> GetReplDefinitionName(const ast::Statement& ast_statement) {
+    auto get_name = [](const auto& ast_x) -> std::optional<std::string> {
+        using AstStatement = std::decay_t<decltype(ast_x)>;
+        if constexpr (std::is_same_v<AstStatement, ast::Function>) {
+            return ast_x.declaration.name;
+        } else if constexpr (std::is_same_v<AstStatement, ast::Struct> ||
+                             std::is_same_v<AstStatement, ast::InterfacePrototype> ||
+                             std::is_same_v<AstStatement, ast::Template>) {
+            return ast_x.name;
+        } else {
+            return std::nullopt;
+        }
+    };
+    if (auto ast_template_statement = boost::get<ast::TemplateStatement>(&ast_statement)) {
+        return boost::apply_visitor(get_name, ast_template_statement->statement);
+    }
+    return boost::apply_visitor(get_name, ast_statement);
+}
+
+/// @brief 核函数等涉及gpu模块的函数不支持重新定义
+inline bool IsRedefinableFunction(const ast::Function& ast_function) {
+    return std::ranges::none_of(ast_function.declaration.annotation_dict,
+                                [](const ast::Annotation& ast_annotation) {
+                                    return ast_annotation.name == "kernel" ||
+                                           ast_annotation.name == "target";
+                                });
+}
+
+/// @brief 函数引用的其他函数的全名. is_escaping_only时只返回作为值而非被直接调用的函数,
+/// 这些函数可能被保存下来在之后调用
+inline std::set<std::string> GetReferencedFunctionFullnames(
+    std::shared_ptr<ir::Function> ir_function, bool is_escaping_only) {
+    std::set<std::string> referenced_fullnames;
+    for (auto ir_instruction : transform::utility::GetAll<ir::Instruction>(ir_function)) {
+        for (int64_t i = 0; i < ir_instruction->OperandSize(); ++i) {
+            if (is_escaping_only && i == 0 && Is<ir::Call>(ir_instruction)) continue;
+            auto ir_referenced_function = Cast<ir::Function>(ir_instruction->GetOperand(i));
+            if (ir_referenced_function && ir_referenced_function != ir_function) {
+                referenced_fullnames.insert(ir_referenced_function->Fullname());
+            }
+        }
+    }
+    return referenced_fullnames;
+}
+
 }  // namespace
 
 std::shared_ptr<Compiler> Compiler::Create(bool clean_types) {
@@ -63,6 +161,7 @@ std::shared_ptr<Compiler> Compiler::Create(bool clean_types) {
     }
     std::shared_ptr<Compiler> self(new Compiler);
     self->_symbol_table = lowering::SymbolTable::Create(nullptr);
+    self->source_manager = SourceManager::Create();
     self->jit_engine = std::make_shared<jit::ExecutionEngine>();
     self->jit_engine->BindBuiltinFunction();
     return self;
@@ -76,23 +175,20 @@ void Compiler::CompileBuiltinSourceFiles(std::string builtin_sources_dir) {
 std::shared_ptr<ir::Module> Compiler::CompileCode(
     std::string code, std::shared_ptr<lowering::SymbolTable> symbol_table, std::string file_name,
     bool is_interpreter) {
-    // interpreter模式时候, lowering会直接执行函数, 故这里开始就捕获异常
-    jit_engine->CatchRuntimeError();
+    return this->CompileCode(SourceBuffer::Create(std::move(code), file_name), symbol_table,
+                             is_interpreter);
+}
 
-    this->logger = Logger::Create(code);
-    auto ast = prajna::parser::parse(code, file_name, logger);
+std::shared_ptr<ir::Module> Compiler::CompileCode(
+    std::shared_ptr<SourceBuffer> source_buffer,
+    std::shared_ptr<lowering::SymbolTable> symbol_table, bool is_interpreter) {
+    auto file_name = source_buffer->FileName();
+    this->logger = Logger::Create(source_buffer);
+    auto ast = prajna::parser::parse(source_buffer->Code(), file_name, logger);
     PRAJNA_ASSERT(ast);
     auto ir_lowering_module =
         prajna::lowering::lower(ast, symbol_table, logger, shared_from_this(), is_interpreter);
-    ir_lowering_module->Name(file_name);
-    ir_lowering_module->Fullname(file_name);
-    for (auto ir_sub_module : ir_lowering_module->modules) {
-        if (ir_sub_module == nullptr) continue;
-        std::string sub_module_name =
-            ir_lowering_module->Name() + "_" + ir::TargetToString(ir_sub_module->target);
-        ir_sub_module->Name(sub_module_name);
-        ir_sub_module->Fullname(sub_module_name);
-    }
+    NameModule(ir_lowering_module, file_name);
     auto ir_ssa_module = prajna::transform::Transform(ir_lowering_module);
     auto ir_codegen_module = prajna::codegen::LlvmCodegen(ir_ssa_module);
     auto ir_llvm_optimize_module = prajna::codegen::LlvmPass(ir_codegen_module);
@@ -117,16 +213,166 @@ void Compiler::ExecuteCodeInRelp(std::string script_code) {
     try {
         static int command_id = 0;
 
-        auto ir_module = this->CompileCode(script_code, _symbol_table,
-                                           ":cmd" + std::to_string(command_id++), true);
-        if (!ir_module) return;
+        auto source_buffer =
+            SourceBuffer::Create(std::move(script_code), ":cmd" + std::to_string(command_id++));
+        this->logger = Logger::Create(source_buffer);
+        auto ast = prajna::parser::parse(source_buffer->Code(), source_buffer->FileName(), logger);
+        PRAJNA_ASSERT(ast);
+
+        // 重新执行(如Jupyter里再次运行同一个cell)时, 和当前定义源码相同的定义直接复用之前的结果,
+        // 源码改变的函数则替换之前的定义
+        std::unordered_map<std::string, std::string> definition_sources;
+        std::list<std::string> redefined_function_names;
+        std::list<std::string> new_function_names;
+        std::list<std::string> removable_function_names;
+        std::unordered_map<std::string, lowering::Symbol> replaced_symbols;
+        if (settings.incremental_repl) {
+            struct ReplDefinition {
+                ast::Statements::iterator iter_statement;
+                std::string key;
+                std::string source;
+                bool is_unchanged;
+            };
+            std::list<ReplDefinition> repl_definitions;
+            std::set<std::string> recompiled_keys;
+            for (auto iter_statement = ast->begin(); iter_statement != ast->end();
+                 ++iter_statement) {
+                auto source_optional = GetReplDefinitionSource(*iter_statement, source_buffer);
+                if (!source_optional) continue;
+                auto key = GetReplDefinitionName(*iter_statement).value_or(*source_optional);
+                auto iter_definition_source = _repl_definition_sources.find(key);
+                bool is_unchanged = iter_definition_source != _repl_definition_sources.end() &&
+                                    iter_definition_source->second == *source_optional;
+                if (!is_unchanged) recompiled_keys.insert(key);
+                repl_definitions.push_back({iter_statement, key, *source_optional, is_unchanged});
+            }
+            // 源码未变的函数若引用了重新编译的函数, 也需重新编译, 否则仍会调用之前的定义
+            for (bool changed = true; changed;) {
+                changed = false;
+                for (auto& repl_definition : repl_definitions) {
+                    auto ast_function = boost::get<ast::Function>(&*repl_definition.iter_statement);
+                    if (!repl_definition.is_unchanged || !ast_function ||
+                        !IsRedefinableFunction(*ast_function)) {
+                        continue;
+                    }
+                    if (std::ranges::none_of(
+                            this->GetReplReferencedFunctionNames(repl_definition.key),
+                            [&](const std::string& name) { return recompiled_keys.count(name); })) {
+                        continue;
+                    }
+
+                    repl_definition.is_unchanged = false;
+                    recompiled_keys.insert(repl_definition.key);
+                    changed = true;
+                }
+            }
+
+            for (auto& repl_definition : repl_definitions) {
+                if (repl_definition.is_unchanged) {
+                    ast->erase(repl_definition.iter_statement);
+                    continue;
+                }
+
+                definition_sources[repl_definition.key] = repl_definition.source;
+                auto ast_function = boost::get<ast::Function>(&*repl_definition.iter_statement);
+                if (!ast_function) continue;
+                std::string name = ast_function->declaration.name;
+                if (!_symbol_table->CurrentTableHas(name)) {
+                    new_function_names.push_back(name);
+                    if (IsRedefinableFunction(*ast_function)) {
+                        removable_function_names.push_back(name);
+                    }
+                } else if (_repl_definition_sources.count(repl_definition.key) &&
+                           IsRedefinableFunction(*ast_function)) {
+                    replaced_symbols[name] = _symbol_table->Get(name);
+                    _symbol_table->Remove(name);
+                    redefined_function_names.push_back(name);
+                    removable_function_names.push_back(name);
+                }
+            }
+            if (ast->empty()) return;
+        }
+
+        // 编译失败时恢复被替换的函数, 并移除未完成的新函数, 以免影响之后的输入
+        bool is_compiled = false;
+        auto symbols_guard = ScopeExit::Create([&]() {
+            if (is_compiled) return;
+            for (auto name : new_function_names) {
+                _symbol_table->Remove(name);
+            }
+            for (auto [name, symbol] : replaced_symbols) {
+                _symbol_table->Set(symbol, name);
+            }
+        });
+
+        auto ir_module =
+            prajna::lowering::lower(ast, _symbol_table, logger, shared_from_this(), true);
+        NameModule(ir_module, source_buffer->FileName());
+        // 之前的定义可能仍在JIT里(已编译的调用者还在使用), 新的定义需换一个符号名
+        for (auto name : redefined_function_names) {
+            if (auto ir_function =
+                    Cast<ir::Function>(lowering::SymbolGet<ir::Value>(_symbol_table->Get(name)))) {
+                ir_function->Fullname(ir_function->Fullname() + "'" +
+                                      std::to_string(++_repl_function_version));
+            }
+        }
+        std::unordered_map<std::string, std::shared_ptr<ir::Function>> ir_removable_function_dict;
+        for (auto name : removable_function_names) {
+            auto ir_function =
+                Cast<ir::Function>(lowering::SymbolGet<ir::Value>(_symbol_table->Get(name)));
+            PRAJNA_ASSERT(ir_function);
+            ir_removable_function_dict[name] = ir_function;
+        }
+        // 内联等变换会改变引用关系, 故在变换前记录, 多记录的引用只会推迟释放.
+        // 命令执行后即被释放, 只需记录它可能保存下来的函数
+        std::unordered_map<std::string, std::set<std::string>> referenced_fullnames_dict;
+        for (auto ir_function : ir_module->functions) {
+            referenced_fullnames_dict[ir_function->Fullname()] = GetReferencedFunctionFullnames(
+                ir_function, ir_function->annotation_dict.count("\\command") > 0);
+        }
+
+        auto ir_ssa_module = prajna::transform::Transform(ir_module);
+        auto ir_codegen_module = prajna::codegen::LlvmCodegen(ir_ssa_module);
+        auto ir_llvm_optimize_module = prajna::codegen::LlvmPass(ir_codegen_module);
+        // 可重新定义的函数各自单独管理, 不再被引用时释放; 命令执行后即可释放.
+        // 其余的定义(如结构体的实现, 模板实例)不会被释放
+        std::unordered_map<std::string, std::set<std::string>> removable_resources;
+        for (auto [name, ir_function] : ir_removable_function_dict) {
+            removable_resources[ir_function->Fullname()] = {ir_function->Fullname()};
+        }
+        auto command_resource_name = ir_module->Fullname();
+        std::set<std::string> command_fullnames;
+        for (auto ir_function : ir_module->functions) {
+            if (settings.incremental_repl && ir_function->annotation_dict.count("\\command")) {
+                command_fullnames.insert(ir_function->Fullname());
+            }
+        }
+        if (!command_fullnames.empty()) {
+            removable_resources[command_resource_name] = command_fullnames;
+        }
+        jit_engine->AddIRModule(ir_llvm_optimize_module, removable_resources);
+        is_compiled = true;
 
+        for (auto [key, source] : definition_sources) {
+            _repl_definition_sources[key] = source;
+        }
+        this->UpdateReplFunctions(ir_removable_function_dict, referenced_fullnames_dict);
+        for (auto [name, symbol] : replaced_symbols) {
+            if (auto ir_function = Cast<ir::Function>(lowering::SymbolGet<ir::Value>(symbol))) {
+                this->ReleaseReplFunction(ir_function->Fullname(), false);
+            }
+        }
+
+        // 命令执行后释放, 抛出运行时错误时也需释放
+        auto command_resource_guard = ScopeExit::Create([=]() {
+            if (!command_fullnames.empty()) {
+                jit_engine->RemoveResource(command_resource_name);
+            }
+        });
         // @note 会有一次输入多个句子的情况
         for (auto ir_function : ir_module->functions) {
             if (ir_function->annotation_dict.count("\\command")) {
-                auto fun_fullname = ir_function->Fullname();
-                auto fun_ptr = reinterpret_cast<void (*)(void)>(GetSymbolValue(fun_fullname));
-                fun_ptr();
+                jit_engine->RunFunction(GetSymbolValue(ir_function->Fullname()));
             }
         }
     } catch (CompileError error) {
@@ -136,6 +382,66 @@ void Compiler::ExecuteCodeInRelp(std::string script_code) {
     }
 }
 
+std::list<std::string> Compiler::GetReplReferencedFunctionNames(const std::string& name) {
+    std::list<std::string> referenced_names;
+    auto ir_function =
+        Cast<ir::Function>(lowering::SymbolGet<ir::Value>(_symbol_table->Get(name)));
+    if (!ir_function) return referenced_names;
+    auto iter_repl_function = _repl_function_dict.find(ir_function->Fullname());
+    if (iter_repl_function == _repl_function_dict.end()) return referenced_names;
+
+    for (auto& referenced_fullname : iter_repl_function->second.referenced_fullnames) {
+        referenced_names.push_back(_repl_function_dict[referenced_fullname].name);
+    }
+    return referenced_names;
+}
+
+void Compiler::UpdateReplFunctions(
+    const std::unordered_map<std::string, std::shared_ptr<ir::Function>>&
+        ir_removable_function_dict,
+    const std::unordered_map<std::string, std::set<std::string>>& referenced_fullnames_dict) {
+    std::set<std::string> removable_fullnames;
+    for (auto [name, ir_function] : ir_removable_function_dict) {
+        _repl_function_dict[ir_function->Fullname()].name = name;
+        removable_fullnames.insert(ir_function->Fullname());
+    }
+    for (auto& [fullname, referenced_fullnames] : referenced_fullnames_dict) {
+        for (auto& referenced_fullname : referenced_fullnames) {
+            auto iter_referenced_repl_function = _repl_function_dict.find(referenced_fullname);
+            if (iter_referenced_repl_function == _repl_function_dict.end()) continue;
+            if (removable_fullnames.count(fullname)) {
+                _repl_function_dict[fullname].referenced_fullnames.insert(referenced_fullname);
+                ++iter_referenced_repl_function->second.reference_count;
+            } else {
+                // 被不会释放的代码引用, 之后不再释放
+                iter_referenced_repl_function->second.is_pinned = true;
+            }
+        }
+    }
+}
+
+void Compiler::ReleaseReplFunction(const std::string& fullname, bool is_dereferenced) {
+    auto iter_repl_function = _repl_function_dict.find(fullname);
+    if (iter_repl_function == _repl_function_dict.end()) return;
+    auto& repl_function = iter_repl_function->second;
+    if (is_dereferenced) {
+        --repl_function.reference_count;
+    } else {
+        repl_function.is_replaced = true;
+    }
+    if (!repl_function.is_replaced || repl_function.is_pinned ||
+        repl_function.reference_count > 0) {
+        return;
+    }
+
+    jit_engine->RemoveResource(fullname);
+    auto referenced_fullnames = repl_function.referenced_fullnames;
+    _repl_function_dict.erase(iter_repl_function);
+    for (auto& referenced_fullname : referenced_fullnames) {
+        this->ReleaseReplFunction(referenced_fullname, true);
+    }
+}
+
 void Compiler::ExecuteProgram(std::filesystem::path program_path) {
     this->settings.print_result = false;
     bool is_script = program_path.extension() == ".prajnascript";
@@ -143,9 +449,7 @@ void Compiler::ExecuteProgram(std::filesystem::path program_path) {
     if (is_script) {
         for (auto ir_function : ir_module->functions) {
             if (ir_function->annotation_dict.count("\\command")) {
-                auto fun_fullname = ir_function->Fullname();
-                auto fun_ptr = reinterpret_cast<void (*)(void)>(GetSymbolValue(fun_fullname));
-                fun_ptr();
+                jit_engine->RunFunction(GetSymbolValue(ir_function->Fullname()));
             }
         }
     } else {
@@ -165,9 +469,7 @@ void Compiler::ExecutateMainFunction() {
                         return;
                     }
 
-                    auto function_pointer = GetSymbolValue(ir_function->Fullname());
-                    jit_engine->CatchRuntimeError();
-                    reinterpret_cast<void (*)(void)>(function_pointer)();
+                    jit_engine->RunFunction(GetSymbolValue(ir_function->Fullname()));
                 }
             }
         }
@@ -204,10 +506,8 @@ void Compiler::RunTests(std::filesystem::path prajna_source_package_path) {
     for (auto ir_function : ir_module->functions) {
         try {
             if (ir_function->annotation_dict.count("test")) {
-                auto function_pointer = GetSymbolValue(ir_function->Fullname());
                 print_callback("test function: " + ir_function->Name() + "\n");
-                jit_engine->CatchRuntimeError();
-                reinterpret_cast<void (*)(void)>(function_pointer)();
+                jit_engine->RunFunction(GetSymbolValue(ir_function->Fullname()));
             }
         } catch (RuntimeError error) {
             logger->Error("test function: " + ir_function->Name() + " failed",
@@ -242,11 +542,9 @@ std::shared_ptr<ir::Module> Compiler::CompileProgram(
     current_symbol_table->directory_path =
         prajna_directory_path / current_symbol_table->directory_path;
 
-    std::ifstream ifs(prajna_source_path.string());
-    if (ifs.good()) {
-        std::string code((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
-        return this->CompileCode(code, current_symbol_table, prajna_source_path.string(),
-                                 is_interpreter);
+    auto source_buffer = source_manager->LoadFile(prajna_source_path);
+    if (source_buffer) {
+        return this->CompileCode(source_buffer, current_symbol_table, is_interpreter);
     } else {
         logger->Error("invalid program");
         return nullptr;
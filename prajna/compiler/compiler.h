@@ -2,13 +2,18 @@
 
 #include <filesystem>
 #include <functional>
+#include <list>
 #include <memory>
+#include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace prajna {
 
 class Logger;
+class SourceBuffer;
+class SourceManager;
 
 namespace lowering {
 class SymbolTable;
@@ -16,7 +21,8 @@ class SymbolTable;
 
 namespace ir {
 class Module;
-}
+class Function;
+}  // namespace ir
 
 namespace jit {
 class ExecutionEngine;
@@ -34,6 +40,8 @@ class Compiler : public std::enable_shared_from_this<Compiler> {
    public:
     struct Settings {
         bool print_result = true;
+        /// 交互模式下跳过已编译过的相同定义, 源码改变的函数则替换之前的定义
+        bool incremental_repl = true;
     };
 
    private:
@@ -48,6 +56,10 @@ class Compiler : public std::enable_shared_from_this<Compiler> {
                                             std::shared_ptr<lowering::SymbolTable> symbol_table,
                                             std::string file_name, bool is_interpreter);
 
+    std::shared_ptr<ir::Module> CompileCode(std::shared_ptr<SourceBuffer> source_buffer,
+                                            std::shared_ptr<lowering::SymbolTable> symbol_table,
+                                            bool is_interpreter);
+
     void GenLlvm(std::shared_ptr<ir::Module> ir_module);
 
     void BindBuiltinFunctions();
@@ -80,8 +92,41 @@ class Compiler : public std::enable_shared_from_this<Compiler> {
     std::vector<std::filesystem::path> package_directories;
 
     std::shared_ptr<Logger> logger = nullptr;
+    std::shared_ptr<SourceManager> source_manager = nullptr;
 
     Settings settings;
+
+   private:
+    /// @brief 交互模式下已成功编译的顶层定义的当前源码, 以定义的名字为键,
+    /// 没有名字的定义(如implement)以源码本身为键
+    std::unordered_map<std::string, std::string> _repl_definition_sources;
+    int64_t _repl_function_version = 0;
+
+    /// @brief 交互模式下可重新定义的函数, 各自在JIT里单独管理
+    struct ReplFunction {
+        std::string name;
+        /// 引用的其他可重新定义的函数的全名
+        std::set<std::string> referenced_fullnames;
+        /// 被其他可重新定义的函数引用的次数
+        int64_t reference_count = 0;
+        /// 被不会释放的代码(如结构体的实现)引用, 不能释放
+        bool is_pinned = false;
+        /// 已被新的定义替换, 不再被引用时释放
+        bool is_replaced = false;
+    };
+    /// 以函数的全名为键
+    std::unordered_map<std::string, ReplFunction> _repl_function_dict;
+
+    /// @brief 名为name的函数当前的定义所引用的可重新定义的函数的名字
+    std::list<std::string> GetReplReferencedFunctionNames(const std::string& name);
+
+    void UpdateReplFunctions(
+        const std::unordered_map<std::string, std::shared_ptr<ir::Function>>&
+            ir_removable_function_dict,
+        const std::unordered_map<std::string, std::set<std::string>>& referenced_fullnames_dict);
+
+    /// @brief 函数被替换(is_dereferenced为false)或少了一次引用后, 不再被引用时释放其JIT代码
+    void ReleaseReplFunction(const std::string& fullname, bool is_dereferenced);
 };
 
 }  // namespace prajna
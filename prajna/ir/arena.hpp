@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace prajna::ir {
+
+/// @brief IR节点的内存池. 节点按16字节对齐分级, 每级从64KB的大块内存里顺序切分,
+/// 释放的节点放入该级的空闲链表复用. 同一时期构造的节点在内存上相邻, 遍历时缓存更友好.
+/// @note IR只在编译线程里构造和销毁, 故没有加锁
+class NodeArena {
+   public:
+    static NodeArena& Instance() {
+        // 故意不析构, 全局对象析构时仍可能释放IR节点
+        static auto node_arena = new NodeArena;
+        return *node_arena;
+    }
+
+    void* Allocate(std::size_t bytes) {
+        if (bytes > MAX_POOLED_BYTES) {
+            return ::operator new(bytes);
+        }
+
+        auto level = Level(bytes);
+        if (auto free_node = _free_lists[level]) {
+            _free_lists[level] = free_node->next;
+            return free_node;
+        }
+
+        auto size = (level + 1) * ALIGNMENT;
+        if (_remain_bytes < size) {
+            _chunks.push_back(std::make_unique<std::byte[]>(CHUNK_BYTES));
+            _cursor = _chunks.back().get();
+            _remain_bytes = CHUNK_BYTES;
+        }
+        auto node = _cursor;
+        _cursor += size;
+        _remain_bytes -= size;
+        return node;
+    }
+
+    void Deallocate(void* node, std::size_t bytes) {
+        if (bytes > MAX_POOLED_BYTES) {
+            ::operator delete(node);
+            return;
+        }
+
+        auto level = Level(bytes);
+        auto free_node = static_cast<FreeNode*>(node);
+        free_node->next = _free_lists[level];
+        _free_lists[level] = free_node;
+    }
+
+   private:
+    NodeArena() = default;
+
+    static constexpr std::size_t ALIGNMENT = 16;
+    static constexpr std::size_t MAX_POOLED_BYTES = 512;
+    static constexpr std::size_t CHUNK_BYTES = 64 * 1024;
+
+    static std::size_t Level(std::size_t bytes) { return (bytes + ALIGNMENT - 1) / ALIGNMENT - 1; }
+
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    std::array<FreeNode*, MAX_POOLED_BYTES / ALIGNMENT> _free_lists = {};
+    std::vector<std::unique_ptr<std::byte[]>> _chunks;
+    std::byte* _cursor = nullptr;
+    std::size_t _remain_bytes = 0;
+};
+
+/// @brief 驻留的字符串, 相同的名字只存一份, 值里只存其地址
+inline const std::string* InternString(const std::string& str) {
+    static auto string_set = new std::unordered_set<std::string>;
+    return &*string_set->insert(str).first;
+}
+
+}  // namespace prajna::ir
@@ -0,0 +1,1043 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "prajna/ir/operation_instruction.hpp"
+#include "prajna/ir/value.hpp"
+
+namespace prajna::ir {
+
+/// @brief 二进制IR的记录标签, 追加新的标签时需放在最后并增加BINARY_IR_VERSION
+enum struct BinaryTag : uint8_t {
+    IntType,
+    FloatType,
+    BoolType,
+    CharType,
+    VoidType,
+    UndefType,
+    FunctionType,
+    PointerType,
+    ArrayType,
+    VectorType,
+    SimdType,
+    StructType,
+
+    VoidValue,
+    ConstantBool,
+    ConstantInt,
+    ConstantFloat,
+    ConstantChar,
+    ConstantArray,
+    ConstantVector,
+    Alloca,
+    LoadPointer,
+    StorePointer,
+    GetStructElementPointer,
+    GetArrayElementPointer,
+    GetPointerElementPointer,
+    Return,
+    BitCast,
+    Call,
+    Select,
+    ConditionBranch,
+    JumpBranch,
+    ShuffleVector,
+    CompareInstruction,
+    BinaryOperator,
+    CastInstruction,
+    InlineAsm,
+
+    // 操作数的两种形式: 引用编号的值, 或者内联的值(不在块里的常量及内联汇编)
+    ValueReference,
+    InlineConstant,
+};
+
+inline const std::string BINARY_IR_MAGIC = "PRIR";
+const int64_t BINARY_IR_VERSION = 1;
+
+class BinaryOutput {
+   public:
+    void WriteTag(BinaryTag tag) { buffer.push_back(static_cast<char>(tag)); }
+
+    void WriteUint(uint64_t value) {
+        do {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+            if (value) byte |= 0x80;
+            buffer.push_back(static_cast<char>(byte));
+        } while (value);
+    }
+
+    /// @brief zigzag编码, 使得较小的负数也只占很少的字节
+    void WriteInt(int64_t value) {
+        this->WriteUint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void WriteDouble(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int64_t i = 0; i < 8; ++i) {
+            buffer.push_back(static_cast<char>((bits >> (i * 8)) & 0xff));
+        }
+    }
+
+    void WriteString(const std::string& str) {
+        this->WriteUint(str.size());
+        buffer.append(str);
+    }
+
+    std::string buffer;
+};
+
+class BinaryInput {
+   public:
+    BinaryInput(const std::string& data, int64_t offset, int64_t size)
+        : _data(data), _offset(offset), _end(offset + size) {
+        PRAJNA_VERIFY(_end <= static_cast<int64_t>(_data.size()), "truncated binary ir");
+    }
+
+    BinaryTag ReadTag() {
+        PRAJNA_VERIFY(_offset < _end, "truncated binary ir");
+        return static_cast<BinaryTag>(_data[_offset++]);
+    }
+
+    uint64_t ReadUint() {
+        uint64_t value = 0;
+        for (int64_t shift = 0;; shift += 7) {
+            PRAJNA_VERIFY(_offset < _end && shift < 64, "invalid binary ir");
+            auto byte = static_cast<uint8_t>(_data[_offset++]);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+    }
+
+    int64_t ReadInt() {
+        auto value = this->ReadUint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    double ReadDouble() {
+        PRAJNA_VERIFY(_offset + 8 <= _end, "truncated binary ir");
+        uint64_t bits = 0;
+        for (int64_t i = 0; i < 8; ++i) {
+            bits |= static_cast<uint64_t>(static_cast<uint8_t>(_data[_offset++])) << (i * 8);
+        }
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    std::string ReadString() {
+        auto size = static_cast<int64_t>(this->ReadUint());
+        PRAJNA_VERIFY(_offset + size <= _end, "truncated binary ir");
+        auto str = _data.substr(_offset, size);
+        _offset += size;
+        return str;
+    }
+
+    int64_t Offset() const { return _offset; }
+
+   private:
+    const std::string& _data;
+    int64_t _offset;
+    int64_t _end;
+};
+
+/// @brief 把codegen之前(已完成所有transform)的模块写为二进制格式.
+/// 格式依次为: 魔数和版本, 模块信息, 类型表, 全局变量, 函数表(签名, 标注及函数体的位置),
+/// 函数体, 子模块. 函数体单独存放, 读取时可以按需加载.
+/// 模板实例的"template_instance"标注记录了模板及实参的全名, 作为实例化的键随标注一并写入
+class BinaryIRWriter : public Visitor {
+   protected:
+    BinaryIRWriter() = default;
+
+   public:
+    static std::shared_ptr<BinaryIRWriter> Create() {
+        std::shared_ptr<BinaryIRWriter> self(new BinaryIRWriter);
+        return self;
+    }
+
+    std::string Write(std::shared_ptr<Module> ir_module) {
+        // 函数体和全局值会引用类型和值的编号, 故先写函数体, 再写前面的表
+        int64_t id = 0;
+        for (auto ir_global_alloca : ir_module->global_allocas) {
+            _value_id_dict[ir_global_alloca] = id++;
+        }
+        for (auto ir_function : ir_module->functions) {
+            _value_id_dict[ir_function] = id++;
+        }
+        _module_value_size = id;
+
+        BinaryOutput body_output;
+        std::vector<std::pair<int64_t, int64_t>> body_ranges;
+        for (auto ir_function : ir_module->functions) {
+            _output.buffer.clear();
+            this->WriteFunctionBody(ir_function);
+            body_ranges.push_back({body_output.buffer.size(), _output.buffer.size()});
+            body_output.buffer.append(_output.buffer);
+        }
+
+        _output.buffer.clear();
+        for (auto ir_global_alloca : ir_module->global_allocas) {
+            _output.WriteString(ir_global_alloca->Fullname());
+            _output.WriteString(ir_global_alloca->Name());
+            _output.WriteUint(this->TypeId(Cast<PointerType>(ir_global_alloca->type)->value_type));
+            _output.WriteUint(ir_global_alloca->is_external);
+            _output.WriteUint(ir_global_alloca->address_space);
+            _output.WriteUint(ir_global_alloca->initialize_functions.size());
+            for (auto ir_function : ir_global_alloca->initialize_functions) {
+                PRAJNA_VERIFY(_value_id_dict.count(ir_function),
+                              "the initialize function is not in the module");
+                _output.WriteUint(_value_id_dict[ir_function]);
+            }
+            this->WriteAnnotations(ir_global_alloca);
+        }
+        auto iter_body_range = body_ranges.begin();
+        for (auto ir_function : ir_module->functions) {
+            _output.WriteString(ir_function->Fullname());
+            _output.WriteString(ir_function->Name());
+            _output.WriteUint(this->TypeId(ir_function->function_type));
+            this->WriteAnnotations(ir_function);
+            for (auto ir_parameter : ir_function->parameters) {
+                _output.WriteUint(ir_parameter->no_alias | ir_parameter->no_capture << 1 |
+                                  ir_parameter->no_undef << 2 | ir_parameter->readonly << 3 |
+                                  ir_parameter->is_borrowed << 4);
+            }
+            _output.WriteUint(iter_body_range->first);
+            _output.WriteUint(iter_body_range->second);
+            ++iter_body_range;
+        }
+        auto global_output = _output;
+
+        BinaryOutput module_output;
+        module_output.buffer.append(BINARY_IR_MAGIC);
+        module_output.WriteUint(BINARY_IR_VERSION);
+        module_output.WriteString(ir_module->Name());
+        module_output.WriteString(ir_module->Fullname());
+        module_output.WriteUint(static_cast<uint64_t>(ir_module->target));
+        module_output.WriteUint(_type_records.size());
+        for (auto& type_record : _type_records) {
+            module_output.buffer.append(type_record);
+        }
+        module_output.WriteUint(ir_module->global_allocas.size());
+        module_output.WriteUint(ir_module->functions.size());
+        module_output.buffer.append(global_output.buffer);
+        module_output.WriteString(body_output.buffer);
+
+        module_output.WriteUint(ir_module->modules.size());
+        for (auto ir_sub_module : ir_module->modules) {
+            module_output.WriteUint(ir_sub_module != nullptr);
+            if (ir_sub_module) {
+                module_output.WriteString(BinaryIRWriter::Create()->Write(ir_sub_module));
+            }
+        }
+
+        return module_output.buffer;
+    }
+
+    void Visit(std::shared_ptr<VoidValue> ir_void_value) override {
+        _output.WriteTag(BinaryTag::VoidValue);
+    }
+
+    void Visit(std::shared_ptr<ConstantBool> ir_constant_bool) override {
+        _output.WriteTag(BinaryTag::ConstantBool);
+        _output.WriteUint(ir_constant_bool->value);
+    }
+
+    void Visit(std::shared_ptr<ConstantInt> ir_constant_int) override {
+        _output.WriteTag(BinaryTag::ConstantInt);
+        _output.WriteUint(this->TypeId(ir_constant_int->type));
+        _output.WriteUint(ir_constant_int->value);
+    }
+
+    void Visit(std::shared_ptr<ConstantFloat> ir_constant_float) override {
+        _output.WriteTag(BinaryTag::ConstantFloat);
+        _output.WriteUint(this->TypeId(ir_constant_float->type));
+        _output.WriteDouble(ir_constant_float->value);
+        _output.WriteUint(ir_constant_float->special_value);
+        _output.WriteUint(ir_constant_float->is_negative);
+    }
+
+    void Visit(std::shared_ptr<ConstantChar> ir_constant_char) override {
+        _output.WriteTag(BinaryTag::ConstantChar);
+        _output.WriteInt(ir_constant_char->value);
+    }
+
+    void Visit(std::shared_ptr<ConstantArray> ir_constant_array) override {
+        _output.WriteTag(BinaryTag::ConstantArray);
+        _output.WriteUint(this->TypeId(ir_constant_array->type));
+        this->WriteInlineConstants(ir_constant_array->initialize_constants);
+    }
+
+    void Visit(std::shared_ptr<ConstantVector> ir_constant_vector) override {
+        _output.WriteTag(BinaryTag::ConstantVector);
+        _output.WriteUint(this->TypeId(ir_constant_vector->type));
+        this->WriteInlineConstants(ir_constant_vector->initialize_constants);
+    }
+
+    void Visit(std::shared_ptr<InlineAsm> ir_inline_asm) override {
+        _output.WriteTag(BinaryTag::InlineAsm);
+        _output.WriteUint(this->TypeId(ir_inline_asm->type));
+        _output.WriteString(ir_inline_asm->str_asm);
+        _output.WriteString(ir_inline_asm->str_constrains);
+        _output.WriteUint(ir_inline_asm->has_side_effects | ir_inline_asm->is_align_stack << 1);
+    }
+
+    void Visit(std::shared_ptr<Alloca> ir_alloca) override {
+        this->WriteInstruction(BinaryTag::Alloca, ir_alloca);
+        _output.WriteUint(this->TypeId(Cast<PointerType>(ir_alloca->type)->value_type));
+        _output.WriteInt(ir_alloca->alignment);
+    }
+
+    void Visit(std::shared_ptr<LoadPointer> ir_load_pointer) override {
+        this->WriteInstruction(BinaryTag::LoadPointer, ir_load_pointer);
+    }
+
+    void Visit(std::shared_ptr<StorePointer> ir_store_pointer) override {
+        this->WriteInstruction(BinaryTag::StorePointer, ir_store_pointer);
+    }
+
+    void Visit(std::shared_ptr<GetStructElementPointer> ir_get_struct_element_pointer) override {
+        this->WriteInstruction(BinaryTag::GetStructElementPointer, ir_get_struct_element_pointer);
+        _output.WriteUint(ir_get_struct_element_pointer->field->index);
+    }
+
+    void Visit(std::shared_ptr<GetArrayElementPointer> ir_get_array_element_pointer) override {
+        this->WriteInstruction(BinaryTag::GetArrayElementPointer, ir_get_array_element_pointer);
+    }
+
+    void Visit(std::shared_ptr<GetPointerElementPointer> ir_get_pointer_element_pointer) override {
+        this->WriteInstruction(BinaryTag::GetPointerElementPointer,
+                               ir_get_pointer_element_pointer);
+    }
+
+    void Visit(std::shared_ptr<Return> ir_return) override {
+        this->WriteInstruction(BinaryTag::Return, ir_return);
+    }
+
+    void Visit(std::shared_ptr<BitCast> ir_bit_cast) override {
+        this->WriteInstruction(BinaryTag::BitCast, ir_bit_cast);
+        _output.WriteUint(this->TypeId(ir_bit_cast->type));
+    }
+
+    void Visit(std::shared_ptr<Call> ir_call) override {
+        this->WriteInstruction(BinaryTag::Call, ir_call);
+    }
+
+    void Visit(std::shared_ptr<Select> ir_select) override {
+        this->WriteInstruction(BinaryTag::Select, ir_select);
+    }
+
+    void Visit(std::shared_ptr<internal::ConditionBranch> ir_condition_branch) override {
+        this->WriteInstruction(BinaryTag::ConditionBranch, ir_condition_branch);
+    }
+
+    void Visit(std::shared_ptr<internal::JumpBranch> ir_jump_branch) override {
+        this->WriteInstruction(BinaryTag::JumpBranch, ir_jump_branch);
+    }
+
+    void Visit(std::shared_ptr<ShuffleVector> ir_shuffle_vector) override {
+        this->WriteInstruction(BinaryTag::ShuffleVector, ir_shuffle_vector);
+    }
+
+    void Visit(std::shared_ptr<CompareInstruction> ir_compare_instruction) override {
+        this->WriteInstruction(BinaryTag::CompareInstruction, ir_compare_instruction);
+        _output.WriteUint(static_cast<uint64_t>(ir_compare_instruction->operation));
+    }
+
+    void Visit(std::shared_ptr<BinaryOperator> ir_binary_operator) override {
+        this->WriteInstruction(BinaryTag::BinaryOperator, ir_binary_operator);
+        _output.WriteUint(static_cast<uint64_t>(ir_binary_operator->operation));
+    }
+
+    void Visit(std::shared_ptr<CastInstruction> ir_cast_instruction) override {
+        this->WriteInstruction(BinaryTag::CastInstruction, ir_cast_instruction);
+        _output.WriteUint(static_cast<uint64_t>(ir_cast_instruction->operation));
+        _output.WriteUint(this->TypeId(ir_cast_instruction->type));
+    }
+
+   private:
+    void WriteFunctionBody(std::shared_ptr<Function> ir_function) {
+        // 先给函数内所有的值编号, 跳转指令可以引用后面的块.
+        // 每个函数的编号都从模块的值之后开始, 不能引用其他函数里的值
+        _function_value_id_dict.clear();
+        auto id = _module_value_size;
+        for (auto ir_parameter : ir_function->parameters) {
+            _function_value_id_dict[ir_parameter] = id++;
+        }
+        for (auto ir_block : ir_function->blocks) {
+            _function_value_id_dict[ir_block] = id++;
+        }
+        for (auto ir_block : ir_function->blocks) {
+            for (auto& ir_value : *ir_block) {
+                _function_value_id_dict[ir_value] = id++;
+            }
+        }
+
+        _output.WriteUint(ir_function->blocks.size());
+        for (auto ir_block : ir_function->blocks) {
+            _output.WriteUint(ir_block->size());
+            for (auto& ir_value : *ir_block) {
+                this->WriteValue(ir_value);
+            }
+        }
+    }
+
+    void WriteValue(std::shared_ptr<Value> ir_value) {
+        auto size = _output.buffer.size();
+        ir_value->ApplyVisitor(this->shared_from_this());
+        PRAJNA_VERIFY(_output.buffer.size() != size,
+                      std::string("unsupported value in binary ir: ") + ir_value->tag);
+        this->WriteAnnotations(ir_value);
+    }
+
+    void WriteInlineConstants(const std::list<std::shared_ptr<Constant>>& ir_constants) {
+        _output.WriteUint(ir_constants.size());
+        for (auto ir_constant : ir_constants) {
+            this->WriteValue(ir_constant);
+        }
+    }
+
+    void WriteInstruction(BinaryTag tag, std::shared_ptr<Instruction> ir_instruction) {
+        _output.WriteTag(tag);
+        _output.WriteUint(ir_instruction->OperandSize());
+        for (int64_t i = 0; i < ir_instruction->OperandSize(); ++i) {
+            auto ir_operand = ir_instruction->GetOperand(i);
+            auto id = this->ValueId(ir_operand);
+            if (id >= 0) {
+                _output.WriteTag(BinaryTag::ValueReference);
+                _output.WriteUint(id);
+                // 引用后面的值时需要先用同类型的占位值构造指令
+                _output.WriteInt(ir_operand->type ? this->TypeId(ir_operand->type) : -1);
+            } else {
+                PRAJNA_VERIFY(Is<Constant>(ir_operand) || Is<InlineAsm>(ir_operand),
+                              std::string("unsupported operand in binary ir: ") + ir_operand->tag);
+                _output.WriteTag(BinaryTag::InlineConstant);
+                this->WriteValue(ir_operand);
+            }
+        }
+    }
+
+    int64_t ValueId(std::shared_ptr<Value> ir_value) {
+        auto iter_function_value = _function_value_id_dict.find(ir_value);
+        if (iter_function_value != _function_value_id_dict.end()) {
+            return iter_function_value->second;
+        }
+        auto iter_module_value = _value_id_dict.find(ir_value);
+        if (iter_module_value != _value_id_dict.end()) return iter_module_value->second;
+        return -1;
+    }
+
+    void WriteAnnotations(std::shared_ptr<Value> ir_value) {
+        _output.WriteUint(ir_value->annotation_dict.size());
+        for (auto& [key, values] : ir_value->annotation_dict) {
+            _output.WriteString(key);
+            _output.WriteUint(values.size());
+            for (auto& value : values) {
+                _output.WriteString(value);
+            }
+        }
+    }
+
+    int64_t TypeId(std::shared_ptr<Type> ir_type) {
+        PRAJNA_ASSERT(ir_type);
+        if (_type_id_dict.count(ir_type)) return _type_id_dict[ir_type];
+
+        // 先分配编号, 结构体的字段可以引用其自身
+        auto id = static_cast<int64_t>(_type_records.size());
+        _type_id_dict[ir_type] = id;
+        _type_records.emplace_back();
+
+        BinaryOutput type_output;
+        if (auto ir_bool_type = Cast<BoolType>(ir_type)) {
+            type_output.WriteTag(BinaryTag::BoolType);
+        } else if (auto ir_char_type = Cast<CharType>(ir_type)) {
+            type_output.WriteTag(BinaryTag::CharType);
+        } else if (auto ir_int_type = Cast<IntType>(ir_type)) {
+            type_output.WriteTag(BinaryTag::IntType);
+            type_output.WriteUint(ir_int_type->bits);
+            type_output.WriteUint(ir_int_type->is_signed);
+        } else if (auto ir_float_type = Cast<FloatType>(ir_type)) {
+            type_output.WriteTag(BinaryTag::FloatType);
+            type_output.WriteUint(ir_float_type->bits);
+        } else if (Is<VoidType>(ir_type)) {
+            type_output.WriteTag(BinaryTag::VoidType);
+        } else if (Is<UndefType>(ir_type)) {
+            type_output.WriteTag(BinaryTag::UndefType);
+        } else if (auto ir_function_type = Cast<FunctionType>(ir_type)) {
+            type_output.WriteTag(BinaryTag::FunctionType);
+            type_output.WriteUint(this->TypeId(ir_function_type->return_type));
+            type_output.WriteUint(ir_function_type->parameter_types.size());
+            for (auto ir_parameter_type : ir_function_type->parameter_types) {
+                type_output.WriteUint(this->TypeId(ir_parameter_type));
+            }
+        } else if (auto ir_pointer_type = Cast<PointerType>(ir_type)) {
+            type_output.WriteTag(BinaryTag::PointerType);
+            type_output.WriteUint(this->TypeId(ir_pointer_type->value_type));
+        } else if (auto ir_array_type = Cast<ArrayType>(ir_type)) {
+            type_output.WriteTag(BinaryTag::ArrayType);
+            type_output.WriteUint(this->TypeId(ir_array_type->value_type));
+            type_output.WriteUint(ir_array_type->size);
+        } else if (auto ir_vector_type = Cast<VectorType>(ir_type)) {
+            type_output.WriteTag(BinaryTag::VectorType);
+            type_output.WriteUint(this->TypeId(ir_vector_type->value_type));
+            type_output.WriteUint(ir_vector_type->size);
+        } else if (auto ir_simd_type = Cast<SimdType>(ir_type)) {
+            type_output.WriteTag(BinaryTag::SimdType);
+            type_output.WriteUint(this->TypeId(ir_simd_type->value_type));
+            type_output.WriteUint(ir_simd_type->size);
+        } else if (auto ir_struct_type = Cast<StructType>(ir_type)) {
+            type_output.WriteTag(BinaryTag::StructType);
+            type_output.WriteString(ir_struct_type->Name());
+            type_output.WriteString(ir_struct_type->Fullname());
+            type_output.WriteUint(ir_struct_type->fields.size());
+            for (auto ir_field : ir_struct_type->fields) {
+                type_output.WriteString(ir_field->name);
+                type_output.WriteUint(this->TypeId(ir_field->type));
+            }
+        } else {
+            PRAJNA_VERIFY(false, "unsupported type in binary ir: " + ir_type->Fullname());
+        }
+
+        _type_records[id] = type_output.buffer;
+        return id;
+    }
+
+   private:
+    BinaryOutput _output;
+    std::vector<std::string> _type_records;
+    std::unordered_map<std::shared_ptr<Type>, int64_t> _type_id_dict;
+    // 全局变量和函数的编号
+    std::unordered_map<std::shared_ptr<Value>, int64_t> _value_id_dict;
+    // 当前函数里的参数, 块及指令的编号
+    std::unordered_map<std::shared_ptr<Value>, int64_t> _function_value_id_dict;
+    int64_t _module_value_size = 0;
+};
+
+/// @brief 读取BinaryIRWriter写出的模块. ReadModule只构造类型, 全局变量和函数签名,
+/// 函数体在LoadFunction时才解析, 未加载的函数和声明一样没有块.
+/// 模板实例可以按实例化的键查找, 无需重新实例化
+class BinaryIRReader {
+   protected:
+    BinaryIRReader() = default;
+
+   public:
+    static std::shared_ptr<BinaryIRReader> Create(std::string data) {
+        std::shared_ptr<BinaryIRReader> self(new BinaryIRReader);
+        self->_data = std::move(data);
+        return self;
+    }
+
+    std::shared_ptr<Module> ReadModule() {
+        BinaryInput input(_data, 0, _data.size());
+        PRAJNA_VERIFY(_data.compare(0, BINARY_IR_MAGIC.size(), BINARY_IR_MAGIC) == 0,
+                      "not a binary ir");
+        for (size_t i = 0; i < BINARY_IR_MAGIC.size(); ++i) input.ReadTag();
+        PRAJNA_VERIFY(input.ReadUint() == BINARY_IR_VERSION, "unsupported binary ir version");
+
+        _module = Module::Create();
+        _module->Name(input.ReadString());
+        _module->Fullname(input.ReadString());
+        _module->target = static_cast<Target>(input.ReadUint());
+
+        this->ReadTypeRecords(input);
+        for (int64_t i = 0; i < static_cast<int64_t>(_type_records.size()); ++i) {
+            this->ResolveType(i);
+        }
+
+        auto global_alloca_size = input.ReadUint();
+        auto function_size = input.ReadUint();
+        // 全局变量的初始值引用了后面的函数, 读完函数后再填写
+        std::list<std::pair<std::shared_ptr<GlobalAlloca>, std::vector<int64_t>>>
+            initialize_function_ids_list;
+        for (uint64_t i = 0; i < global_alloca_size; ++i) {
+            auto fullname = input.ReadString();
+            auto name = input.ReadString();
+            auto ir_global_alloca = GlobalAlloca::Create(this->ResolveType(input.ReadUint()));
+            ir_global_alloca->Fullname(fullname);
+            ir_global_alloca->Name(name);
+            ir_global_alloca->is_external = input.ReadUint();
+            ir_global_alloca->address_space = input.ReadUint();
+            std::vector<int64_t> initialize_function_ids(input.ReadUint());
+            for (auto& id : initialize_function_ids) {
+                id = input.ReadUint();
+            }
+            initialize_function_ids_list.push_back({ir_global_alloca, initialize_function_ids});
+            this->ReadAnnotations(input, ir_global_alloca);
+            _module->AddGlobalAlloca(ir_global_alloca);
+            _module_values.push_back(ir_global_alloca);
+        }
+
+        std::vector<std::pair<int64_t, int64_t>> body_ranges;
+        for (uint64_t i = 0; i < function_size; ++i) {
+            auto fullname = input.ReadString();
+            auto name = input.ReadString();
+            auto ir_function_type = Cast<FunctionType>(this->ResolveType(input.ReadUint()));
+            PRAJNA_VERIFY(ir_function_type, "invalid binary ir");
+            auto ir_function = Function::Create(ir_function_type);
+            ir_function->Fullname(fullname);
+            ir_function->Name(name);
+            this->ReadAnnotations(input, ir_function);
+            for (auto ir_parameter : ir_function->parameters) {
+                auto flags = input.ReadUint();
+                ir_parameter->no_alias = flags & 1;
+                ir_parameter->no_capture = flags & 2;
+                ir_parameter->no_undef = flags & 4;
+                ir_parameter->readonly = flags & 8;
+                ir_parameter->is_borrowed = flags & 16;
+            }
+            auto offset = static_cast<int64_t>(input.ReadUint());
+            auto size = static_cast<int64_t>(input.ReadUint());
+            body_ranges.push_back({offset, size});
+            _module->AddFunction(ir_function);
+            _module_values.push_back(ir_function);
+
+            auto iter_template_instance = ir_function->annotation_dict.find("template_instance");
+            if (iter_template_instance != ir_function->annotation_dict.end()) {
+                _template_instance_dict[iter_template_instance->second].push_back(ir_function);
+            }
+        }
+
+        for (auto& [ir_global_alloca, initialize_function_ids] : initialize_function_ids_list) {
+            for (auto id : initialize_function_ids) {
+                PRAJNA_VERIFY(id < static_cast<int64_t>(_module_values.size()),
+                              "invalid binary ir");
+                auto ir_function = Cast<Function>(_module_values[id]);
+                PRAJNA_VERIFY(ir_function, "invalid binary ir");
+                ir_global_alloca->initialize_functions.push_back(ir_function);
+            }
+        }
+
+        auto body_section_size = static_cast<int64_t>(input.ReadUint());
+        auto body_section_offset = input.Offset();
+        auto iter_function = _module->functions.begin();
+        for (auto [offset, size] : body_ranges) {
+            _body_range_dict[*iter_function] = {body_section_offset + offset, size};
+            ++iter_function;
+        }
+        BinaryInput sub_module_input(_data, body_section_offset + body_section_size,
+                                     _data.size() - body_section_offset - body_section_size);
+
+        // gpu的子模块在codegen前必须完整, 直接加载
+        auto sub_module_size = sub_module_input.ReadUint();
+        for (uint64_t i = 0; i < sub_module_size; ++i) {
+            if (!sub_module_input.ReadUint()) {
+                _module->modules.push_back(nullptr);
+                continue;
+            }
+            auto sub_module_reader = BinaryIRReader::Create(sub_module_input.ReadString());
+            auto ir_sub_module = sub_module_reader->ReadModule();
+            sub_module_reader->LoadAllFunctions();
+            _module->modules.push_back(ir_sub_module);
+        }
+
+        return _module;
+    }
+
+    void LoadFunction(std::shared_ptr<Function> ir_function) {
+        auto iter = _body_range_dict.find(ir_function);
+        if (iter == _body_range_dict.end()) return;
+        auto [offset, size] = iter->second;
+        _body_range_dict.erase(iter);
+
+        BinaryInput input(_data, offset, size);
+        _values = _module_values;
+        for (auto ir_parameter : ir_function->parameters) {
+            _values.push_back(ir_parameter);
+        }
+        auto block_size = input.ReadUint();
+        for (uint64_t i = 0; i < block_size; ++i) {
+            auto ir_block = Block::Create();
+            ir_block->parent = ir_function;
+            ir_function->blocks.push_back(ir_block);
+            _values.push_back(ir_block);
+        }
+
+        _fixups.clear();
+        for (auto ir_block : ir_function->blocks) {
+            auto value_size = input.ReadUint();
+            for (uint64_t i = 0; i < value_size; ++i) {
+                auto ir_value = this->ReadValue(input);
+                ir_block->PushBack(ir_value);
+                _values.push_back(ir_value);
+            }
+        }
+
+        for (auto [ir_instruction, op_idx, id] : _fixups) {
+            PRAJNA_VERIFY(id < static_cast<int64_t>(_values.size()), "invalid binary ir");
+            ir_instruction->SetOperand(op_idx, _values[id]);
+        }
+        _fixups.clear();
+    }
+
+    void LoadAllFunctions() {
+        for (auto ir_function : _module->functions) {
+            this->LoadFunction(ir_function);
+        }
+    }
+
+    bool IsLoaded(std::shared_ptr<Function> ir_function) const {
+        return !_body_range_dict.count(ir_function);
+    }
+
+    /// @param template_instance_key 模板及实参的全名, 见Template::Instantiate
+    /// @return 该实例产生的函数, 函数体仍需经LoadFunction加载
+    std::list<std::shared_ptr<Function>> GetTemplateInstanceFunctions(
+        const std::list<std::string>& template_instance_key) const {
+        auto iter = _template_instance_dict.find(template_instance_key);
+        if (iter == _template_instance_dict.end()) return {};
+        return iter->second;
+    }
+
+   private:
+    struct TypeRecord {
+        BinaryTag tag;
+        std::vector<uint64_t> values;
+        std::vector<int64_t> type_ids;
+        std::string name;
+        std::string fullname;
+        std::vector<std::string> field_names;
+    };
+
+    void ReadTypeRecords(BinaryInput& input) {
+        auto type_size = input.ReadUint();
+        _type_records.resize(type_size);
+        _types.resize(type_size);
+        for (auto& type_record : _type_records) {
+            type_record.tag = input.ReadTag();
+            switch (type_record.tag) {
+                case BinaryTag::BoolType:
+                case BinaryTag::CharType:
+                case BinaryTag::VoidType:
+                case BinaryTag::UndefType:
+                    break;
+                case BinaryTag::IntType:
+                    type_record.values.push_back(input.ReadUint());
+                    type_record.values.push_back(input.ReadUint());
+                    break;
+                case BinaryTag::FloatType:
+                    type_record.values.push_back(input.ReadUint());
+                    break;
+                case BinaryTag::FunctionType: {
+                    type_record.type_ids.push_back(input.ReadUint());
+                    auto parameter_size = input.ReadUint();
+                    for (uint64_t i = 0; i < parameter_size; ++i) {
+                        type_record.type_ids.push_back(input.ReadUint());
+                    }
+                    break;
+                }
+                case BinaryTag::PointerType:
+                    type_record.type_ids.push_back(input.ReadUint());
+                    break;
+                case BinaryTag::ArrayType:
+                case BinaryTag::VectorType:
+                case BinaryTag::SimdType:
+                    type_record.type_ids.push_back(input.ReadUint());
+                    type_record.values.push_back(input.ReadUint());
+                    break;
+                case BinaryTag::StructType: {
+                    type_record.name = input.ReadString();
+                    type_record.fullname = input.ReadString();
+                    auto field_size = input.ReadUint();
+                    for (uint64_t i = 0; i < field_size; ++i) {
+                        type_record.field_names.push_back(input.ReadString());
+                        type_record.type_ids.push_back(input.ReadUint());
+                    }
+                    break;
+                }
+                default:
+                    PRAJNA_VERIFY(false, "invalid binary ir type");
+            }
+        }
+    }
+
+    std::shared_ptr<Type> ResolveType(int64_t id) {
+        PRAJNA_VERIFY(id >= 0 && id < static_cast<int64_t>(_types.size()), "invalid binary ir");
+        if (_types[id]) return _types[id];
+
+        auto& type_record = _type_records[id];
+        switch (type_record.tag) {
+            case BinaryTag::BoolType:
+                return _types[id] = BoolType::Create();
+            case BinaryTag::CharType:
+                return _types[id] = CharType::Create();
+            case BinaryTag::VoidType:
+                return _types[id] = VoidType::Create();
+            case BinaryTag::UndefType:
+                return _types[id] = UndefType::Create();
+            case BinaryTag::IntType:
+                return _types[id] = IntType::Create(type_record.values[0], type_record.values[1]);
+            case BinaryTag::FloatType:
+                return _types[id] = FloatType::Create(type_record.values[0]);
+            case BinaryTag::FunctionType: {
+                auto ir_return_type = this->ResolveType(type_record.type_ids.front());
+                std::list<std::shared_ptr<Type>> ir_parameter_types;
+                for (auto iter = std::next(type_record.type_ids.begin());
+                     iter != type_record.type_ids.end(); ++iter) {
+                    ir_parameter_types.push_back(this->ResolveType(*iter));
+                }
+                return _types[id] = FunctionType::Create(ir_parameter_types, ir_return_type);
+            }
+            case BinaryTag::PointerType:
+                return _types[id] = PointerType::Create(this->ResolveType(type_record.type_ids[0]));
+            case BinaryTag::ArrayType:
+                return _types[id] = ArrayType::Create(this->ResolveType(type_record.type_ids[0]),
+                                                      type_record.values[0]);
+            case BinaryTag::VectorType:
+                return _types[id] = VectorType::Create(this->ResolveType(type_record.type_ids[0]),
+                                                       type_record.values[0]);
+            case BinaryTag::SimdType:
+                return _types[id] = SimdType::Create(this->ResolveType(type_record.type_ids[0]),
+                                                     type_record.values[0]);
+            case BinaryTag::StructType: {
+                // 结构体是按名字区分的, 已有的同名结构体直接复用
+                for (auto ir_type : global_context.created_types) {
+                    if (Is<StructType>(ir_type) && ir_type->Fullname() == type_record.fullname) {
+                        return _types[id] = ir_type;
+                    }
+                }
+
+                auto ir_struct_type = StructType::Create();
+                ir_struct_type->Name(type_record.name);
+                ir_struct_type->Fullname(type_record.fullname);
+                _types[id] = ir_struct_type;
+                for (size_t i = 0; i < type_record.field_names.size(); ++i) {
+                    ir_struct_type->fields.push_back(Field::Create(
+                        type_record.field_names[i], this->ResolveType(type_record.type_ids[i])));
+                }
+                ir_struct_type->Update();
+                return ir_struct_type;
+            }
+            default:
+                PRAJNA_UNREACHABLE;
+        }
+        return nullptr;
+    }
+
+    void ReadAnnotations(BinaryInput& input, std::shared_ptr<Value> ir_value) {
+        auto annotation_size = input.ReadUint();
+        for (uint64_t i = 0; i < annotation_size; ++i) {
+            auto& values = ir_value->annotation_dict[input.ReadString()];
+            auto value_size = input.ReadUint();
+            for (uint64_t j = 0; j < value_size; ++j) {
+                values.push_back(input.ReadString());
+            }
+        }
+    }
+
+    std::shared_ptr<Value> ReadValue(BinaryInput& input) {
+        auto ir_value = this->ReadValueWithoutAnnotations(input);
+        this->ReadAnnotations(input, ir_value);
+        return ir_value;
+    }
+
+    std::list<std::shared_ptr<Constant>> ReadInlineConstants(BinaryInput& input) {
+        std::list<std::shared_ptr<Constant>> ir_constants;
+        auto constant_size = input.ReadUint();
+        for (uint64_t i = 0; i < constant_size; ++i) {
+            auto ir_constant = Cast<Constant>(this->ReadValue(input));
+            PRAJNA_VERIFY(ir_constant, "invalid binary ir");
+            ir_constants.push_back(ir_constant);
+        }
+        return ir_constants;
+    }
+
+    /// @brief 引用后面的值时先用同类型的占位值, 函数体读完后再替换
+    std::vector<std::shared_ptr<Value>> ReadOperands(BinaryInput& input,
+                                                     std::list<int64_t>& forward_ids) {
+        std::vector<std::shared_ptr<Value>> ir_operands(input.ReadUint());
+        for (int64_t i = 0; i < static_cast<int64_t>(ir_operands.size()); ++i) {
+            auto tag = input.ReadTag();
+            if (tag == BinaryTag::InlineConstant) {
+                ir_operands[i] = this->ReadValue(input);
+                continue;
+            }
+
+            PRAJNA_VERIFY(tag == BinaryTag::ValueReference, "invalid binary ir");
+            auto id = static_cast<int64_t>(input.ReadUint());
+            auto type_id = input.ReadInt();
+            if (id < static_cast<int64_t>(_values.size())) {
+                ir_operands[i] = _values[id];
+            } else {
+                PRAJNA_VERIFY(type_id >= 0, "invalid binary ir");
+                ir_operands[i] = Value::Create(_types[type_id]);
+                forward_ids.push_back(i);
+                forward_ids.push_back(id);
+            }
+        }
+        return ir_operands;
+    }
+
+    std::shared_ptr<Value> ReadValueWithoutAnnotations(BinaryInput& input) {
+        auto tag = input.ReadTag();
+        switch (tag) {
+            case BinaryTag::VoidValue:
+                return VoidValue::Create();
+            case BinaryTag::ConstantBool:
+                return ConstantBool::Create(input.ReadUint());
+            case BinaryTag::ConstantInt: {
+                auto ir_type = this->ResolveType(input.ReadUint());
+                return ConstantInt::Create(ir_type, input.ReadUint());
+            }
+            case BinaryTag::ConstantFloat: {
+                auto ir_type = this->ResolveType(input.ReadUint());
+                auto ir_constant_float = ConstantFloat::Create(ir_type, input.ReadDouble());
+                ir_constant_float->special_value =
+                    static_cast<ConstantFloat::SpecialValue>(input.ReadUint());
+                ir_constant_float->is_negative = input.ReadUint();
+                return ir_constant_float;
+            }
+            case BinaryTag::ConstantChar:
+                return ConstantChar::Create(static_cast<char>(input.ReadInt()));
+            case BinaryTag::ConstantArray: {
+                auto ir_type = Cast<ArrayType>(this->ResolveType(input.ReadUint()));
+                return ConstantArray::Create(ir_type, this->ReadInlineConstants(input));
+            }
+            case BinaryTag::ConstantVector: {
+                auto ir_type = Cast<VectorType>(this->ResolveType(input.ReadUint()));
+                return ConstantVector::Create(ir_type, this->ReadInlineConstants(input));
+            }
+            case BinaryTag::InlineAsm: {
+                auto ir_function_type = Cast<FunctionType>(this->ResolveType(input.ReadUint()));
+                PRAJNA_VERIFY(ir_function_type, "invalid binary ir");
+                auto str_asm = input.ReadString();
+                auto ir_inline_asm =
+                    InlineAsm::Create(ir_function_type, str_asm, input.ReadString());
+                auto flags = input.ReadUint();
+                ir_inline_asm->has_side_effects = flags & 1;
+                ir_inline_asm->is_align_stack = flags & 2;
+                return ir_inline_asm;
+            }
+            default:
+                break;
+        }
+
+        std::list<int64_t> forward_ids;
+        auto ir_operands = this->ReadOperands(input, forward_ids);
+        auto operand = [&](size_t i) {
+            PRAJNA_VERIFY(i < ir_operands.size(), "invalid binary ir");
+            return ir_operands[i];
+        };
+
+        std::shared_ptr<Instruction> ir_instruction;
+        switch (tag) {
+            case BinaryTag::Alloca: {
+                auto ir_type = this->ResolveType(input.ReadUint());
+                ir_instruction = Alloca::Create(ir_type, operand(0), input.ReadInt());
+                break;
+            }
+            case BinaryTag::LoadPointer:
+                ir_instruction = LoadPointer::Create(operand(0));
+                break;
+            case BinaryTag::StorePointer:
+                ir_instruction = StorePointer::Create(operand(0), operand(1));
+                break;
+            case BinaryTag::GetStructElementPointer: {
+                auto field_index = input.ReadUint();
+                auto ir_struct_type = Cast<PointerType>(operand(0)->type)->value_type;
+                PRAJNA_VERIFY(field_index < ir_struct_type->fields.size(), "invalid binary ir");
+                ir_instruction = GetStructElementPointer::Create(
+                    operand(0), *std::next(ir_struct_type->fields.begin(), field_index));
+                break;
+            }
+            case BinaryTag::GetArrayElementPointer:
+                ir_instruction = GetArrayElementPointer::Create(operand(0), operand(1));
+                break;
+            case BinaryTag::GetPointerElementPointer:
+                ir_instruction = GetPointerElementPointer::Create(operand(0), operand(1));
+                break;
+            case BinaryTag::Return:
+                ir_instruction = Return::Create(operand(0));
+                break;
+            case BinaryTag::BitCast:
+                ir_instruction = BitCast::Create(operand(0), this->ResolveType(input.ReadUint()));
+                break;
+            case BinaryTag::Call: {
+                std::list<std::shared_ptr<Value>> ir_arguments(std::next(ir_operands.begin()),
+                                                               ir_operands.end());
+                ir_instruction = Call::Create(operand(0), ir_arguments);
+                break;
+            }
+            case BinaryTag::Select:
+                ir_instruction = Select::Create(operand(0), operand(1), operand(2));
+                break;
+            case BinaryTag::ConditionBranch:
+                ir_instruction = internal::ConditionBranch::Create(
+                    operand(0), Cast<Block>(operand(1)), Cast<Block>(operand(2)));
+                break;
+            case BinaryTag::JumpBranch:
+                ir_instruction = internal::JumpBranch::Create(Cast<Block>(operand(0)));
+                break;
+            case BinaryTag::ShuffleVector:
+                ir_instruction = ShuffleVector::Create(operand(0), operand(1));
+                break;
+            case BinaryTag::CompareInstruction:
+                ir_instruction = CompareInstruction::Create(
+                    static_cast<CompareInstruction::Operation>(input.ReadUint()), operand(0),
+                    operand(1));
+                break;
+            case BinaryTag::BinaryOperator:
+                ir_instruction = BinaryOperator::Create(
+                    static_cast<BinaryOperator::Operation>(input.ReadUint()), operand(0),
+                    operand(1));
+                break;
+            case BinaryTag::CastInstruction: {
+                auto operation = static_cast<CastInstruction::Operation>(input.ReadUint());
+                ir_instruction = CastInstruction::Create(operation, operand(0),
+                                                         this->ResolveType(input.ReadUint()));
+                break;
+            }
+            default:
+                PRAJNA_VERIFY(false, "invalid binary ir value");
+        }
+
+        for (auto iter = forward_ids.begin(); iter != forward_ids.end(); std::advance(iter, 2)) {
+            _fixups.push_back({ir_instruction, *iter, *std::next(iter)});
+        }
+        return ir_instruction;
+    }
+
+   private:
+    struct Fixup {
+        std::shared_ptr<Instruction> instruction;
+        int64_t operand_index;
+        int64_t id;
+    };
+
+    std::string _data;
+    std::shared_ptr<Module> _module = nullptr;
+    std::vector<TypeRecord> _type_records;
+    std::vector<std::shared_ptr<Type>> _types;
+    std::vector<std::shared_ptr<Value>> _module_values;
+    std::vector<std::shared_ptr<Value>> _values;
+    std::list<Fixup> _fixups;
+    std::unordered_map<std::shared_ptr<Function>, std::pair<int64_t, int64_t>> _body_range_dict;
+    std::map<std::list<std::string>, std::list<std::shared_ptr<Function>>> _template_instance_dict;
+};
+
+inline void SaveBinaryIR(std::shared_ptr<Module> ir_module, std::filesystem::path path) {
+    std::ofstream ofs(path, std::ios::binary);
+    PRAJNA_VERIFY(ofs.good(), "failed to open " + path.string());
+    auto data = BinaryIRWriter::Create()->Write(ir_module);
+    ofs.write(data.data(), data.size());
+}
+
+/// @return 返回reader, 模块的函数体可以经由reader按需加载
+inline std::shared_ptr<BinaryIRReader> OpenBinaryIR(std::filesystem::path path) {
+    std::ifstream ifs(path, std::ios::binary);
+    PRAJNA_VERIFY(ifs.good(), "failed to open " + path.string());
+    std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    return BinaryIRReader::Create(std::move(data));
+}
+
+}  // namespace prajna::ir
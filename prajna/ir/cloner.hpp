@@ -87,6 +87,7 @@ class FunctionCloner : public Visitor {
         }
 
         auto ir_new = Parameter::Create(ir_parameter->type);
+        ir_new->is_borrowed = ir_parameter->is_borrowed;
         value_dict[ir_parameter] = ir_new;
     }
 
@@ -8,6 +8,7 @@ GlobalContext::GlobalContext(int64_t target_bits) {}
 
 void GlobalContext::Reset() {
     created_types.clear();
+    _type_dict.clear();
     f16 = FloatType::Create(16);
     f32 = FloatType::Create(32);
     f64 = FloatType::Create(64);
@@ -1,13 +1,46 @@
 #pragma once
 
+#include <functional>
 #include <list>
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace prajna::ir {
 
 class Type;
 
+/// @brief 类型的结构化键. 类型都是唯一构造的, 故组成类型直接比较地址即可
+struct TypeKey {
+    std::string kind;
+    std::vector<int64_t> values;
+    std::vector<Type*> types;
+
+    bool operator==(const TypeKey&) const = default;
+};
+
+}  // namespace prajna::ir
+
+template <>
+struct std::hash<prajna::ir::TypeKey> {
+    std::size_t operator()(const prajna::ir::TypeKey& type_key) const noexcept {
+        auto seed = std::hash<std::string>{}(type_key.kind);
+        auto combine = [&seed](std::size_t h) {
+            seed ^= h + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2);
+        };
+        for (auto value : type_key.values) {
+            combine(std::hash<int64_t>{}(value));
+        }
+        for (auto type : type_key.types) {
+            combine(std::hash<prajna::ir::Type*>{}(type));
+        }
+        return seed;
+    }
+};
+
+namespace prajna::ir {
+
 class GlobalContext {
    public:
     GlobalContext(int64_t target_bits);
@@ -17,6 +50,20 @@ class GlobalContext {
     /// @brief 用于存储已经构造了的类型
     /// @note 需要使用vector来确保构造的顺序, 因为后面的codegen需要顺序正确
     std::list<std::shared_ptr<Type>> created_types;
+
+    /// @brief 查找结构相同的已构造类型, 没有则返回nullptr
+    std::shared_ptr<Type> FindType(const TypeKey& type_key) const {
+        auto iter = _type_dict.find(type_key);
+        return iter != _type_dict.end() ? iter->second : nullptr;
+    }
+
+    void AddType(TypeKey type_key, std::shared_ptr<Type> ir_type) {
+        _type_dict[std::move(type_key)] = ir_type;
+        created_types.push_back(ir_type);
+    }
+
+   private:
+    std::unordered_map<TypeKey, std::shared_ptr<Type>> _type_dict;
 };
 
 extern GlobalContext global_context;
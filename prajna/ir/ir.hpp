@@ -1,5 +1,6 @@
 #pragma once
 
+#include "prajna/ir/binary_ir.hpp"
 #include "prajna/ir/cloner.hpp"
 #include "prajna/ir/construct_parent_node.hpp"
 #include "prajna/ir/ir_print_visitor.hpp"
@@ -41,6 +41,7 @@ class IRPrinter : public Visitor {
         if (ir_parameter->no_capture) output << " nocapture";
         if (ir_parameter->no_undef) output << " noundef";
         if (ir_parameter->readonly) output << " readonly";
+        if (ir_parameter->is_borrowed) output << " borrowed";
         output << ";\n";
     }
 
@@ -182,6 +183,7 @@ class IRPrinter : public Visitor {
         if (ir_global_alloca->address_space != 0) {
             output << ", address_space " << ir_global_alloca->address_space;
         }
+        this->PrintInitializeFunctions(ir_global_alloca->initialize_functions);
         output << ";\n";
     }
 
@@ -245,9 +247,21 @@ class IRPrinter : public Visitor {
         if (ir_global_variable->is_external) {
             output << " external";
         }
+        this->PrintInitializeFunctions(ir_global_variable->initialize_functions);
         output << ";\n";
     }
 
+    void PrintInitializeFunctions(std::list<std::shared_ptr<Function>> ir_functions) {
+        if (ir_functions.empty()) return;
+
+        output << " = {";
+        for (auto iter = ir_functions.begin(); iter != ir_functions.end(); ++iter) {
+            if (iter != ir_functions.begin()) output << ", ";
+            output << GetVariableName(*iter);
+        }
+        output << "}";
+    }
+
     void Visit(std::shared_ptr<AccessProperty> ir_access_property) override {
         output << GetVariableName(ir_access_property) << " = AccessProperty "
                << GetVariableName(ir_access_property->ThisPointer()) << ".";
@@ -79,6 +79,11 @@ class Type {
     std::shared_ptr<lowering::TemplateStruct> template_struct = nullptr;
     std::any template_arguments_any;
     llvm::Type* llvm_type = nullptr;
+
+   private:
+    // GetMemberFunction在接口中查找的结果(包括未找到), 接口或其函数的数量变化后失效
+    std::unordered_map<std::string, std::shared_ptr<Function>> _interface_function_cache;
+    int64_t _interface_function_cache_signature = -1;
 };
 
 class RealNumberType : public Type {
@@ -95,12 +100,9 @@ class FloatType : public RealNumberType {
 
    public:
     static std::shared_ptr<FloatType> Create(int64_t bits) {
-        for (auto ir_type : global_context.created_types) {
-            if (auto ir_float_type = Cast<FloatType>(ir_type)) {
-                if (ir_float_type->bits == bits) {
-                    return ir_float_type;
-                }
-            }
+        TypeKey type_key{"float", {bits}, {}};
+        if (auto ir_type = global_context.FindType(type_key)) {
+            return std::static_pointer_cast<FloatType>(ir_type);
         }
 
         std::shared_ptr<FloatType> self(new FloatType);
@@ -108,7 +110,7 @@ class FloatType : public RealNumberType {
         self->bytes = bits / 8;
         self->Name("f" + std::to_string(bits));
         self->Fullname("f" + std::to_string(bits));
-        global_context.created_types.push_back(self);
+        global_context.AddType(type_key, self);
         return self;
     }
 };
@@ -122,17 +124,9 @@ class IntType : public RealNumberType {
 
    public:
     static std::shared_ptr<IntType> Create(int64_t bits, bool is_signed) {
-        for (auto ir_type : global_context.created_types) {
-            if (auto ir_int_type = Cast<IntType>(ir_type)) {
-                // 不能和char和bool混了
-                if (Is<ir::CharType>(ir_type) || Is<ir::BoolType>(ir_type)) {
-                    continue;
-                }
-
-                if (ir_int_type->bits == bits && ir_int_type->is_signed == is_signed) {
-                    return ir_int_type;
-                }
-            }
+        TypeKey type_key{"int", {bits, is_signed}, {}};
+        if (auto ir_type = global_context.FindType(type_key)) {
+            return std::static_pointer_cast<IntType>(ir_type);
         }
 
         std::shared_ptr<IntType> self(new IntType);
@@ -141,7 +135,7 @@ class IntType : public RealNumberType {
         self->is_signed = is_signed;
         self->Name(std::string(is_signed ? "i" : "u") + std::to_string(bits));
         self->Fullname(std::string(is_signed ? "i" : "u") + std::to_string(bits));
-        global_context.created_types.push_back(self);
+        global_context.AddType(type_key, self);
         return self;
     }
 
@@ -155,10 +149,9 @@ class BoolType : public IntType {
 
    public:
     static std::shared_ptr<BoolType> Create() {
-        for (auto ir_type : global_context.created_types) {
-            if (auto ir_bool_type = Cast<BoolType>(ir_type)) {
-                return ir_bool_type;
-            }
+        TypeKey type_key{"bool", {}, {}};
+        if (auto ir_type = global_context.FindType(type_key)) {
+            return std::static_pointer_cast<BoolType>(ir_type);
         }
 
         std::shared_ptr<BoolType> self(new BoolType);
@@ -168,7 +161,7 @@ class BoolType : public IntType {
         self->bytes = 1;
         self->Name("bool");
         self->Fullname("bool");
-        global_context.created_types.push_back(self);
+        global_context.AddType(type_key, self);
         return self;
     }
 
@@ -181,10 +174,9 @@ class CharType : public IntType {
 
    public:
     static std::shared_ptr<CharType> Create() {
-        for (auto ir_type : global_context.created_types) {
-            if (auto ir_char_type = Cast<CharType>(ir_type)) {
-                return ir_char_type;
-            }
+        TypeKey type_key{"char", {}, {}};
+        if (auto ir_type = global_context.FindType(type_key)) {
+            return std::static_pointer_cast<CharType>(ir_type);
         }
 
         std::shared_ptr<CharType> self(new CharType);
@@ -194,7 +186,7 @@ class CharType : public IntType {
 
         self->Name("char");
         self->Fullname("char");
-        global_context.created_types.push_back(self);
+        global_context.AddType(type_key, self);
         return self;
     }
 };
@@ -205,17 +197,16 @@ class VoidType : public Type {
 
    public:
     static std::shared_ptr<VoidType> Create() {
-        for (auto ir_type : global_context.created_types) {
-            if (auto ir_void_type = Cast<VoidType>(ir_type)) {
-                return ir_void_type;
-            }
+        TypeKey type_key{"void", {}, {}};
+        if (auto ir_type = global_context.FindType(type_key)) {
+            return std::static_pointer_cast<VoidType>(ir_type);
         }
 
         std::shared_ptr<VoidType> self(new VoidType);
         self->Name("void");
         self->bytes = 0;  // 应该是个无效值
         self->Fullname("void");
-        global_context.created_types.push_back(self);
+        global_context.AddType(type_key, self);
         return self;
     }
 
@@ -228,17 +219,16 @@ class UndefType : public Type {
 
    public:
     static std::shared_ptr<UndefType> Create() {
-        for (auto ir_type : global_context.created_types) {
-            if (auto ir_undef_type = Cast<UndefType>(ir_type)) {
-                return ir_undef_type;
-            }
+        TypeKey type_key{"undef", {}, {}};
+        if (auto ir_type = global_context.FindType(type_key)) {
+            return std::static_pointer_cast<UndefType>(ir_type);
         }
 
         std::shared_ptr<UndefType> self(new UndefType);
         self->Name("undef");
         self->bytes = 1;  // 应该是个无效值
         self->Fullname("undef");
-        global_context.created_types.push_back(self);
+        global_context.AddType(type_key, self);
         return self;
     }
 };
@@ -252,14 +242,12 @@ class FunctionType : public Type {
     static std::shared_ptr<FunctionType> Create(std::list<std::shared_ptr<Type>> ir_parameter_types,
                                                 std::shared_ptr<Type> return_type) {
         // @note 不同函数的, 函数类型不应该是用一个指针, 下面的代码更适合判断动态分发的时候使用
-        for (auto ir_type : global_context.created_types) {
-            if (auto ir_fun_type = Cast<FunctionType>(ir_type)) {
-                if (ir_fun_type->return_type == return_type &&
-                    ir_fun_type->parameter_types.size() == ir_parameter_types.size() &&
-                    std::ranges::equal(ir_parameter_types, ir_fun_type->parameter_types)) {
-                    return ir_fun_type;
-                }
-            }
+        TypeKey type_key{"function", {}, {return_type.get()}};
+        for (auto ir_parameter_type : ir_parameter_types) {
+            type_key.types.push_back(ir_parameter_type.get());
+        }
+        if (auto ir_type = global_context.FindType(type_key)) {
+            return std::static_pointer_cast<FunctionType>(ir_type);
         }
 
         std::shared_ptr<FunctionType> self(new FunctionType);
@@ -282,7 +270,7 @@ class FunctionType : public Type {
         name_str += self->return_type->Fullname();
         self->Name(name_str);
         self->Fullname(name_str);
-        global_context.created_types.push_back(self);
+        global_context.AddType(type_key, self);
         return self;
     }
 
@@ -302,12 +290,9 @@ class PointerType : public Type {
     static std::shared_ptr<PointerType> Create(std::shared_ptr<Type> value_type) {
         PRAJNA_ASSERT(!Is<VoidType>(value_type));
 
-        for (auto ir_type : global_context.created_types) {
-            if (auto ir_pointer_type = Cast<PointerType>(ir_type)) {
-                if (ir_pointer_type->value_type == value_type) {
-                    return ir_pointer_type;
-                }
-            }
+        TypeKey type_key{"pointer", {}, {value_type.get()}};
+        if (auto ir_type = global_context.FindType(type_key)) {
+            return std::static_pointer_cast<PointerType>(ir_type);
         }
 
         std::shared_ptr<PointerType> self(new PointerType);
@@ -316,7 +301,7 @@ class PointerType : public Type {
         std::string name_str = value_type->Fullname() + "*";
         self->Name(name_str);
         self->Fullname(name_str);
-        global_context.created_types.push_back(self);
+        global_context.AddType(type_key, self);
         return self;
     }
 
@@ -330,12 +315,9 @@ class ArrayType : public Type {
 
    public:
     static std::shared_ptr<ArrayType> Create(std::shared_ptr<Type> value_type, int64_t size) {
-        for (auto ir_type : global_context.created_types) {
-            if (auto ir_array_type = Cast<ArrayType>(ir_type)) {
-                if (ir_array_type->value_type == value_type && ir_array_type->size == size) {
-                    return ir_array_type;
-                }
-            }
+        TypeKey type_key{"array", {size}, {value_type.get()}};
+        if (auto ir_type = global_context.FindType(type_key)) {
+            return std::static_pointer_cast<ArrayType>(ir_type);
         }
 
         std::shared_ptr<ArrayType> self(new ArrayType);
@@ -345,7 +327,7 @@ class ArrayType : public Type {
         std::string name_str = value_type->Name() + "[" + std::to_string(size) + "]";
         self->Name(name_str);
         self->Fullname(name_str);
-        global_context.created_types.push_back(self);
+        global_context.AddType(type_key, self);
         return self;
     }
 
@@ -360,12 +342,9 @@ class VectorType : public Type {
 
    public:
     static std::shared_ptr<VectorType> Create(std::shared_ptr<Type> value_type, int64_t size) {
-        for (auto ir_type : global_context.created_types) {
-            if (auto ir_vectory_type = Cast<VectorType>(ir_type)) {
-                if (ir_vectory_type->value_type == value_type && ir_vectory_type->size == size) {
-                    return ir_vectory_type;
-                }
-            }
+        TypeKey type_key{"vector", {size}, {value_type.get()}};
+        if (auto ir_type = global_context.FindType(type_key)) {
+            return std::static_pointer_cast<VectorType>(ir_type);
         }
 
         std::shared_ptr<VectorType> self(new VectorType);
@@ -375,7 +354,7 @@ class VectorType : public Type {
         std::string name_str = value_type->Name() + "[" + std::to_string(size) + "]";
         self->Name(name_str);
         self->Fullname(name_str);
-        global_context.created_types.push_back(self);
+        global_context.AddType(type_key, self);
         return self;
     }
 
@@ -462,6 +441,8 @@ class InterfacePrototype {
    public:
     std::list<std::shared_ptr<Function>> functions;
     std::shared_ptr<StructType> dynamic_type = nullptr;
+    // 虚表的类型, 每个接口函数对应一个函数指针字段
+    std::shared_ptr<StructType> vtable_type = nullptr;
 
     bool disable_dynamic = false;
 
@@ -501,6 +482,8 @@ class InterfaceImplement {
         undef_this_pointer_functions;
     std::shared_ptr<InterfacePrototype> prototype = nullptr;
     std::shared_ptr<Function> dynamic_type_creator = nullptr;
+    // 返回该实现共享的虚表地址, 虚表地址同时作为动态类型的具体类型标识
+    std::shared_ptr<Function> vtable_getter = nullptr;
 };
 
 class SimdType : public Type {
@@ -509,12 +492,9 @@ class SimdType : public Type {
 
    public:
     static std::shared_ptr<SimdType> Create(std::shared_ptr<Type> value_type, int64_t size) {
-        for (auto ir_type : global_context.created_types) {
-            if (auto ir_array_type = Cast<SimdType>(ir_type)) {
-                if (ir_array_type->value_type == value_type && ir_array_type->size == size) {
-                    return ir_array_type;
-                }
-            }
+        TypeKey type_key{"simd", {size}, {value_type.get()}};
+        if (auto ir_type = global_context.FindType(type_key)) {
+            return std::static_pointer_cast<SimdType>(ir_type);
         }
 
         std::shared_ptr<SimdType> self(new SimdType);
@@ -524,7 +504,7 @@ class SimdType : public Type {
         std::string name_str = value_type->Name() + "[" + std::to_string(size) + "]";
         self->Name(name_str);
         self->Fullname(name_str);
-        global_context.created_types.push_back(self);
+        global_context.AddType(type_key, self);
         return self;
     }
 
@@ -4,6 +4,7 @@
 #include <functional>
 #include <list>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
 #include <unordered_set>
@@ -13,6 +14,7 @@
 #include "boost/range/combine.hpp"
 #include "prajna/ast/ast.hpp"
 #include "prajna/helper.hpp"
+#include "prajna/ir/arena.hpp"
 #include "prajna/ir/global_context.h"
 #include "prajna/ir/target.hpp"
 #include "prajna/ir/type.hpp"
@@ -95,13 +97,18 @@ class Value : public std::enable_shared_from_this<Value> {
 
     virtual ~Value() {}
 
-    /// @brief 释放不必要的依赖, 解除循环引用
-    virtual void Detach() {
-        // 只是解除依赖, 不是销毁数据,
-        this->instruction_with_index_list.clear();
-        this->parent.reset();
+    /// IR节点都从NodeArena分配, 析构函数是虚函数, 故释放时的大小是实际类型的大小
+    static void* operator new(std::size_t bytes) { return NodeArena::Instance().Allocate(bytes); }
+    static void operator delete(void* ir_value, std::size_t bytes) {
+        NodeArena::Instance().Deallocate(ir_value, bytes);
     }
 
+    /// @brief 释放不必要的依赖, 解除循环引用
+    virtual void Detach();
+
+    /// @brief 把所有使用该值的操作数替换为ir_new_value
+    void ReplaceAllUsesWith(std::shared_ptr<ir::Value> ir_new_value);
+
     /// @brief 实例需要销毁前调用
     virtual void Finalize();
 
@@ -133,16 +140,28 @@ class Value : public std::enable_shared_from_this<Value> {
 
     virtual void ApplyVisitor(std::shared_ptr<Visitor> interpreter) { PRAJNA_UNREACHABLE; }
 
-    std::string Name() const { return _name; }
-    void Name(const std::string& name) { _name = name; }
+    std::string Name() const { return *_name; }
+    void Name(const std::string& name) { _name = InternString(name); }
 
-    std::string Fullname() const { return _fullname; }
-    void Fullname(const std::string& fullname) { _fullname = fullname; }
+    std::string Fullname() const { return *_fullname; }
+    void Fullname(const std::string& fullname) { _fullname = InternString(fullname); }
+
+   private:
+    static const std::string* UndefinedName() {
+        static auto name = InternString("NameIsUndefined");
+        return name;
+    }
+
+    static const std::string* UndefinedFullname() {
+        static auto fullname = InternString("FullnameIsUndefined");
+        return fullname;
+    }
 
    private:
     bool is_finalized = false;
-    std::string _name = "NameIsUndefined";
-    std::string _fullname = "FullnameIsUndefined";
+    // 名字大量重复(如未定义的名字, 同名的局部变量), 故驻留后只存地址
+    const std::string* _name = UndefinedName();
+    const std::string* _fullname = UndefinedFullname();
 
    public:
     std::shared_ptr<Type> type = nullptr;
@@ -152,8 +171,8 @@ class Value : public std::enable_shared_from_this<Value> {
     std::list<InstructionAndOperandIndex> instruction_with_index_list;
     ast::SourceLocation source_location;
     llvm::Value* llvm_value = nullptr;
-    // 用于方便调试, 否则无法有效辨别他们
-    std::string tag = "";
+    // 用于方便调试, 否则无法有效辨别他们, 只赋值字面量
+    const char* tag = "";
 };
 
 class VoidValue : public Value {
@@ -195,6 +214,8 @@ class Parameter : public Value {
     bool no_capture = false;
     bool no_undef = false;
     bool readonly = false;
+    /// 由@borrow标注, 调用方保证其生命周期, 函数内不对其进行引用计数
+    bool is_borrowed = false;
 };
 
 class Constant : public Value {
@@ -539,10 +560,16 @@ class Instruction : virtual public Value {
    protected:
     Instruction() : Instruction(0) {}
 
-    Instruction(int64_t operand_size) { this->operands.resize(operand_size); }
+    Instruction(int64_t operand_size) { this->OperandResize(operand_size); }
 
    public:
-    virtual void OperandResize(int64_t size) { return this->operands.resize(size); }
+    virtual void OperandResize(int64_t size) {
+        for (int64_t i = size; i < this->OperandSize(); ++i) {
+            this->UnlinkUse(i);
+        }
+        this->operands.resize(size);
+        this->use_iterators.resize(size);
+    }
 
     virtual int64_t OperandSize() { return this->operands.size(); }
 
@@ -555,29 +582,24 @@ class Instruction : virtual public Value {
         PRAJNA_ASSERT(ir_value);
         PRAJNA_ASSERT(this->OperandSize() > i);
 
-        auto ir_old_value = this->operands[i];
-        if (ir_old_value) {
-            ir_old_value->instruction_with_index_list.remove(
-                {Cast<Instruction>(this->shared_from_this()), i});
-        }
+        this->UnlinkUse(i);
 
+        if (this->weak_self.expired()) {
+            this->weak_self = Cast<Instruction>(this->shared_from_this());
+        }
         this->operands[i] = ir_value;
-        if (ir_value)
-            ir_value->instruction_with_index_list.push_back(
-                {Cast<Instruction>(this->shared_from_this()), i});
+        ir_value->instruction_with_index_list.push_back({this->weak_self, i});
+        this->use_iterators[i] = std::prev(ir_value->instruction_with_index_list.end());
     };
 
+    /// @brief 操作数的值不再记录该使用, 如该值已Detach
+    void ForgetUse(int64_t i) {
+        PRAJNA_ASSERT(this->OperandSize() > i);
+        this->use_iterators[i].reset();
+    }
+
     void Finalize() override {
         Value::Finalize();
-
-        for (int64_t i = 0; i < OperandSize(); ++i) {
-            auto ir_old_value = this->operands[i];
-            if (ir_old_value) {
-                ir_old_value->instruction_with_index_list.remove(
-                    {Cast<Instruction>(this->shared_from_this()), i});
-            }
-        }
-
         this->OperandResize(0);
     }
 
@@ -585,8 +607,22 @@ class Instruction : virtual public Value {
         interpreter->Visit(Cast<Instruction>(this->shared_from_this()));
     }
 
+   private:
+    /// @brief 操作数的使用记录的位置是已知的, 直接删除, 无需在使用列表里查找
+    void UnlinkUse(int64_t i) {
+        if (this->operands[i] && this->use_iterators[i]) {
+            this->operands[i]->instruction_with_index_list.erase(*this->use_iterators[i]);
+        }
+        this->use_iterators[i].reset();
+    }
+
    protected:
     std::vector<std::shared_ptr<ir::Value>> operands;
+
+   private:
+    /// 每个操作数在其值的instruction_with_index_list里对应的位置
+    std::vector<std::optional<std::list<InstructionAndOperandIndex>::iterator>> use_iterators;
+    std::weak_ptr<Instruction> weak_self;
 };
 
 /// @brief 用于访问结构体的字段, 最终会变为指针偏移的方式, Constant在lowering的时候就做单独处理
@@ -944,9 +980,17 @@ class GlobalAlloca : public Instruction {
         interpreter->Visit(Cast<GlobalAlloca>(this->shared_from_this()));
     }
 
+    void Finalize() override {
+        Instruction::Finalize();
+        // 初始值里的函数可能又引用了该全局变量
+        this->initialize_functions.clear();
+    }
+
    public:
     bool is_external = false;
     uint32_t address_space = 0;
+    /// @brief 见GlobalVariable::initialize_functions, 不为空时生成只读的全局变量
+    std::list<std::shared_ptr<Function>> initialize_functions;
     // std::shared_ptr<GlobalVariable> link_to_global_variable = nullptr;
 };
 
@@ -1433,8 +1477,15 @@ class GlobalVariable : public Variable {
         interpreter->Visit(Cast<GlobalVariable>(this->shared_from_this()));
     }
 
+    void Finalize() override {
+        Variable::Finalize();
+        this->initialize_functions.clear();
+    }
+
    public:
     bool is_external = false;
+    /// @brief 结构体按字段顺序的常量初始值, 目前只有由函数指针组成的虚表会用到, 为空时不初始化
+    std::list<std::shared_ptr<Function>> initialize_functions;
 };
 
 class AccessProperty : public WriteReadAble, virtual public Instruction {
@@ -1754,6 +1805,31 @@ inline std::list<std::shared_ptr<ir::Value>>::iterator Value::GetBlockIterator()
     return iter;
 }
 
+inline void Value::Detach() {
+    // 只是解除依赖, 不是销毁数据,
+    for (auto [ir_instruction, op_idx] : this->instruction_with_index_list) {
+        if (auto ir_user = Lock(ir_instruction)) {
+            ir_user->ForgetUse(op_idx);
+        }
+    }
+    this->instruction_with_index_list.clear();
+    this->parent.reset();
+}
+
+inline void Value::ReplaceAllUsesWith(std::shared_ptr<ir::Value> ir_new_value) {
+    PRAJNA_ASSERT(ir_new_value.get() != this);
+    // SetOperand会把使用从列表里移除, 故每次取第一个
+    while (!this->instruction_with_index_list.empty()) {
+        auto [ir_instruction, op_idx] = this->instruction_with_index_list.front();
+        auto ir_user = Lock(ir_instruction);
+        if (!ir_user) {
+            this->instruction_with_index_list.pop_front();
+            continue;
+        }
+        ir_user->SetOperand(op_idx, ir_new_value);
+    }
+}
+
 inline void Value::Finalize() {
     PRAJNA_ASSERT(this->instruction_with_index_list.size() == 0);
     this->Detach();
@@ -1766,15 +1842,30 @@ inline std::string GetKernelFunctionAddressName(std::shared_ptr<Function> ir_ker
 }
 
 inline std::shared_ptr<Function> Type::GetMemberFunction(std::string member_function_name) {
-    if (this->member_function_dict.count(member_function_name)) {
-        return this->member_function_dict[member_function_name];
+    auto iter_member_function = this->member_function_dict.find(member_function_name);
+    if (iter_member_function != this->member_function_dict.end()) {
+        return iter_member_function->second;
+    }
+
+    // 实现接口时会不断加入函数, 故以接口及其函数的数量判断缓存是否仍然有效
+    int64_t signature = 0;
+    for (auto& [interface_name, ir_interface] : this->interface_dict) {
+        signature += 1 + (ir_interface ? ir_interface->functions.size() : 0);
     }
+    if (signature != _interface_function_cache_signature) {
+        _interface_function_cache.clear();
+        _interface_function_cache_signature = signature;
+    }
+
+    auto [iter_cache, inserted] = _interface_function_cache.try_emplace(member_function_name);
+    if (!inserted) return iter_cache->second;
 
-    for (auto [interface_name, ir_interface] : this->interface_dict) {
+    for (auto& [interface_name, ir_interface] : this->interface_dict) {
         if (!ir_interface) continue;
 
         for (auto ir_function : ir_interface->functions) {
             if (ir_function->Name() == member_function_name) {
+                iter_cache->second = ir_function;
                 return ir_function;
             }
         }
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
+#include "prajna/global_config.hpp"
 #include "prajna/helper.hpp"
 #include "prajna/ir/ir.hpp"
 
@@ -82,4 +84,27 @@ inline bool Verify(std::shared_ptr<ir::Value> ir_value) {
     return true;
 }
 
+/// @brief IR验证的粒度, 由prajna.verify_level配置: none不验证, module只在模块进出变换时验证,
+/// pass在每个pass后验证其修改的函数(以及内联, 克隆等产生的函数)
+enum struct VerifyLevel { none, module, pass };
+
+inline VerifyLevel GetVerifyLevel() {
+    static auto verify_level = []() {
+        auto verify_level_str =
+            GlobalConfig::Instance().get<std::string>("prajna.verify_level", "module");
+        if (verify_level_str == "none") return VerifyLevel::none;
+        if (verify_level_str == "module") return VerifyLevel::module;
+        if (verify_level_str == "pass") return VerifyLevel::pass;
+        PRAJNA_VERIFY(false, "prajna.verify_level should be none, module or pass");
+        return VerifyLevel::module;
+    }();
+    return verify_level;
+}
+
+/// @brief 配置的验证粒度低于level时跳过验证
+inline bool Verify(std::shared_ptr<ir::Value> ir_value, VerifyLevel level) {
+    if (GetVerifyLevel() < level) return true;
+    return Verify(ir_value);
+}
+
 }  // namespace prajna::ir
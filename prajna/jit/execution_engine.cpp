@@ -31,6 +31,7 @@
 #include "boost/dll/shared_library.hpp"
 #include "fmt/format.h"
 #include "llvm/ExecutionEngine/JITLink/JITLinkMemoryManager.h"
+#include "llvm/ExecutionEngine/Orc/Core.h"
 #include "llvm/ExecutionEngine/Orc/EPCDynamicLibrarySearchGenerator.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
 #include "llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h"
@@ -38,6 +39,7 @@
 #include "llvm/ExecutionEngine/Orc/Shared/ExecutorSymbolDef.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "prajna/assert.hpp"
 #include "prajna/compiler/compiler.h"
 #include "prajna/exception.hpp"
@@ -46,6 +48,7 @@
 #include "prajna/jit/cuda_runtime_loader.cpp"
 #include "prajna/jit/gpu_compiler.hpp"
 #include "prajna/jit/hip_runtime_loader.cpp"
+#include "prajna/jit/thread_pool.hpp"
 #include "prajna/mangle_name.hpp"
 
 #if defined(__linux__) || defined(WIN32)
@@ -67,8 +70,11 @@ jmp_buf buf;
 void print_c(const char *c_str) { print_callback(std::string(c_str)); }
 char *input_c() { return input_callback(); }
 void exit_c(int64_t ret_code) {
-    std::string msg = "exit " + std::to_string(ret_code) + "\n";
-    print_c(msg.c_str());
+    {
+        // longjmp不会析构对象, 故先释放msg
+        std::string msg = "exit " + std::to_string(ret_code) + "\n";
+        print_c(msg.c_str());
+    }
     longjmp(buf, 1);
 }
 
@@ -77,6 +83,11 @@ void print_i64_i64(int64_t i, int64_t j) {
     print_c(msg.c_str());
 }
 
+void parallel_for_c(int64_t first, int64_t last, int64_t grain_size, int64_t schedule,
+                    ThreadPool::RangeFunction function, void *context) {
+    ThreadPool::Instance().ParallelFor(first, last, grain_size, schedule, function, context);
+}
+
 float Clock() {
     // steady_clock是统计物理世界的时间
     return std::chrono::steady_clock::now().time_since_epoch().count() * 1.0 *
@@ -164,6 +175,8 @@ ExecutionEngine::ExecutionEngine() {
             _up_lljit->getDataLayout().getGlobalPrefix())));
 }
 
+ExecutionEngine::~ExecutionEngine() = default;
+
 bool ExecutionEngine::LoadDynamicLib(std::string lib_name) {
     return llvm::sys::DynamicLibrary::getPermanentLibrary(lib_name.c_str()).isValid();
 }
@@ -174,9 +187,33 @@ int64_t ExecutionEngine::GetValue(std::string name) {
     return expect_symbol->getValue();
 }
 
-void ExecutionEngine::AddIRModule(std::shared_ptr<ir::Module> ir_module) {
+void ExecutionEngine::AddIRModule(
+    std::shared_ptr<ir::Module> ir_module,
+    const std::unordered_map<std::string, std::set<std::string>>& removable_resources) {
     // host
     auto up_llvm_module = std::unique_ptr<llvm::Module>(ir_module->llvm_module);
+    for (auto& [resource_name, function_names] : removable_resources) {
+        PRAJNA_ASSERT(!_resource_tracker_dict.count(resource_name));
+        // 局部链接的值(如字符串常量)在每个拆出的模块里各有一份, 其余的值只有声明
+        llvm::ValueToValueMapTy llvm_value_map;
+        auto up_llvm_resource_module = llvm::CloneModule(
+            *up_llvm_module, llvm_value_map, [&](const llvm::GlobalValue* llvm_global_value) {
+                return llvm_global_value->hasLocalLinkage() ||
+                       function_names.count(llvm_global_value->getName().str());
+            });
+        auto resource_tracker = _up_lljit->getMainJITDylib().createResourceTracker();
+        exit_on_error(_up_lljit->addIRModule(
+            resource_tracker,
+            llvm::orc::ThreadSafeModule(std::move(up_llvm_resource_module),
+                                        std::make_unique<llvm::LLVMContext>())));
+        _resource_tracker_dict[resource_name] = resource_tracker;
+
+        for (auto& function_name : function_names) {
+            auto llvm_function = up_llvm_module->getFunction(function_name);
+            PRAJNA_ASSERT(llvm_function && !llvm_function->isDeclaration());
+            llvm_function->deleteBody();
+        }
+    }
     llvm::orc::ThreadSafeModule llvm_orc_thread_module(std::move(up_llvm_module),
                                                        std::make_unique<llvm::LLVMContext>());
     exit_on_error(_up_lljit->addIRModule(std::move(llvm_orc_thread_module)));
@@ -245,6 +282,13 @@ void ExecutionEngine::AddIRModule(std::shared_ptr<ir::Module> ir_module) {
     }
 }
 
+void ExecutionEngine::RemoveResource(const std::string& resource_name) {
+    auto iter_resource_tracker = _resource_tracker_dict.find(resource_name);
+    PRAJNA_ASSERT(iter_resource_tracker != _resource_tracker_dict.end());
+    exit_on_error(iter_resource_tracker->second->remove());
+    _resource_tracker_dict.erase(iter_resource_tracker);
+}
+
 void ExecutionEngine::BindCFunction(void *fun_ptr, std::string mangle_name) {
     llvm::orc::SymbolMap fun_symbol;
     auto fun_addr = llvm::orc::ExecutorAddr::fromPtr(fun_ptr);
@@ -253,11 +297,12 @@ void ExecutionEngine::BindCFunction(void *fun_ptr, std::string mangle_name) {
     exit_on_error(_up_lljit->getMainJITDylib().define(llvm::orc::absoluteSymbols(fun_symbol)));
 }
 
-void ExecutionEngine::CatchRuntimeError() {
-    auto error = setjmp(buf);
-    if (error != 0) {
+void ExecutionEngine::RunFunction(int64_t function_address) {
+    // setjmp必须和函数的调用在同一个栈帧里, longjmp只能回到尚未返回的栈帧
+    if (setjmp(buf) != 0) {
         throw RuntimeError();
     }
+    reinterpret_cast<void (*)(void)>(function_address)();
 }
 
 void ExecutionEngine::BindBuiltinFunction() {
@@ -270,6 +315,7 @@ void ExecutionEngine::BindBuiltinFunction() {
     this->BindCFunction(reinterpret_cast<void *>(input_c), "::bindings::input");
 
     this->BindCFunction(reinterpret_cast<void *>(print_i64_i64), "::bindings::print_i64_i64");
+    this->BindCFunction(reinterpret_cast<void *>(parallel_for_c), "::bindings::parallel_for");
 
 #if defined(__linux__) || defined(WIN32)
     this->BindCFunction(reinterpret_cast<void *>(__truncdfhf2), "__truncdfhf2");
@@ -2,7 +2,11 @@
 #pragma once
 
 #include <memory>
+#include <set>
 #include <string>
+#include <unordered_map>
+
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
 
 namespace prajna::ir {
 class Module;
@@ -10,6 +14,7 @@ class Module;
 
 namespace llvm::orc {
 class LLJIT;
+class ResourceTracker;
 }
 
 namespace prajna::jit {
@@ -18,20 +23,32 @@ class ExecutionEngine {
    public:
     ExecutionEngine();
 
+    ~ExecutionEngine();
+
     int64_t GetValue(std::string name);
 
-    void AddIRModule(std::shared_ptr<ir::Module> ir_module);
+    /// @param removable_resources 从模块里拆出来单独管理的函数定义, 键为资源名, 值为函数的符号名.
+    /// 每个资源之后可由RemoveResource单独释放, 模块里其余的定义不会被释放
+    void AddIRModule(
+        std::shared_ptr<ir::Module> ir_module,
+        const std::unordered_map<std::string, std::set<std::string>>& removable_resources = {});
+
+    /// @brief 释放资源的JIT代码, 调用者需保证其中的符号不会再被使用
+    void RemoveResource(const std::string& resource_name);
 
     bool LoadDynamicLib(std::string lib_name);
 
     void BindCFunction(void* fun_ptr, std::string mangle_name);
 
-    void CatchRuntimeError();
+    /// @brief 执行JIT里的函数, 运行时错误(如exit)会longjmp回到本函数并抛出RuntimeError
+    void RunFunction(int64_t function_address);
 
     void BindBuiltinFunction();
 
    private:
     std::shared_ptr<llvm::orc::LLJIT> _up_lljit;
+    std::unordered_map<std::string, llvm::IntrusiveRefCntPtr<llvm::orc::ResourceTracker>>
+        _resource_tracker_dict;
 };
 
 }  // namespace prajna::jit
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace prajna::jit {
+
+/// @brief @parallel循环的运行时. 迭代区间先按线程均分,
+/// dynamic调度时线程做完自己的区间后会从其他线程的剩余区间尾部窃取一半
+class ThreadPool {
+   public:
+    using RangeFunction = void (*)(void *context, int64_t first, int64_t last);
+
+    enum Schedule : int64_t { Static = 0, Dynamic = 1 };
+
+    static ThreadPool &Instance() {
+        static ThreadPool thread_pool;
+        return thread_pool;
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _start_condition.notify_all();
+        for (auto &worker : _workers) {
+            worker.join();
+        }
+    }
+
+    int64_t ThreadCount() const { return static_cast<int64_t>(_workers.size()) + 1; }
+
+    void ParallelFor(int64_t first, int64_t last, int64_t grain_size, int64_t schedule,
+                     RangeFunction function, void *context) {
+        if (first >= last) return;
+
+        if (grain_size <= 0) {
+            grain_size = std::max<int64_t>((last - first) / (ThreadCount() * 8), 1);
+        }
+        // 嵌套的并行循环直接在当前线程执行, 避免等待自身所在的线程池
+        if (_is_worker || ThreadCount() == 1 || last - first <= grain_size) {
+            function(context, first, last);
+            return;
+        }
+
+        // 宿主程序的多个线程可能同时发起并行循环
+        std::lock_guard<std::mutex> dispatch_lock(_dispatch_mutex);
+
+        auto job = std::make_shared<Job>(ThreadCount());
+        job->function = function;
+        job->context = context;
+        job->grain_size = grain_size;
+        job->schedule = schedule;
+        auto size = last - first;
+        for (int64_t i = 0; i < ThreadCount(); ++i) {
+            job->ranges[i].first = first + size * i / ThreadCount();
+            job->ranges[i].last = first + size * (i + 1) / ThreadCount();
+        }
+        job->pending = ThreadCount();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _job = job;
+            ++_generation;
+        }
+        _start_condition.notify_all();
+
+        // 当前线程作为0号线程参与执行
+        _is_worker = true;
+        this->Run(*job, 0);
+        _is_worker = false;
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done_condition.wait(lock, [&]() { return job->pending == 0; });
+        _job = nullptr;
+    }
+
+   private:
+    struct Range {
+        std::mutex mutex;
+        int64_t first = 0;
+        int64_t last = 0;
+    };
+
+    struct Job {
+        explicit Job(int64_t thread_count) : ranges(thread_count) {}
+
+        RangeFunction function = nullptr;
+        void *context = nullptr;
+        int64_t grain_size = 1;
+        int64_t schedule = Dynamic;
+        std::vector<Range> ranges;
+        std::atomic<int64_t> pending = 0;
+    };
+
+    ThreadPool() {
+        auto thread_count = std::max<int64_t>(std::thread::hardware_concurrency(), 1);
+        for (int64_t i = 1; i < thread_count; ++i) {
+            _workers.emplace_back([this, i]() { this->WorkerLoop(i); });
+        }
+    }
+
+    void WorkerLoop(int64_t id) {
+        _is_worker = true;
+        uint64_t generation = 0;
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _start_condition.wait(lock,
+                                      [&]() { return _stop || _generation != generation; });
+                if (_stop) return;
+                generation = _generation;
+                job = _job;
+            }
+
+            this->Run(*job, id);
+        }
+    }
+
+    void Run(Job &job, int64_t id) {
+        auto &own_range = job.ranges[id];
+        if (job.schedule == Static) {
+            if (own_range.first < own_range.last) {
+                job.function(job.context, own_range.first, own_range.last);
+            }
+        } else {
+            do {
+                this->RunOwnRange(job, own_range);
+            } while (this->Steal(job, id));
+        }
+
+        if (job.pending.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _done_condition.notify_all();
+        }
+    }
+
+    void RunOwnRange(Job &job, Range &own_range) {
+        while (true) {
+            int64_t first, last;
+            {
+                std::lock_guard<std::mutex> lock(own_range.mutex);
+                if (own_range.first >= own_range.last) return;
+                first = own_range.first;
+                last = std::min(first + job.grain_size, own_range.last);
+                own_range.first = last;
+            }
+            job.function(job.context, first, last);
+        }
+    }
+
+    /// @return 是否窃取到了迭代, 窃取到的迭代放入自己的区间
+    bool Steal(Job &job, int64_t id) {
+        auto thread_count = static_cast<int64_t>(job.ranges.size());
+        for (int64_t i = 1; i < thread_count; ++i) {
+            auto &victim_range = job.ranges[(id + i) % thread_count];
+            int64_t first, last;
+            {
+                std::lock_guard<std::mutex> lock(victim_range.mutex);
+                auto remain = victim_range.last - victim_range.first;
+                if (remain <= 0) continue;
+                first = remain > job.grain_size ? victim_range.first + remain / 2
+                                                : victim_range.first;
+                last = victim_range.last;
+                victim_range.last = first;
+            }
+
+            auto &own_range = job.ranges[id];
+            std::lock_guard<std::mutex> lock(own_range.mutex);
+            own_range.first = first;
+            own_range.last = last;
+            return true;
+        }
+
+        return false;
+    }
+
+   private:
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::mutex _dispatch_mutex;
+    std::condition_variable _start_condition;
+    std::condition_variable _done_condition;
+    std::shared_ptr<Job> _job = nullptr;
+    uint64_t _generation = 0;
+    bool _stop = false;
+
+    inline static thread_local bool _is_worker = false;
+};
+
+}  // namespace prajna::jit
@@ -9,6 +9,7 @@
 #include "prajna/ast/ast.hpp"
 #include "prajna/compiler/compiler.h"
 #include "prajna/exception.hpp"
+#include "prajna/source_manager.hpp"
 
 namespace prajna {
 
@@ -58,12 +59,16 @@ class Logger {
     Logger() = default;
 
    public:
-    static std::shared_ptr<Logger> Create(std::string code) {
+    static std::shared_ptr<Logger> Create(std::shared_ptr<SourceBuffer> source_buffer) {
         std::shared_ptr<Logger> self(new Logger);
-        boost::split(self->_code_lines, code, boost::is_any_of("\n"));
+        self->_source_buffer = source_buffer;
         return self;
     }
 
+    static std::shared_ptr<Logger> Create(std::string code) {
+        return Create(SourceBuffer::Create(std::move(code), ""));
+    }
+
     void Log(std::string message, ast::SourcePosition first_position,
              ast::SourcePosition last_position, std::string prompt, fmt::color locator_color,
              bool throw_error) {
@@ -87,7 +92,7 @@ class Logger {
         }
 
         for (int64_t i = first_position.line; i <= last_position.line; ++i) {
-            std::string line = _code_lines[i - 1];
+            std::string line(_source_buffer->Line(i));
 
             if (first_position.line == last_position.line) {
                 size_t start_col =
@@ -173,7 +178,7 @@ class Logger {
     }
 
    private:
-    std::vector<std::string> _code_lines;
+    std::shared_ptr<SourceBuffer> _source_buffer;
 };
 
 }  // namespace prajna
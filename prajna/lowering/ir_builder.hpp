@@ -86,17 +86,11 @@ class IrBuilder {
         return ir_type->template_struct == ptr_template_struct;
     }
 
-    Symbol GetSymbolByPath(bool root_optional, std::vector<std::string> names) {
+    Symbol GetSymbolByPath(bool root_optional, const std::vector<std::string>& names) {
         PRAJNA_ASSERT(this->symbol_table);
         auto tmp_symbol_table =
             root_optional ? this->symbol_table->RootSymbolTable() : this->symbol_table;
-        for (int64_t i = 0; i < names.size() - 1; ++i) {
-            tmp_symbol_table = SymbolGet<SymbolTable>(tmp_symbol_table->Get(names[i]));
-            if (!tmp_symbol_table) {
-                return nullptr;
-            }
-        }
-        return tmp_symbol_table->Get(names.back());
+        return tmp_symbol_table->GetByPath(names);
     }
 
     std::shared_ptr<ir::Type> GetArrayType(std::shared_ptr<ir::Type> ir_type, int64_t length) {
@@ -11,6 +11,7 @@
 #include "boost/process/v1/system.hpp"
 #include "prajna/compiler/compiler.h"
 #include "prajna/jit/execution_engine.h"
+#include "prajna/source_manager.hpp"
 
 namespace prajna::lowering {
 
@@ -85,12 +86,11 @@ Symbol StatementLoweringVisitor::operator()(ast::Use ast_import) {
                                 new_symbol_table->name = identifier;
                                 auto package_path = *package_path_optional;
                                 if (!std::filesystem::is_directory(package_path)) {
-                                    std::ifstream ifs(package_path.string());
-                                    PRAJNA_ASSERT(ifs.good());
-                                    std::string code((std::istreambuf_iterator<char>(ifs)),
-                                                     std::istreambuf_iterator<char>());
-                                    this->compiler->CompileCode(code, new_symbol_table,
-                                                                package_path.string(), false);
+                                    auto source_buffer =
+                                        compiler->source_manager->LoadFile(package_path);
+                                    PRAJNA_ASSERT(source_buffer);
+                                    this->compiler->CompileCode(source_buffer, new_symbol_table,
+                                                                false);
                                 }
                                 return new_symbol_table;
                             } else {
@@ -110,13 +110,12 @@ Symbol StatementLoweringVisitor::operator()(ast::Use ast_import) {
                                             new_symbol_table->name = identifier;
                                             auto package_path = *global_package_path_option;
                                             if (!std::filesystem::is_directory(package_path)) {
-                                                std::ifstream ifs(package_path.string());
-                                                PRAJNA_ASSERT(ifs.good());
-                                                std::string code(
-                                                    (std::istreambuf_iterator<char>(ifs)),
-                                                    std::istreambuf_iterator<char>());
-                                                this->compiler->CompileCode(code, new_symbol_table,
-                                                                            package_path.string(),
+                                                auto source_buffer =
+                                                    compiler->source_manager->LoadFile(
+                                                        package_path);
+                                                PRAJNA_ASSERT(source_buffer);
+                                                this->compiler->CompileCode(source_buffer,
+                                                                            new_symbol_table,
                                                                             false);
                                             }
                                             return new_symbol_table;
@@ -167,7 +166,7 @@ Symbol StatementLoweringVisitor::operator()(ast::Use ast_import) {
                     // 如果符号存在且不是同一个符号报错
                     if (ir_builder->symbol_table->CurrentTableHas(id)) {
                         if (ir_builder->symbol_table->Get(id) != tmp_symbol) {
-                            logger->Error(fmt::format("{} has defined", id),
+                            logger->Error(fmt::format("{} has defined", *id),
                                           *ast_import.star_match_optional);
                         }
                     } else {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cctype>
 
 #include "boost/range/combine.hpp"
 #include "boost/scope/scope_fail.hpp"
@@ -415,6 +416,35 @@ class StatementLoweringVisitor : public std::enable_shared_from_this<StatementLo
         return false;
     }
 
+    /// @brief @borrow标注的参数由调用方持有, 函数内不对其__copy__/__finalize__,
+    /// 没有指定参数名时借用全部参数
+    void ApplyBorrowAnnotation(std::shared_ptr<ir::Function> ir_function,
+                               ast::FunctionHeader ast_function_header) {
+        auto borrowed_names = ir_function->annotation_dict["borrow"];
+        for (auto borrowed_name : borrowed_names) {
+            if (std::ranges::none_of(ast_function_header.parameters,
+                                     [=](ast::Parameter ast_parameter) {
+                                         return ast_parameter.name == borrowed_name;
+                                     })) {
+                logger->Error(fmt::format("{} is not a parameter", borrowed_name),
+                              ast_function_header.annotation_dict);
+            }
+        }
+
+        auto iter_parameter = ir_function->parameters.begin();
+        // this-pointer是指针, 本身不涉及引用计数
+        if (ir_builder->IsBuildingMemberfunction()) {
+            ++iter_parameter;
+        }
+        for (auto ast_parameter : ast_function_header.parameters) {
+            if (borrowed_names.empty() ||
+                std::ranges::count(borrowed_names, std::string(ast_parameter.name))) {
+                (*iter_parameter)->is_borrowed = true;
+            }
+            ++iter_parameter;
+        }
+    }
+
     std::shared_ptr<ir::Function> ApplyFunctionHeader(ast::FunctionHeader ast_function_header) {
         std::shared_ptr<ir::Type> return_type;
         if (ast_function_header.return_type_optional) {
@@ -433,6 +463,9 @@ class StatementLoweringVisitor : public std::enable_shared_from_this<StatementLo
 
         auto ir_function = ir_builder->CreateFunction(ast_function_header.name, ir_function_type);
         ir_function->annotation_dict = this->ApplyAnnotations(ast_function_header.annotation_dict);
+        if (ir_function->annotation_dict.count("borrow")) {
+            this->ApplyBorrowAnnotation(ir_function, ast_function_header);
+        }
 
         // 加入interface里
         if (ir_builder->current_implement_interface) {
@@ -644,6 +677,20 @@ class StatementLoweringVisitor : public std::enable_shared_from_this<StatementLo
         }
 
         ir_for->annotation_dict = ApplyAnnotations(ast_for.annotation_dict);
+        for (auto ast_annotation : ast_for.annotation_dict) {
+            if (ast_annotation.name != "parallel") continue;
+            for (auto ast_value : ast_annotation.values) {
+                std::string value = ast_value.value;
+                if (value != "static" && value != "dynamic" &&
+                    (value.empty() || !std::ranges::all_of(value, [](char c) {
+                         return std::isdigit(static_cast<unsigned char>(c)) != 0;
+                     }))) {
+                    logger->Error(
+                        "the parallel annotation expects \"static\", \"dynamic\" or a grain size",
+                        ast_annotation);
+                }
+            }
+        }
 
         return ir_for;
     }
@@ -771,6 +818,8 @@ class StatementLoweringVisitor : public std::enable_shared_from_this<StatementLo
                 std::string("dynamic_type_creator"),
                 ir::FunctionType::Create({ir_builder->GetManagedPtrType(ir_type)},
                                          ir_interface->prototype->dynamic_type));
+            // 去虚化据此确定Dynamic的值来自哪个实现
+            ir_interface->dynamic_type_creator->annotation_dict["dynamic_type_creator"];
 
             auto is_matched_with_prototype =
                 [](std::shared_ptr<ir::FunctionType> ir_function_type0,
@@ -866,6 +915,30 @@ class StatementLoweringVisitor : public std::enable_shared_from_this<StatementLo
                 ir_builder->PopBlock();
             }
 
+            // 每个(接口, 实现)共享一个只读的虚表, 动态类型里只存储对象指针和虚表地址
+            auto ir_vtable =
+                ir::GlobalVariable::Create(ir_interface->prototype->vtable_type);
+            ir_vtable->Name("vtable");
+            ir_vtable->Fullname(ConcatFullname(ir_interface->Fullname(), "vtable"));
+            for (auto ir_prototype_function : ir_interface_prototype->functions) {
+                auto iter_function = std::ranges::find_if(ir_interface->functions, [=](auto x) {
+                    return x->Name() == ir_prototype_function->Name();
+                });
+                PRAJNA_ASSERT(iter_function != ir_interface->functions.end());
+                ir_vtable->initialize_functions.push_back(
+                    ir_interface->undef_this_pointer_functions[*iter_function]);
+            }
+            ir_builder->module->AddGlobalVariable(ir_vtable);
+
+            // 其他模块通过该函数获取虚表地址, 而非直接引用本模块的全局变量
+            ir_interface->vtable_getter = ir_builder->CreateFunction(
+                std::string("vtable_getter"),
+                ir::FunctionType::Create(
+                    {}, ir::PointerType::Create(ir_interface->prototype->vtable_type)));
+            ir_builder->CreateTopBlockForFunction(ir_interface->vtable_getter);
+            ir_builder->Create<ir::Return>(ir_builder->GetAddressOf(ir_vtable));
+            ir_builder->PopBlock();
+
             ir_builder->CreateTopBlockForFunction(ir_interface->dynamic_type_creator);
 
             auto ir_self =
@@ -875,22 +948,8 @@ class StatementLoweringVisitor : public std::enable_shared_from_this<StatementLo
                 ir_builder->CallMemberFunction(
                     ir_interface->dynamic_type_creator->parameters.front(), "ToUndef", {}),
                 ir_builder->AccessField(ir_self, "object_pointer"));
-            for (auto ir_function : ir_interface->functions) {
-                if (std::ranges::none_of(ir_interface_prototype->functions, [=](auto x) {
-                        return x->Name() == ir_function->Name();
-                    })) {
-                    continue;
-                }
-
-                auto iter_field = std::ranges::find_if(
-                    ir_interface->prototype->dynamic_type->fields,
-                    [=](auto ir_field) { return ir_field->name == ir_function->Name() + "/fp"; });
-                PRAJNA_ASSERT(iter_field != ir_interface->prototype->dynamic_type->fields.end());
-                auto ir_function_pointer =
-                    ir_builder->Create<ir::AccessField>(ir_self, *iter_field);
-                ir_builder->Create<ir::WriteVariableLiked>(
-                    ir_interface->undef_this_pointer_functions[ir_function], ir_function_pointer);
-            }
+            ir_builder->Create<ir::WriteVariableLiked>(ir_builder->GetAddressOf(ir_vtable),
+                                                       ir_builder->AccessField(ir_self, "vtable"));
             ir_builder->Create<ir::Return>(ir_self);
             ir_builder->PopBlock();
         } catch (CompileError compile_error) {
@@ -1466,9 +1525,8 @@ class StatementLoweringVisitor : public std::enable_shared_from_this<StatementLo
                 logger->Error("invalid dynamic Cast, operand is not a interface dynamic type");
             }
             auto ir_interface_implement = iter_interface_implement->second;
-            // interface implement必然有一个函数, 我们通过该函数来判断dynamic
-            // type是否是某一个具体类型
-            PRAJNA_ASSERT(ir_interface_implement->functions.front());
+            // 虚表地址唯一对应一个具体类型的实现
+            PRAJNA_ASSERT(ir_interface_implement->vtable_getter);
 
             auto ir_tmp_builder = IrBuilder::Create(symbol_table, ir_module, logger);
             auto ir_pointer_type = ir_tmp_builder->GetManagedPtrType(ir_target_value_type);
@@ -1483,22 +1541,19 @@ class StatementLoweringVisitor : public std::enable_shared_from_this<StatementLo
 
             auto ir_target_ptr_type = ir_tmp_builder->GetManagedPtrType(ir_target_value_type);
             auto ir_ptr = ir_tmp_builder->Create<ir::LocalVariable>(ir_target_ptr_type);
-            auto ir_interface_implement_function0 =
-                ir_interface_implement
-                    ->undef_this_pointer_functions[ir_interface_implement->functions.front()];
+            auto ir_vtable_pointer = ir_tmp_builder->Call(ir_interface_implement->vtable_getter);
 
             auto template_cast =
                 SymbolGet<Template>(ir_tmp_builder->GetSymbolByPath(true, {"cast"}));
             auto ir_rawptr_to_i64_cast_function = SymbolGet<ir::Value>(template_cast->Instantiate(
-                {ir_interface_implement_function0->type, ir::i64}, ir_tmp_builder->module));
-            auto ir_rawptr_i64_0 = ir_tmp_builder->Call(ir_rawptr_to_i64_cast_function,
-                                                        ir_interface_implement_function0);
+                {ir_vtable_pointer->type, ir::i64}, ir_tmp_builder->module));
+            auto ir_rawptr_i64_0 =
+                ir_tmp_builder->Call(ir_rawptr_to_i64_cast_function, ir_vtable_pointer);
 
             auto ir_dynamic_object = ir_function->parameters.front();
-            auto ir_rawptr_i64_1 = ir_tmp_builder->Call(
-                ir_rawptr_to_i64_cast_function,
-                ir_tmp_builder->AccessField(
-                    ir_dynamic_object, ir_interface_implement->functions.front()->Name() + "/fp"));
+            auto ir_rawptr_i64_1 =
+                ir_tmp_builder->Call(ir_rawptr_to_i64_cast_function,
+                                     ir_tmp_builder->AccessField(ir_dynamic_object, "vtable"));
             auto ir_condition =
                 ir_tmp_builder->CallBinaryOperator(ir_rawptr_i64_0, "==", ir_rawptr_i64_1);
             auto ir_if = ir_tmp_builder->Create<ir::If>(ir_condition, ir::Block::Create(),
@@ -1555,9 +1610,8 @@ class StatementLoweringVisitor : public std::enable_shared_from_this<StatementLo
                 logger->Error("invalid dynamic Cast, operand is not a interface dynamic type");
             }
             auto ir_interface_implement = iter_interface_implement->second;
-            // interface implement必然有一个函数, 我们通过该函数来判断dynamic
-            // type是否是某一个具体类型
-            PRAJNA_ASSERT(ir_interface_implement->functions.front());
+            // 虚表地址唯一对应一个具体类型的实现
+            PRAJNA_ASSERT(ir_interface_implement->vtable_getter);
 
             auto ir_tmp_builder = IrBuilder::Create(symbol_table, ir_module, logger);
             auto ir_pointer_type = ir_tmp_builder->GetManagedPtrType(ir_target_value_type);
@@ -1572,22 +1626,19 @@ class StatementLoweringVisitor : public std::enable_shared_from_this<StatementLo
 
             auto ir_target_ptr_type = ir_tmp_builder->GetManagedPtrType(ir_target_value_type);
             auto ir_ptr = ir_tmp_builder->Create<ir::LocalVariable>(ir_target_ptr_type);
-            auto ir_interface_implement_function0 =
-                ir_interface_implement
-                    ->undef_this_pointer_functions[ir_interface_implement->functions.front()];
+            auto ir_vtable_pointer = ir_tmp_builder->Call(ir_interface_implement->vtable_getter);
 
             auto template_cast =
                 SymbolGet<Template>(ir_tmp_builder->GetSymbolByPath(true, {"cast"}));
             auto ir_rawptr_to_i64_cast_function = SymbolGet<ir::Value>(template_cast->Instantiate(
-                {ir_interface_implement_function0->type, ir::i64}, ir_tmp_builder->module));
-            auto ir_rawptr_i64_0 = ir_tmp_builder->Call(ir_rawptr_to_i64_cast_function,
-                                                        ir_interface_implement_function0);
+                {ir_vtable_pointer->type, ir::i64}, ir_tmp_builder->module));
+            auto ir_rawptr_i64_0 =
+                ir_tmp_builder->Call(ir_rawptr_to_i64_cast_function, ir_vtable_pointer);
 
             auto ir_dynamic_object = ir_function->parameters.front();
-            auto ir_rawptr_i64_1 = ir_tmp_builder->Call(
-                ir_rawptr_to_i64_cast_function,
-                ir_tmp_builder->AccessField(
-                    ir_dynamic_object, ir_interface_implement->functions.front()->Name() + "/fp"));
+            auto ir_rawptr_i64_1 =
+                ir_tmp_builder->Call(ir_rawptr_to_i64_cast_function,
+                                     ir_tmp_builder->AccessField(ir_dynamic_object, "vtable"));
             auto ir_condition =
                 ir_tmp_builder->CallBinaryOperator(ir_rawptr_i64_0, "==", ir_rawptr_i64_1);
             ir_tmp_builder->Create<ir::Return>(ir_condition);
@@ -2467,6 +2518,14 @@ class StatementLoweringVisitor : public std::enable_shared_from_this<StatementLo
         ir_interface_struct->Name(ir_interface_prototype->Name());
         ir_interface_struct->Fullname(ir_interface_prototype->Fullname());
 
+        auto ir_vtable_type = ir::StructType::Create({});
+        ir_vtable_type->Name(ir_interface_prototype->Name() + "::vtable");
+        ir_vtable_type->Fullname(ConcatFullname(ir_interface_prototype->Fullname(), "vtable"));
+        ir_interface_prototype->vtable_type = ir_vtable_type;
+        auto field_vtable = ir::Field::Create("vtable", ir::PointerType::Create(ir_vtable_type));
+        ir_interface_struct->fields.push_back(field_vtable);
+        ir_interface_struct->Update();
+
         PRAJNA_ASSERT(!ir_builder->current_implement_type);
         ir_builder->current_implement_type = ir_interface_struct;
 
@@ -2480,8 +2539,8 @@ class StatementLoweringVisitor : public std::enable_shared_from_this<StatementLo
 
             auto field_function_pointer = ir::Field::Create(
                 ir_function->Name() + "/fp", ir::PointerType::Create(ir_callee_type));
-            ir_interface_struct->fields.push_back(field_function_pointer);
-            ir_interface_struct->Update();
+            ir_vtable_type->fields.push_back(field_function_pointer);
+            ir_vtable_type->Update();
 
             auto ir_member_function_argument_types = ir_function->function_type->parameter_types;
             // 必然有一个this pointer参数
@@ -2497,14 +2556,18 @@ class StatementLoweringVisitor : public std::enable_shared_from_this<StatementLo
                 ir_member_function_type);
             ir_member_function->Name(ir_function->Name());
             ir_member_function->Fullname(ir_function->Fullname());
+            ir_member_function->annotation_dict["dynamic_method"];
 
             // 这里还是使用类型IrBuilder
             ir_builder->CreateTopBlockForFunction(ir_member_function);
 
             auto ir_this_pointer = ir_member_function->parameters.front();
             // 这里叫函数指针, 函数的类型就是函数指针
+            auto ir_vtable_pointer = ir_builder->Create<ir::AccessField>(
+                ir_builder->Create<ir::DeferencePointer>(ir_this_pointer), field_vtable);
             auto ir_function_pointer = ir_builder->Create<ir::AccessField>(
-                ir_builder->Create<ir::DeferencePointer>(ir_this_pointer), field_function_pointer);
+                ir_builder->Create<ir::DeferencePointer>(ir_vtable_pointer),
+                field_function_pointer);
             // 直接将外层函数的参数转发进去, 除了第一个参数需要调整一下
             std::list<std::shared_ptr<ir::Value>> ir_arguments;
             std::ranges::transform(ir_member_function->parameters, std::back_inserter(ir_arguments),
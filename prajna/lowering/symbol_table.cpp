@@ -47,7 +47,7 @@ void Symbol::SetFullname(std::string fullname) {
 void SymbolTable::SetWithAssigningName(Symbol value, const std::string& name) {
     value.SetName(name);
     value.SetFullname(this->Fullname() + "::" + name);
-    current_symbol_dict[name] = value;
+    this->Set(value, name);
 }
 
 }  // namespace prajna::lowering
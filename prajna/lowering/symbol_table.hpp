@@ -3,9 +3,13 @@
 #include <algorithm>
 #include <filesystem>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <utility>
 #include <variant>
+#include <vector>
 
 #include "prajna/ast/ast.hpp"
 #include "prajna/helper.hpp"
@@ -59,6 +63,11 @@ inline auto SymbolGet(const Symbol& symbol) -> std::shared_ptr<_T> {
     return nullptr;
 }
 
+/// @brief 驻留后的标识符, 同名的标识符地址相同, 各级符号表只需按地址查找而无需重复计算字符串的哈希
+using SymbolKey = const std::string*;
+
+inline SymbolKey InternSymbolKey(const std::string& name) { return ir::InternString(name); }
+
 class SymbolTable : public std::enable_shared_from_this<SymbolTable> {
     SymbolTable() = default;
 
@@ -70,26 +79,78 @@ class SymbolTable : public std::enable_shared_from_this<SymbolTable> {
         return self;
     }
 
-    void Set(const Symbol& value, const std::string& name) { current_symbol_dict[name] = value; }
+    void Set(const Symbol& value, const std::string& name) {
+        this->Set(value, InternSymbolKey(name));
+    }
+
+    void Set(const Symbol& value, SymbolKey key) {
+        current_symbol_dict[key] = value;
+        ++version;
+    }
 
     void SetWithAssigningName(Symbol value, const std::string& name);
 
-    Symbol Get(const std::string& name) {
-        if (current_symbol_dict.count(name) > 0) return current_symbol_dict[name];
+    Symbol Get(const std::string& name) { return this->Get(InternSymbolKey(name)); }
 
-        if (parent_symbol_table) {
-            auto par_re = parent_symbol_table->Get(name);
-            if (!std::holds_alternative<std::nullptr_t>(par_re)) return par_re;
+    Symbol Get(SymbolKey key) {
+        for (auto tmp_symbol_table = this; tmp_symbol_table;
+             tmp_symbol_table = tmp_symbol_table->parent_symbol_table.get()) {
+            auto iter = tmp_symbol_table->current_symbol_dict.find(key);
+            if (iter != tmp_symbol_table->current_symbol_dict.end()) return iter->second;
         }
 
         return Symbol(nullptr);
     }
 
+    /// @brief 按路径逐级查找, 如{"tensor", "Layout"}. 结果按驻留后的标识符序列缓存,
+    /// 只有查找时经过的符号表被修改后缓存才失效
+    Symbol GetByPath(const std::vector<std::string>& names) {
+        PRAJNA_ASSERT(!names.empty());
+        // 复用缓冲区, 命中缓存时无需分配内存
+        path_keys_buffer.clear();
+        for (auto& name : names) {
+            path_keys_buffer.push_back(InternSymbolKey(name));
+        }
+        auto [iter_path_cache, inserted] = path_cache_dict.try_emplace(path_keys_buffer);
+        auto& path_cache = iter_path_cache->second;
+        if (!inserted && path_cache.IsValid()) return path_cache.symbol;
+
+        path_cache.dependencies.clear();
+        Symbol symbol = nullptr;
+        auto tmp_symbol_table = this->shared_from_this();
+        for (auto iter_key = path_keys_buffer.begin();; ++iter_key) {
+            symbol = tmp_symbol_table->Get(*iter_key, path_cache.dependencies);
+            if (std::next(iter_key) == path_keys_buffer.end()) break;
+
+            tmp_symbol_table = SymbolGet<SymbolTable>(symbol);
+            if (!tmp_symbol_table) {
+                symbol = nullptr;
+                break;
+            }
+        }
+
+        path_cache.symbol = symbol;
+        return symbol;
+    }
+
     bool CurrentTableHas(const std::string& name) {
-        return current_symbol_dict.count(name) > 0 ? true : false;
+        return this->CurrentTableHas(InternSymbolKey(name));
     }
 
-    Symbol CurrentTableGet(const std::string& name) { return this->current_symbol_dict[name]; }
+    bool CurrentTableHas(SymbolKey key) { return current_symbol_dict.count(key) > 0; }
+
+    /// @brief 移除当前符号表里的符号, 交互模式重新定义函数时使用
+    void Remove(const std::string& name) {
+        current_symbol_dict.erase(InternSymbolKey(name));
+        ++version;
+    }
+
+    Symbol CurrentTableGet(const std::string& name) {
+        auto [iter, inserted] = current_symbol_dict.try_emplace(InternSymbolKey(name));
+        // 插入的空符号会遮蔽上层的同名符号
+        if (inserted) ++version;
+        return iter->second;
+    }
 
     bool Has(const std::string& name) {
         auto symbol = this->Get(name);
@@ -117,6 +178,9 @@ class SymbolTable : public std::enable_shared_from_this<SymbolTable> {
 
         parent_symbol_table = nullptr;
         current_symbol_dict.clear();
+        // 缓存的符号可能引用子符号表, 需一并清除以打破循环引用
+        path_cache_dict.clear();
+        ++version;
     }
 
     std::shared_ptr<SymbolTable> RootSymbolTable() {
@@ -144,7 +208,50 @@ class SymbolTable : public std::enable_shared_from_this<SymbolTable> {
     std::string name = "";
     std::filesystem::path directory_path;
     std::shared_ptr<SymbolTable> parent_symbol_table = nullptr;
-    std::unordered_map<std::string, Symbol> current_symbol_dict;
+    std::unordered_map<SymbolKey, Symbol> current_symbol_dict;
+
+   private:
+    /// @brief 查找时经过的符号表及其当时的版本
+    using Dependencies = std::vector<std::pair<SymbolTable*, int64_t>>;
+
+    Symbol Get(SymbolKey key, Dependencies& dependencies) {
+        for (auto tmp_symbol_table = this; tmp_symbol_table;
+             tmp_symbol_table = tmp_symbol_table->parent_symbol_table.get()) {
+            dependencies.emplace_back(tmp_symbol_table, tmp_symbol_table->version);
+            auto iter = tmp_symbol_table->current_symbol_dict.find(key);
+            if (iter != tmp_symbol_table->current_symbol_dict.end()) return iter->second;
+        }
+
+        return Symbol(nullptr);
+    }
+
+    struct PathCache {
+        /// @brief 须按记录的顺序检查: 子符号表由之前的符号表持有, 之前的符号表未被修改时它必然存活
+        bool IsValid() const {
+            return std::ranges::all_of(dependencies, [](auto dependency) {
+                return dependency.first->version == dependency.second;
+            });
+        }
+
+        Dependencies dependencies;
+        Symbol symbol;
+    };
+
+    struct PathKeysHash {
+        size_t operator()(const std::vector<SymbolKey>& keys) const {
+            size_t seed = keys.size();
+            for (auto key : keys) {
+                seed ^= std::hash<SymbolKey>{}(key) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            }
+            return seed;
+        }
+    };
+
+    std::unordered_map<std::vector<SymbolKey>, PathCache, PathKeysHash> path_cache_dict;
+    std::vector<SymbolKey> path_keys_buffer;
+
+    /// @brief 本符号表的修改计数, 路径缓存据此判断是否失效
+    int64_t version = 0;
 };
 
 }  // namespace prajna::lowering
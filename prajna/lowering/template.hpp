@@ -1,6 +1,9 @@
 #pragma once
 
+#include <list>
+#include <type_traits>
 #include <unordered_map>
+#include <variant>
 
 #include "boost/range/combine.hpp"
 #include "prajna/exception.hpp"
@@ -9,17 +12,33 @@
 
 namespace std {
 
+/// @brief 和Symbol的相等比较保持一致: ConstantInt按值比较(见symbol_table.hpp), 其余按对象地址比较
 template <>
-struct hash<std::list<prajna::lowering::Symbol>> {
-    std::int64_t operator()(
-        std::list<prajna::lowering::Symbol> symbol_template_parameter_list) const noexcept {
-        return symbol_template_parameter_list.size();
+struct hash<prajna::lowering::Symbol> {
+    std::size_t operator()(const prajna::lowering::Symbol& symbol) const noexcept {
+        std::size_t value_hash = 0;
+        if (auto ir_constant_int = prajna::lowering::SymbolGet<prajna::ir::ConstantInt>(symbol)) {
+            value_hash = std::hash<int64_t>{}(ir_constant_int->value);
+        } else {
+            value_hash = std::visit(
+                [](const auto& x) { return std::hash<std::decay_t<decltype(x)>>{}(x); }, symbol);
+        }
+        return value_hash ^ (symbol.index() + 0x9e3779b97f4a7c15 + (value_hash << 6) +
+                             (value_hash >> 2));
     }
 };
 
 template <>
-struct hash<prajna::lowering::Symbol> {
-    std::int64_t operator()(prajna::lowering::Symbol symbol) const noexcept { return 1; }
+struct hash<std::list<prajna::lowering::Symbol>> {
+    std::size_t operator()(
+        const std::list<prajna::lowering::Symbol>& symbol_list) const noexcept {
+        std::size_t seed = symbol_list.size();
+        for (auto& symbol : symbol_list) {
+            seed ^= std::hash<prajna::lowering::Symbol>{}(symbol) + 0x9e3779b97f4a7c15 +
+                    (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
 };
 
 }  // namespace std
@@ -81,24 +100,37 @@ class Template : public std::enable_shared_from_this<Template> {
 
     Symbol Instantiate(std::list<Symbol> symbol_template_arguments,
                        std::shared_ptr<ir::Module> ir_module) {
-        if (!_instance_dict.count(symbol_template_arguments)) {
-            _instance_dict[symbol_template_arguments];  // 插入默认值, 阻断多次实力化,
+        // 先插入默认值, 阻断递归时的多次实例化. unordered_map的元素引用在插入后仍然有效
+        auto [iter_instance, inserted] = _instance_dict.try_emplace(symbol_template_arguments);
+        auto& instance = iter_instance->second;
+        if (!inserted) return instance;
+
+        auto function_size = ir_module ? ir_module->functions.size() : 0;
+        auto iter_special_generator = this->special_generator_dict.find(symbol_template_arguments);
+        if (iter_special_generator != this->special_generator_dict.end()) {
+            instance = iter_special_generator->second(ir_module);
+        } else {
+            instance = this->generator(symbol_template_arguments, ir_module);
+        }
 
-            if (this->special_generator_dict.count(symbol_template_arguments)) {
-                _instance_dict[symbol_template_arguments] =
-                    special_generator_dict[symbol_template_arguments](ir_module);
-            } else {
-                _instance_dict[symbol_template_arguments] =
-                    this->generator(symbol_template_arguments, ir_module);
+        // 实例化产生的函数都标注出来, 不可达的实例会在codegen前被剪除.
+        // 标注的值为模板及实参的全名, 作为实例化的键写入二进制IR, 嵌套的实例保留其自身的键
+        if (ir_module) {
+            std::list<std::string> template_instance_key = {this->Fullname()};
+            for (auto& symbol_template_argument : symbol_template_arguments) {
+                template_instance_key.push_back(symbol_template_argument.GetFullname());
             }
-
-            if (auto ir_interface_prototype =
-                    SymbolGet<ir::InterfacePrototype>(_instance_dict[symbol_template_arguments])) {
-                ir_interface_prototype->template_interface = this->shared_from_this();
-                ir_interface_prototype->template_arguments = symbol_template_arguments;
+            for (auto iter = std::next(ir_module->functions.begin(), function_size);
+                 iter != ir_module->functions.end(); ++iter) {
+                (*iter)->annotation_dict.try_emplace("template_instance", template_instance_key);
             }
         }
-        return _instance_dict[symbol_template_arguments];
+
+        if (auto ir_interface_prototype = SymbolGet<ir::InterfacePrototype>(instance)) {
+            ir_interface_prototype->template_interface = this->shared_from_this();
+            ir_interface_prototype->template_arguments = symbol_template_arguments;
+        }
+        return instance;
     }
 
    private:
@@ -141,45 +173,53 @@ class TemplateStruct : public std::enable_shared_from_this<TemplateStruct> {
     std::shared_ptr<ir::Type> Instantiate(std::list<Symbol> template_arguments,
                                           std::shared_ptr<ir::Module> ir_module,
                                           bool inside_struct = false) {
-        // imlement_is_processing会确保 struct 实例化, implement实例化顺序执行, 而不产生递归
-        if (implement_is_processing.count(template_arguments) == 0) {
-            implement_is_processing[template_arguments] = false;
+        // is_processing会确保 struct 实例化, implement实例化顺序执行, 而不产生递归
+        auto& instance = instance_dict[template_arguments];
+        // 所有implement都已实例化过, 无需再逐个查找缓存
+        if (instance.type && !instance.is_processing && !inside_struct &&
+            instance.implement_size == template_implement_type_vec.size()) {
+            return instance.type;
         }
 
-        if (!implement_is_processing[template_arguments]) {
-            implement_is_processing[template_arguments] = true;
-            struct_type_instance_dict[template_arguments] = SymbolGet<ir::Type>(
+        if (!instance.is_processing) {
+            instance.is_processing = true;
+            instance.type = SymbolGet<ir::Type>(
                 template_struct_impl->Instantiate(template_arguments, ir_module));
-            PRAJNA_ASSERT(struct_type_instance_dict[template_arguments]);
-            struct_type_instance_dict[template_arguments]->template_struct =
-                this->shared_from_this();
-            struct_type_instance_dict[template_arguments]->template_arguments_any =
-                template_arguments;
-            implement_is_processing[template_arguments] = false;
+            PRAJNA_ASSERT(instance.type);
+            instance.type->template_struct = this->shared_from_this();
+            instance.type->template_arguments_any = template_arguments;
+            instance.is_processing = false;
         }
 
         try {
-            if (!implement_is_processing[template_arguments] && !inside_struct) {
+            if (!instance.is_processing && !inside_struct) {
                 for (auto template_implement : template_implement_type_vec) {
-                    implement_is_processing[template_arguments] = true;
+                    instance.is_processing = true;
                     template_implement->Instantiate(template_arguments, ir_module);
-                    implement_is_processing[template_arguments] = false;
+                    instance.is_processing = false;
                 }
+                instance.implement_size = template_implement_type_vec.size();
             }
         } catch (CompileError compile_error) {
             // implement error is not a error
         }
 
         // 当返回nullptr时, 会使用ir_builder->instantiating_type_stack.top()去获取类型
-        return struct_type_instance_dict[template_arguments];
+        return instance.type;
     }
 
+    struct Instance {
+        std::shared_ptr<ir::Type> type = nullptr;
+        bool is_processing = false;
+        // 已实例化的implement数量, implement可能在结构体实例化后才定义
+        size_t implement_size = 0;
+    };
+
     std::shared_ptr<Template> template_struct_impl = nullptr;
     std::vector<std::shared_ptr<Template>> template_implement_type_vec;
 
-    std::unordered_map<std::list<Symbol>, bool> implement_is_processing;
-
-    std::unordered_map<std::list<Symbol>, std::shared_ptr<ir::Type>> struct_type_instance_dict;
+    /// @brief 结构体实例及其是否正在实例化, 两者共用一次查找
+    std::unordered_map<std::list<Symbol>, Instance> instance_dict;
 };
 
 inline std::string GetTemplateArgumentsPostify(std::list<Symbol> symbol_list) {
@@ -36,7 +36,8 @@ inline ast::SourcePosition GetLastIteratorPosition(Iterator_ first_iter, Iterato
 
 template <typename Iterator_>
 struct ErrorHandler {
-    ErrorHandler(std::shared_ptr<Logger> logger) { this->logger = logger; }
+    /// @param logger 引用解析时使用的logger, 语法对象被复用, 其在每次解析前被替换
+    ErrorHandler(const std::shared_ptr<Logger>& logger) : logger(&logger) {}
 
     /// @brief
     /// @param first
@@ -53,19 +54,19 @@ struct ErrorHandler {
         ss << what;
 
         std::string rule_name = what.tag == "token_def" ? ss.str() : "\"" + what.tag + "\"";
-        logger->Error(fmt::format("expect a {}", rule_name), last_pos1, last_pos2,
+        (*logger)->Error(fmt::format("expect a {}", rule_name), last_pos1, last_pos2,
                       fmt::color::blue);
     }
 
    private:
-    std::shared_ptr<Logger> logger;
+    const std::shared_ptr<Logger>* logger;
 };
 
 // @note on_success存在多次重复调用的问题, 如break会在多个rule里触发(break_,
 // statement等),所以其位置最后会包含';'
 template <typename Iterator_>
 struct SuccessHandler {
-    SuccessHandler(std::shared_ptr<Logger> logger) { this->logger = logger; }
+    SuccessHandler(const std::shared_ptr<Logger>& logger) : logger(&logger) {}
 
     void operator()(Iterator_ first_iter, Iterator_ input_last_iter, Iterator_ last_iter,
                     ast::SourceLocation& ast_source_location) const {
@@ -117,7 +118,7 @@ struct SuccessHandler {
 
     void operator()(Iterator_ first_iter, Iterator_ input_last_iter, Iterator_ last_iter,
                     ast::Statements& attribute) const {
-        CodeLexerType tokens;
+        auto& tokens = GetCodeLexer();
         auto skip = boost::spirit::qi::in_state("WS")[tokens.self];
         using boost::spirit::qi::unused;
         // boost::spirit::qi::skip_over(last_iter, input_last_iter, skipper);
@@ -131,12 +132,12 @@ struct SuccessHandler {
             auto pos1 = GetFirstIteratorPosition(last_iter);
             auto pos2 = pos1;
             pos2.column = pos1.column + 1;
-            logger->Error("expect a \"statement\"", pos1, pos2, fmt::color::red);
+            (*logger)->Error("expect a \"statement\"", pos1, pos2, fmt::color::red);
         }
     }
 
    private:
-    std::shared_ptr<Logger> logger;
+    const std::shared_ptr<Logger>* logger;
 };
 
 }  // namespace prajna::parser::grammar
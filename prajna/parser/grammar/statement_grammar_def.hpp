@@ -148,7 +148,7 @@ StatementGrammer<Iterator, Lexer>::StatementGrammer(const Lexer &tok,
     on_success(implement_type, success_handler_function);
 
     functions.name("functions");
-    functions = tok.left_braces > +function > tok.r_braces;
+    functions = tok.left_braces > *function > tok.r_braces;
     on_error<fail>(functions, error_handler_function);
     on_success(functions, success_handler_function);
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string_view>
+
 #include "boost/spirit/home/classic/iterator/position_iterator.hpp"
 #include "boost/spirit/home/support/multi_pass.hpp"
 #include "prajna/parser/lexer/code_lexer.h"
@@ -8,8 +10,8 @@ namespace prajna::parser {
 namespace lex = boost::spirit::lex;
 namespace spirit = boost::spirit;
 
-// @brief 输入到词法解析里的迭代器类型, 其会将string包裹上位置信息
-typedef spirit::classic::position_iterator2<std::string::iterator> base_iterator_type;
+// @brief 输入到词法解析里的迭代器类型, 其会将源码包裹上位置信息. 源码可能是mmap映射的只读内存
+typedef spirit::classic::position_iterator2<std::string_view::const_iterator> base_iterator_type;
 
 // @brief 词法解析器的token类型
 typedef lex::lexertl::position_token<
@@ -24,4 +26,12 @@ typedef lex::lexertl::lexer<TokenType> LexertlLexer;
 // @brief 词法解析的具体类型
 typedef prajna::parser::CodeLexer<LexertlLexer> CodeLexerType;
 typedef CodeLexerType::iterator_type iterator_type;
+
+/// @brief 全局共用的词法解析器. lexertl在第一次解析时才构建DFA, 之后的解析复用它而不再重新构建
+/// @note 解析只在编译线程里进行, 故没有加锁
+inline CodeLexerType& GetCodeLexer() {
+    // 故意不析构, 和ir::NodeArena一样避免全局对象的析构顺序问题
+    static auto code_lexer = new CodeLexerType;
+    return *code_lexer;
+}
 }  // namespace prajna::parser
@@ -1,26 +1,35 @@
 #include "prajna/parser/parse.h"
 
 #include "boost/spirit/home/classic/iterator/position_iterator.hpp"
+#include "prajna/assert.hpp"
 #include "prajna/config.hpp"
 #include "prajna/exception.hpp"
+#include "prajna/global_config.hpp"
 #include "prajna/helper.hpp"
 #include "prajna/parser/grammar/statement_grammar.h"
 #include "prajna/parser/lexer/code_lexer_config.hpp"
+#include "prajna/parser/recursive_descent/parser.h"
 
 namespace prajna::parser {
 
-bool parse(std::string code, prajna::ast::Statements& ast, std::string file_name,
-           std::shared_ptr<Logger> logger) {
-    grammar::ErrorHandler<iterator_type> error_handler(logger);
-    grammar::SuccessHandler<iterator_type> success_handler(logger);
-    CodeLexerType tokens;
+namespace {
+
+bool qi_parse(std::string_view code, prajna::ast::Statements& ast, std::string file_name,
+              std::shared_ptr<Logger> logger) {
+    auto& tokens = GetCodeLexer();
     base_iterator_type first(code.begin(), code.end(), file_name);
     base_iterator_type last;
     iterator_type iter = tokens.begin(first, last);
     iterator_type end = tokens.end();
 
-    prajna::parser::grammar::StatementGrammer<iterator_type, CodeLexerType> statement_grammar(
+    // 语法的构造要建立所有的规则, 开销不小, 故所有的解析共用一个语法对象, 只替换其使用的logger
+    static std::shared_ptr<Logger> current_logger = nullptr;
+    static grammar::ErrorHandler<iterator_type> error_handler(current_logger);
+    static grammar::SuccessHandler<iterator_type> success_handler(current_logger);
+    static grammar::StatementGrammer<iterator_type, CodeLexerType> statement_grammar(
         tokens, error_handler, success_handler);
+    current_logger = logger;
+    auto reset_logger = ScopeExit::Create([]() { current_logger = nullptr; });
 
     try {
         auto skip = boost::spirit::qi::in_state("WS")[tokens.self];
@@ -33,7 +42,35 @@ bool parse(std::string code, prajna::ast::Statements& ast, std::string file_name
     }
 }
 
-std::shared_ptr<prajna::ast::Statements> parse(std::string code, std::string file_name,
+}  // namespace
+
+ParserKind GetParserKind() {
+    auto parser_str = GlobalConfig::Instance().get<std::string>("prajna.parser", "qi");
+    if (parser_str == "qi") return ParserKind::qi;
+    if (parser_str == "recursive_descent") return ParserKind::recursive_descent;
+    PRAJNA_VERIFY(false, "prajna.parser should be qi or recursive_descent");
+    return ParserKind::qi;
+}
+
+bool parse(std::string_view code, prajna::ast::Statements& ast, std::string file_name,
+           std::shared_ptr<Logger> logger, ParserKind parser_kind) {
+    switch (parser_kind) {
+        case ParserKind::qi:
+            return qi_parse(code, ast, std::move(file_name), logger);
+        case ParserKind::recursive_descent:
+            return recursive_descent::parse(code, ast, std::move(file_name), logger);
+    }
+
+    PRAJNA_UNREACHABLE;
+    return false;
+}
+
+bool parse(std::string_view code, prajna::ast::Statements& ast, std::string file_name,
+           std::shared_ptr<Logger> logger) {
+    return parse(code, ast, std::move(file_name), logger, GetParserKind());
+}
+
+std::shared_ptr<prajna::ast::Statements> parse(std::string_view code, std::string file_name,
                                                std::shared_ptr<Logger> logger) {
     auto ast = std::make_shared<prajna::ast::Statements>();
     auto re = parse(code, *ast, file_name, logger);
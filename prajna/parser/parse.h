@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 
 #include "prajna/ast/ast.hpp"
 
@@ -11,10 +12,19 @@ class Logger;
 
 namespace prajna::parser {
 
-bool parse(std::string code, prajna::ast::Statements& ast, std::string file_name,
+/// @brief 解析器的实现, 由prajna.parser配置: qi为基于Boost.Spirit的语法, recursive_descent为手写的解析,
+/// 两者产生相同的ast
+enum struct ParserKind { qi, recursive_descent };
+
+ParserKind GetParserKind();
+
+bool parse(std::string_view code, prajna::ast::Statements& ast, std::string file_name,
+           std::shared_ptr<Logger> logger, ParserKind parser_kind);
+
+bool parse(std::string_view code, prajna::ast::Statements& ast, std::string file_name,
            std::shared_ptr<Logger> logger);
 
-std::shared_ptr<prajna::ast::Statements> parse(std::string code, std::string file_name,
+std::shared_ptr<prajna::ast::Statements> parse(std::string_view code, std::string file_name,
                                                std::shared_ptr<Logger> logger);
 
 }  // namespace prajna::parser
@@ -0,0 +1,329 @@
+#include "prajna/parser/recursive_descent/lexer.h"
+
+#include <string_view>
+#include <unordered_map>
+
+namespace prajna::parser::recursive_descent {
+
+namespace {
+
+/// @brief position_iterator2默认的tab宽度
+constexpr int TAB_SIZE = 4;
+
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline bool IsIdentifierHead(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+inline bool IsIdentifierTail(char c) { return IsIdentifierHead(c) || IsDigit(c); }
+
+/// @brief lexertl里的"\s"
+inline bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+TokenKind GetKeywordKind(std::string_view identifier) {
+    static const std::unordered_map<std::string_view, TokenKind> keyword_dict = {
+        {"module", TokenKind::module_},
+        {"func", TokenKind::func},
+        {"struct", TokenKind::struct_},
+        {"implement", TokenKind::implement},
+        {"interface", TokenKind::interface},
+        {"template", TokenKind::template_},
+        {"special", TokenKind::special},
+        {"use", TokenKind::use},
+        {"as", TokenKind::as},
+        {"if", TokenKind::if_},
+        {"else", TokenKind::else_},
+        {"for", TokenKind::for_},
+        {"in", TokenKind::in},
+        {"to", TokenKind::to},
+        {"while", TokenKind::while_},
+        {"return", TokenKind::return_},
+        {"break", TokenKind::break_},
+        {"continue", TokenKind::continue_},
+        {"var", TokenKind::var},
+        {"this", TokenKind::this_},
+        {"true", TokenKind::true_literal},
+        {"false", TokenKind::false_literal},
+    };
+
+    auto iter = keyword_dict.find(identifier);
+    return iter != keyword_dict.end() ? iter->second : TokenKind::identifier;
+}
+
+class Lexer {
+   public:
+    Lexer(std::string_view code, int line = 1, int column = 1)
+        : _code(code), _line(line), _column(column) {}
+
+    std::vector<Token> Tokenize() {
+        std::vector<Token> tokens;
+        // 经验上每个token平均不到6个字符
+        tokens.reserve(_code.size() / 6 + 1);
+
+        while (true) {
+            this->SkipWhitespaceAndComments();
+
+            Token token;
+            token.offset = _offset;
+            token.first_line = _line;
+            token.first_column = _column;
+            if (_offset == static_cast<int64_t>(_code.size())) {
+                token.kind = TokenKind::end_of_file;
+                token.size = 0;
+            } else {
+                token.kind = this->MatchToken(token.size);
+                this->Advance(token.size);
+            }
+            token.last_line = _line;
+            token.last_column = _column;
+            tokens.push_back(token);
+
+            if (token.kind == TokenKind::end_of_file) break;
+        }
+
+        return tokens;
+    }
+
+    /// @brief 和position_iterator2的位置计算一致, "\r\n"只算一次换行, tab对齐到TAB_SIZE
+    void Advance(int64_t size) {
+        for (int64_t i = 0; i < size; ++i, ++_offset) {
+            auto c = _code[_offset];
+            if (c == '\n') {
+                ++_line;
+                _column = 1;
+            } else if (c == '\r') {
+                if (_offset + 1 == static_cast<int64_t>(_code.size()) ||
+                    _code[_offset + 1] != '\n') {
+                    ++_line;
+                    _column = 1;
+                }
+            } else if (c == '\t') {
+                _column += TAB_SIZE - (_column - 1) % TAB_SIZE;
+            } else {
+                ++_column;
+            }
+        }
+    }
+
+    int Line() const { return _line; }
+
+    int Column() const { return _column; }
+
+   private:
+    char Peek(int64_t i) const {
+        return _offset + i < static_cast<int64_t>(_code.size()) ? _code[_offset + i] : '\0';
+    }
+
+    /// @brief 对应CodeLexer的"WS"状态: 空白, c风格的注释和以换行结尾的行注释
+    void SkipWhitespaceAndComments() {
+        while (_offset < static_cast<int64_t>(_code.size())) {
+            auto c = _code[_offset];
+            if (IsSpace(c)) {
+                this->Advance(1);
+                continue;
+            }
+
+            if (c == '/' && this->Peek(1) == '*') {
+                auto end = _code.find("*/", _offset + 2);
+                if (end == std::string_view::npos) return;
+                this->Advance(end + 2 - _offset);
+                continue;
+            }
+
+            if (c == '/' && this->Peek(1) == '/') {
+                auto end = _code.find('\n', _offset + 2);
+                // 行注释的正则要求以换行结尾
+                if (end == std::string_view::npos) return;
+                this->Advance(end + 1 - _offset);
+                continue;
+            }
+
+            return;
+        }
+    }
+
+    TokenKind MatchToken(int64_t& size) {
+        size = 1;
+        auto c = _code[_offset];
+        auto c1 = this->Peek(1);
+
+        switch (c) {
+            case '<': {
+                if (c1 == '|' || c1 == '=') size = 2;
+                return c1 == '|'   ? TokenKind::left_arrow2
+                       : c1 == '=' ? TokenKind::less_or_equal
+                                   : TokenKind::less;
+            }
+            case '|': {
+                if (c1 == '>' || c1 == '|') size = 2;
+                return c1 == '>'   ? TokenKind::right_arrow2
+                       : c1 == '|' ? TokenKind::or_
+                                   : TokenKind::invalid;
+            }
+            case '&': {
+                if (c1 == '&') size = 2;
+                return c1 == '&' ? TokenKind::and_ : TokenKind::address;
+            }
+            case '!': {
+                if (c1 == '=') size = 2;
+                return c1 == '=' ? TokenKind::not_equal : TokenKind::not_;
+            }
+            case '=': {
+                if (c1 == '=') size = 2;
+                return c1 == '=' ? TokenKind::equal : TokenKind::assign;
+            }
+            case '>': {
+                if (c1 == '=') size = 2;
+                return c1 == '=' ? TokenKind::greater_or_equal : TokenKind::greater;
+            }
+            case '-': {
+                if (c1 == '>') size = 2;
+                return c1 == '>' ? TokenKind::arrow : TokenKind::minus;
+            }
+            case ':': {
+                if (c1 == ':') size = 2;
+                return c1 == ':' ? TokenKind::scope : TokenKind::colon;
+            }
+            case '.': {
+                // ".5"也是浮点数, 比"."更长
+                if (IsDigit(c1)) return this->MatchNumber(size);
+                return TokenKind::period;
+            }
+            case '+':
+                return TokenKind::plus;
+            case '*':
+                return TokenKind::star;
+            case '/':
+                return TokenKind::divide;
+            case '%':
+                return TokenKind::remain;
+            case '(':
+                return TokenKind::left_bracket;
+            case ')':
+                return TokenKind::right_bracket;
+            case '[':
+                return TokenKind::left_square_bracket;
+            case ']':
+                return TokenKind::right_square_bracket;
+            case '{':
+                return TokenKind::left_braces;
+            case '}':
+                return TokenKind::right_braces;
+            case ',':
+                return TokenKind::comma;
+            case ';':
+                return TokenKind::semicolon;
+            case '@':
+                return TokenKind::at;
+            case '#':
+                return TokenKind::number_sign;
+            case '\'':
+                return this->MatchCharLiteral(size);
+            case '"':
+                return this->MatchStringLiteral(size);
+            default:
+                break;
+        }
+
+        if (IsDigit(c)) return this->MatchNumber(size);
+
+        if (IsIdentifierHead(c)) {
+            while (IsIdentifierTail(this->Peek(size))) ++size;
+            return GetKeywordKind(_code.substr(_offset, size));
+        }
+
+        return TokenKind::invalid;
+    }
+
+    /// @brief int_literal为"[0-9]+", float_literal为"[0-9]*\.?[0-9]+(e[-+]?[0-9]+)?",
+    /// 等长时int_literal在前
+    TokenKind MatchNumber(int64_t& size) {
+        int64_t i = 0;
+        while (IsDigit(this->Peek(i))) ++i;
+        auto int_size = i;
+
+        auto float_size = int_size;
+        if (this->Peek(i) == '.' && IsDigit(this->Peek(i + 1))) {
+            i += 1;
+            while (IsDigit(this->Peek(i))) ++i;
+            float_size = i;
+        }
+        if (this->Peek(float_size) == 'e') {
+            auto j = float_size + 1;
+            if (this->Peek(j) == '-' || this->Peek(j) == '+') ++j;
+            if (IsDigit(this->Peek(j))) {
+                while (IsDigit(this->Peek(j))) ++j;
+                float_size = j;
+            }
+        }
+
+        if (float_size > int_size) {
+            size = float_size;
+            return TokenKind::float_literal;
+        }
+        size = int_size;
+        return TokenKind::int_literal;
+    }
+
+    TokenKind MatchCharLiteral(int64_t& size) {
+        auto c1 = this->Peek(1);
+        if (c1 != '\'' && c1 != '"' && c1 != '\\' && this->Peek(2) == '\'') {
+            size = 3;
+            return TokenKind::char_literal;
+        }
+
+        if (c1 == '\\' && this->Peek(3) == '\'' &&
+            std::string_view("abfnrtv\\'\"0").find(this->Peek(2)) != std::string_view::npos) {
+            size = 4;
+            return TokenKind::char_literal;
+        }
+
+        size = 1;
+        return TokenKind::invalid;
+    }
+
+    /// @brief 正则为"\"([^\"]|\\\\\")*\"", 转义的引号既可以继续匹配也可以作为结尾,
+    /// 最长匹配在第一个未转义的引号处结束
+    TokenKind MatchStringLiteral(int64_t& size) {
+        int64_t end = -1;
+        for (int64_t i = _offset + 1; i < static_cast<int64_t>(_code.size()); ++i) {
+            if (_code[i] != '"') continue;
+            end = i;
+            if (_code[i - 1] != '\\') break;
+        }
+
+        if (end < 0) {
+            size = 1;
+            return TokenKind::invalid;
+        }
+        size = end + 1 - _offset;
+        return TokenKind::string_literal;
+    }
+
+    std::string_view _code;
+    int64_t _offset = 0;
+    int _line;
+    int _column;
+};
+
+}  // namespace
+
+std::vector<Token> Tokenize(std::string_view code) {
+    Lexer lexer(code);
+    return lexer.Tokenize();
+}
+
+void GetPositionInToken(std::string_view code, const Token& token, int64_t offset_in_token,
+                        int& line, int& column) {
+    // 多截取一个字符, "\r\n"的判断需要看到下一个字符
+    Lexer lexer(code.substr(token.offset, offset_in_token + 1), token.first_line,
+                token.first_column);
+    lexer.Advance(offset_in_token);
+    line = lexer.Line();
+    column = lexer.Column();
+}
+
+}  // namespace prajna::parser::recursive_descent
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace prajna::parser::recursive_descent {
+
+/// @brief 和CodeLexer里的token一一对应, 顺序即其定义的顺序
+enum struct TokenKind {
+    end_of_file,
+    invalid,
+
+    left_arrow2,
+    right_arrow2,
+    and_,
+    or_,
+    not_,
+    equal,
+    not_equal,
+    less_or_equal,
+    greater_or_equal,
+    less,
+    greater,
+    arrow,
+    scope,
+    period,
+    address,
+    plus,
+    minus,
+    star,
+    divide,
+    remain,
+    assign,
+    left_bracket,
+    right_bracket,
+    left_square_bracket,
+    right_square_bracket,
+    left_braces,
+    right_braces,
+    comma,
+    colon,
+    semicolon,
+    at,
+    number_sign,
+
+    module_,
+    func,
+    struct_,
+    implement,
+    interface,
+    template_,
+    special,
+    use,
+    as,
+    if_,
+    else_,
+    for_,
+    in,
+    to,
+    while_,
+    return_,
+    break_,
+    continue_,
+    var,
+    this_,
+
+    char_literal,
+    string_literal,
+    int_literal,
+    float_literal,
+    true_literal,
+    false_literal,
+    identifier,
+};
+
+/// @brief token在源码里的区间和位置, 位置的计算和position_iterator2一致
+struct Token {
+    TokenKind kind;
+    int64_t offset;
+    int64_t size;
+    int first_line;
+    int first_column;
+    int last_line;
+    int last_column;
+};
+
+/// @brief 手写的词法解析, 规则和CodeLexer一致: 取最长的匹配, 等长时取先定义的token.
+/// 空白和注释被跳过, 无法识别的字符产生invalid的token, 最后以end_of_file结尾
+std::vector<Token> Tokenize(std::string_view code);
+
+/// @brief 计算token内偏移处字符的位置, 只在报错时使用
+void GetPositionInToken(std::string_view code, const Token& token, int64_t offset_in_token,
+                        int& line, int& column);
+
+}  // namespace prajna::parser::recursive_descent
@@ -0,0 +1,1238 @@
+#include "prajna/parser/recursive_descent/parser.h"
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+#include "boost/spirit/include/qi_parse.hpp"
+#include "boost/spirit/include/qi_real.hpp"
+#include "fmt/format.h"
+#include "prajna/assert.hpp"
+#include "prajna/exception.hpp"
+#include "prajna/logger.hpp"
+#include "prajna/parser/recursive_descent/lexer.h"
+
+namespace prajna::parser::recursive_descent {
+
+namespace {
+
+/// @brief 二元运算的优先级从低到高依次为: 相等, 逻辑, 关系, 加减, 乘除, 和expression_grammar一致
+constexpr int EQUALITY_LEVEL = 0;
+constexpr int MULTIPLICATIVE_LEVEL = 4;
+
+bool IsBinaryOperator(TokenKind kind, int level) {
+    switch (level) {
+        case 0:
+            return kind == TokenKind::equal || kind == TokenKind::not_equal;
+        case 1:
+            return kind == TokenKind::and_ || kind == TokenKind::or_;
+        case 2:
+            return kind == TokenKind::less || kind == TokenKind::less_or_equal ||
+                   kind == TokenKind::greater || kind == TokenKind::greater_or_equal;
+        case 3:
+            return kind == TokenKind::plus || kind == TokenKind::minus;
+        case 4:
+            return kind == TokenKind::star || kind == TokenKind::divide ||
+                   kind == TokenKind::remain;
+        default:
+            return false;
+    }
+}
+
+bool IsUnaryOperator(TokenKind kind) {
+    return kind == TokenKind::star || kind == TokenKind::plus || kind == TokenKind::minus ||
+           kind == TokenKind::not_ || kind == TokenKind::address;
+}
+
+std::string TokenKindToString(TokenKind kind) {
+    switch (kind) {
+        case TokenKind::left_arrow2:
+            return "<|";
+        case TokenKind::right_arrow2:
+            return "|>";
+        case TokenKind::less:
+            return "<";
+        case TokenKind::greater:
+            return ">";
+        case TokenKind::left_bracket:
+            return "(";
+        case TokenKind::right_bracket:
+            return ")";
+        case TokenKind::left_square_bracket:
+            return "[";
+        case TokenKind::right_square_bracket:
+            return "]";
+        case TokenKind::left_braces:
+            return "{";
+        case TokenKind::right_braces:
+            return "}";
+        case TokenKind::comma:
+            return ",";
+        case TokenKind::colon:
+            return ":";
+        case TokenKind::semicolon:
+            return ";";
+        case TokenKind::in:
+            return "in";
+        case TokenKind::to:
+            return "to";
+        default:
+            return "token";
+    }
+}
+
+class Parser {
+   public:
+    Parser(std::string_view code, std::string file_name, std::shared_ptr<Logger> logger)
+        : _code(code), _file_name(std::move(file_name)), _logger(logger) {
+        _tokens = Tokenize(_code);
+    }
+
+    /// @brief 对应statements规则, 未能解析到源码末尾时报错
+    bool ParseStatements(ast::Statements& ast_statements) {
+        this->ParseStatementList(ast_statements);
+
+        if (!this->Is(TokenKind::end_of_file)) {
+            auto first_position = this->FirstPosition(this->Current());
+            auto last_position = first_position;
+            last_position.column = first_position.column + 1;
+            _logger->Error("expect a \"statement\"", first_position, last_position,
+                           fmt::color::red);
+        }
+
+        return true;
+    }
+
+   private:
+    const Token& Current() const { return _tokens[_index]; }
+
+    TokenKind Kind(int64_t offset) const {
+        return _tokens[std::min<int64_t>(_index + offset, _tokens.size() - 1)].kind;
+    }
+
+    bool Is(TokenKind kind) const { return this->Current().kind == kind; }
+
+    bool Accept(TokenKind kind) {
+        if (!this->Is(kind)) return false;
+        ++_index;
+        return true;
+    }
+
+    /// @brief 期望的token之前的空白已被跳过, 所以和Qi一样错误位置在当前token的开始
+    void Expect(TokenKind kind) {
+        if (this->Accept(kind)) return;
+
+        auto first_position = this->FirstPosition(this->Current());
+        this->Error(fmt::format("expect a \"{}\"", TokenKindToString(kind)), first_position);
+    }
+
+    /// @brief 回溯到first_index, 用于分支匹配失败时
+    bool Backtrack(int64_t first_index) {
+        _index = first_index;
+        return false;
+    }
+
+    /// @brief 期望的规则匹配失败, 和ErrorHandler一致, 错误位置在最后一个已匹配的token之后
+    [[noreturn]] void ErrorExpect(std::string rule_name) {
+        auto& last_token = _tokens[std::max<int64_t>(_index - 1, 0)];
+        this->Error(fmt::format("expect a \"{}\"", rule_name), this->LastPosition(last_token));
+    }
+
+    [[noreturn]] void Error(std::string message, ast::SourcePosition first_position) {
+        auto last_position = first_position;
+        last_position.column = first_position.column + 1;
+        _logger->Error(message, first_position, last_position, fmt::color::blue);
+        throw CompileError();
+    }
+
+    std::string_view Text(const Token& token) const {
+        return _code.substr(token.offset, token.size);
+    }
+
+    ast::SourcePosition FirstPosition(const Token& token) const {
+        return ast::SourcePosition{token.first_line, token.first_column, _file_name};
+    }
+
+    ast::SourcePosition LastPosition(const Token& token) const {
+        return ast::SourcePosition{token.last_line, token.last_column, _file_name};
+    }
+
+    ast::SourcePosition PositionInToken(const Token& token, int64_t offset_in_token) const {
+        ast::SourcePosition source_position;
+        GetPositionInToken(_code, token, offset_in_token, source_position.line,
+                           source_position.column);
+        source_position.file = _file_name;
+        return source_position;
+    }
+
+    void SetTokenLocation(ast::SourceLocation& ast_source_location, const Token& token) const {
+        ast_source_location.first_position = this->FirstPosition(token);
+        ast_source_location.last_position = this->LastPosition(token);
+    }
+
+    /// @brief 对应SuccessHandler: 位置从规则的第一个token到最后一个token,
+    /// 规则匹配为空时和Qi一样取下一个token的位置
+    void Locate(ast::SourceLocation& ast_source_location, int64_t first_index) const {
+        auto& first_token = _tokens[first_index];
+        auto& last_token = _index > first_index ? _tokens[_index - 1] : first_token;
+        ast_source_location.first_position = this->FirstPosition(first_token);
+        ast_source_location.last_position = this->LastPosition(last_token);
+    }
+
+    void Locate(ast::Operand& ast_operand, int64_t first_index) const {
+        boost::apply_visitor([=, this](auto& x) { this->Locate(x, first_index); }, ast_operand);
+    }
+
+    void Locate(ast::TemplateArgument& ast_template_argument, int64_t first_index) const {
+        boost::apply_visitor([=, this](auto& x) { this->Locate(x, first_index); },
+                             ast_template_argument);
+    }
+
+    void Locate(ast::Statement& ast_statement, int64_t first_index) const {
+        boost::apply_visitor([=, this](auto& x) { this->Locate(x, first_index); },
+                             ast_statement);
+    }
+
+    /// @brief 解析成功时将结果放入variant里
+    template <typename Node, typename Variant>
+    bool ParseInto(Variant& ast_variant, bool (Parser::*parse_function)(Node&)) {
+        Node ast_node;
+        if (!(this->*parse_function)(ast_node)) return false;
+        ast_variant = std::move(ast_node);
+        return true;
+    }
+
+    char GetEscapeChar(const Token& token, int64_t offset_in_token) const {
+        switch (_code[token.offset + offset_in_token]) {
+            case 'a':
+                return '\a';
+            case 'b':
+                return '\b';
+            case 'e':
+                return '\e';
+            case 'f':
+                return '\f';
+            case 'n':
+                return '\n';
+            case 'r':
+                return '\r';
+            case 't':
+                return '\t';
+            case 'v':
+                return '\v';
+            case '\\':
+                return '\\';
+            case '\'':
+                return '\'';
+            case '\0':
+                return '\0';
+            case '0':
+                return '\0';
+            case '\"':
+                return '\"';
+            default:
+                throw InvalidEscapeChar{this->PositionInToken(token, offset_in_token)};
+        }
+    }
+
+    ast::Identifier MakeIdentifier(const Token& token) const {
+        ast::Identifier ast_identifier(std::string(this->Text(token)));
+        this->SetTokenLocation(ast_identifier, token);
+        return ast_identifier;
+    }
+
+    ast::Operator MakeOperator(const Token& token) const {
+        ast::Operator ast_operator(std::string(this->Text(token)));
+        this->SetTokenLocation(ast_operator, token);
+        return ast_operator;
+    }
+
+    ast::IntLiteral MakeIntLiteral(const Token& token) const {
+        ast::IntLiteral ast_int_literal;
+        this->SetTokenLocation(ast_int_literal, token);
+        ast_int_literal.value = std::stoull(std::string(this->Text(token)));
+        return ast_int_literal;
+    }
+
+    ast::FloatLiteral MakeFloatLiteral(const Token& token) const {
+        ast::FloatLiteral ast_float_literal;
+        this->SetTokenLocation(ast_float_literal, token);
+        // 和assign_to.hpp一样使用qi的浮点解析, 保证数值一致
+        auto text = this->Text(token);
+        auto first = text.begin();
+        boost::spirit::qi::parse(first, text.end(), boost::spirit::qi::double_type(),
+                                 ast_float_literal.value);
+        return ast_float_literal;
+    }
+
+    ast::BoolLiteral MakeBoolLiteral(const Token& token) const {
+        ast::BoolLiteral ast_bool_literal;
+        this->SetTokenLocation(ast_bool_literal, token);
+        ast_bool_literal.value = token.kind == TokenKind::true_literal;
+        return ast_bool_literal;
+    }
+
+    ast::CharLiteral MakeCharLiteral(const Token& token) const {
+        ast::CharLiteral ast_char_literal;
+        this->SetTokenLocation(ast_char_literal, token);
+        if (token.size == 3) {
+            ast_char_literal.value = _code[token.offset + 1];
+        } else {
+            PRAJNA_ASSERT(token.size == 4);
+            ast_char_literal.value = this->GetEscapeChar(token, 2);
+        }
+        return ast_char_literal;
+    }
+
+    ast::StringLiteral MakeStringLiteral(const Token& token) const {
+        ast::StringLiteral ast_string_literal;
+        this->SetTokenLocation(ast_string_literal, token);
+        auto text = this->Text(token);
+        for (int64_t i = 1; i + 1 < token.size; ++i) {
+            if (text[i] != '\\') {
+                ast_string_literal.value.push_back(text[i]);
+            } else {
+                ++i;
+                if (i + 1 == token.size) {
+                    throw InvalidEscapeChar{this->PositionInToken(token, i)};
+                }
+                ast_string_literal.value.push_back(this->GetEscapeChar(token, i));
+            }
+        }
+        return ast_string_literal;
+    }
+
+    /// @brief 跳过标注后的token, 用于选择以标注开始的语句, 标注的错误留给之后的解析报告
+    TokenKind PeekPastAnnotations() const {
+        auto i = _index;
+        while (_tokens[i].kind == TokenKind::at) {
+            ++i;
+            if (_tokens[i].kind == TokenKind::identifier) ++i;
+            if (_tokens[i].kind == TokenKind::left_bracket) {
+                while (_tokens[i].kind != TokenKind::right_bracket &&
+                       _tokens[i].kind != TokenKind::end_of_file) {
+                    ++i;
+                }
+                if (_tokens[i].kind == TokenKind::right_bracket) ++i;
+            }
+        }
+        return _tokens[i].kind;
+    }
+
+    /// @brief 对应"*statement"
+    void ParseStatementList(ast::Statements& ast_statements) {
+        while (true) {
+            ast::Statement ast_statement;
+            if (!this->ParseStatement(ast_statement)) break;
+            ast_statements.push_back(std::move(ast_statement));
+        }
+    }
+
+    /// @brief 按首个token选择分支, 需要回溯的分支和statement规则的顺序一致
+    bool ParseStatement(ast::Statement& ast_statement) {
+        auto first_index = _index;
+        bool parsed = false;
+        switch (this->Current().kind) {
+            case TokenKind::module_:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseModule);
+                break;
+            case TokenKind::left_braces:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseBlock);
+                break;
+            case TokenKind::if_:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseIf);
+                break;
+            case TokenKind::struct_:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseStruct);
+                break;
+            case TokenKind::interface:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseInterface);
+                break;
+            case TokenKind::implement:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseImplementInterface) ||
+                         this->ParseInto(ast_statement, &Parser::ParseImplementType);
+                break;
+            case TokenKind::template_:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseTemplate) ||
+                         this->ParseInto(ast_statement, &Parser::ParseTemplateStatement);
+                break;
+            case TokenKind::special:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseSpecialStatement);
+                break;
+            case TokenKind::func:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseFunction);
+                break;
+            case TokenKind::while_:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseWhile);
+                break;
+            case TokenKind::for_:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseFor);
+                break;
+            case TokenKind::semicolon:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseSemicolonStatement);
+                break;
+            case TokenKind::at:
+                parsed = this->ParseAnnotatedStatement(ast_statement);
+                break;
+            default:
+                parsed = this->ParseSingleStatement(ast_statement);
+                break;
+        }
+
+        if (!parsed) return this->Backtrack(first_index);
+        this->Locate(ast_statement, first_index);
+        return true;
+    }
+
+    bool ParseAnnotatedStatement(ast::Statement& ast_statement) {
+        switch (this->PeekPastAnnotations()) {
+            case TokenKind::interface:
+                return this->ParseInto(ast_statement, &Parser::ParseInterface);
+            case TokenKind::implement:
+                return this->ParseInto(ast_statement, &Parser::ParseImplementInterface);
+            case TokenKind::func:
+                return this->ParseInto(ast_statement, &Parser::ParseFunction);
+            case TokenKind::for_:
+                return this->ParseInto(ast_statement, &Parser::ParseFor);
+            case TokenKind::var:
+                return this->ParseSingleStatement(ast_statement);
+            default: {
+                // 标注本身有错误时在这里报告, 否则作为无法匹配的语句
+                auto first_index = _index;
+                ast::AnnotationDict ast_annotation_dict;
+                this->ParseAnnotationDict(ast_annotation_dict);
+                return this->Backtrack(first_index);
+            }
+        }
+    }
+
+    bool ParseSemicolonStatement(ast::Blank& ast_blank) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::semicolon)) return false;
+        while (this->Accept(TokenKind::semicolon)) {
+        }
+        this->Locate(ast_blank, first_index);
+        return true;
+    }
+
+    bool ParseModule(ast::Module& ast_module) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::module_)) return false;
+        if (!this->ParseIdentifierPath(ast_module.name)) this->ErrorExpect("identifier path");
+        this->Expect(TokenKind::left_braces);
+        this->ParseStatementList(ast_module.statements);
+        this->Expect(TokenKind::right_braces);
+        this->Locate(ast_module, first_index);
+        return true;
+    }
+
+    bool ParseBlock(ast::Block& ast_block) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::left_braces)) return false;
+        this->ParseStatementList(ast_block.statements);
+        this->Expect(TokenKind::right_braces);
+        this->Locate(ast_block, first_index);
+        return true;
+    }
+
+    /// @brief 对应single_statement, 以分号结尾
+    bool ParseSingleStatement(ast::Statement& ast_statement) {
+        auto first_index = _index;
+        bool parsed = false;
+        switch (this->Current().kind) {
+            case TokenKind::return_:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseReturn);
+                break;
+            case TokenKind::use:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseUse);
+                break;
+            case TokenKind::break_:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseBreak);
+                break;
+            case TokenKind::continue_:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseContinue);
+                break;
+            case TokenKind::at:
+            case TokenKind::var:
+                parsed = this->ParseInto(ast_statement, &Parser::ParseVariableDeclaration);
+                break;
+            case TokenKind::number_sign:
+                parsed = this->ParseInto(ast_statement, &Parser::ParsePragma);
+                break;
+            default:
+                parsed = this->ParseAssignmentOrExpression(ast_statement);
+                break;
+        }
+
+        if (!parsed) return this->Backtrack(first_index);
+        this->Expect(TokenKind::semicolon);
+        this->Locate(ast_statement, first_index);
+        return true;
+    }
+
+    bool ParseReturn(ast::Return& ast_return) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::return_)) return false;
+        ast::Expression ast_expression;
+        if (this->ParseExpression(ast_expression)) {
+            ast_return.expr_optional = std::move(ast_expression);
+        }
+        this->Locate(ast_return, first_index);
+        return true;
+    }
+
+    bool ParseUse(ast::Use& ast_use) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::use)) return false;
+        if (!this->ParseIdentifierPath(ast_use.identifier_path)) {
+            this->ErrorExpect("identifier path");
+        }
+        if (this->Is(TokenKind::scope) && this->Kind(1) == TokenKind::star) {
+            ast_use.star_match_optional = this->MakeOperator(this->Current());
+            _index += 2;
+        }
+        if (this->Accept(TokenKind::as)) {
+            ast::Identifier ast_identifier;
+            if (!this->ParseIdentifier(ast_identifier)) this->ErrorExpect("identifier");
+            ast_use.as_optional = ast_identifier;
+        }
+        this->Locate(ast_use, first_index);
+        return true;
+    }
+
+    bool ParseBreak(ast::Break& ast_break) {
+        if (!this->Is(TokenKind::break_)) return false;
+        this->SetTokenLocation(ast_break, this->Current());
+        ++_index;
+        return true;
+    }
+
+    bool ParseContinue(ast::Continue& ast_continue) {
+        if (!this->Is(TokenKind::continue_)) return false;
+        this->SetTokenLocation(ast_continue, this->Current());
+        ++_index;
+        return true;
+    }
+
+    bool ParseVariableDeclaration(ast::VariableDeclaration& ast_variable_declaration) {
+        auto first_index = _index;
+        this->ParseAnnotationDict(ast_variable_declaration.annotation_dict);
+        if (!this->Accept(TokenKind::var)) return this->Backtrack(first_index);
+        if (!this->ParseIdentifier(ast_variable_declaration.name)) {
+            this->ErrorExpect("identifier");
+        }
+        if (this->Accept(TokenKind::colon)) {
+            ast::Type ast_type;
+            if (!this->ParseType(ast_type)) this->ErrorExpect("type");
+            ast_variable_declaration.type_optional = std::move(ast_type);
+        }
+        if (this->Accept(TokenKind::assign)) {
+            ast::Expression ast_expression;
+            if (!this->ParseExpression(ast_expression)) this->ErrorExpect("expression");
+            ast_variable_declaration.initialize_optional = std::move(ast_expression);
+        }
+        this->Locate(ast_variable_declaration, first_index);
+        return true;
+    }
+
+    /// @brief 对应assignment | expr, 表达式只解析一次
+    bool ParseAssignmentOrExpression(ast::Statement& ast_statement) {
+        auto first_index = _index;
+        ast::Expression ast_left;
+        if (!this->ParseExpression(ast_left)) return false;
+        if (!this->Accept(TokenKind::assign)) {
+            ast_statement = std::move(ast_left);
+            return true;
+        }
+
+        ast::Assignment ast_assignment;
+        ast_assignment.left = std::move(ast_left);
+        if (!this->ParseExpression(ast_assignment.right)) this->ErrorExpect("expression");
+        this->Locate(ast_assignment, first_index);
+        ast_statement = std::move(ast_assignment);
+        return true;
+    }
+
+    bool ParsePragma(ast::Pragma& ast_pragma) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::number_sign)) return false;
+        if (!this->ParseIdentifier(ast_pragma.name)) this->ErrorExpect("identifier");
+        if (this->Accept(TokenKind::left_bracket)) {
+            this->ParseStringLiteralList(ast_pragma.values);
+            this->Expect(TokenKind::right_bracket);
+        }
+        this->Locate(ast_pragma, first_index);
+        return true;
+    }
+
+    bool ParseAnnotation(ast::Annotation& ast_annotation) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::at)) return false;
+        if (!this->ParseIdentifier(ast_annotation.name)) this->ErrorExpect("identifier");
+        if (this->Accept(TokenKind::left_bracket)) {
+            this->ParseStringLiteralList(ast_annotation.values);
+            this->Expect(TokenKind::right_bracket);
+        }
+        this->Locate(ast_annotation, first_index);
+        return true;
+    }
+
+    void ParseAnnotationDict(ast::AnnotationDict& ast_annotation_dict) {
+        auto first_index = _index;
+        while (true) {
+            ast::Annotation ast_annotation;
+            if (!this->ParseAnnotation(ast_annotation)) break;
+            ast_annotation_dict.push_back(std::move(ast_annotation));
+        }
+        this->Locate(ast_annotation_dict, first_index);
+    }
+
+    /// @brief 对应"-(string_literal % comma)"
+    void ParseStringLiteralList(std::list<ast::StringLiteral>& ast_string_literals) {
+        if (!this->Is(TokenKind::string_literal)) return;
+        ast_string_literals.push_back(this->MakeStringLiteral(this->Current()));
+        ++_index;
+        while (this->Is(TokenKind::comma) && this->Kind(1) == TokenKind::string_literal) {
+            ++_index;
+            ast_string_literals.push_back(this->MakeStringLiteral(this->Current()));
+            ++_index;
+        }
+    }
+
+    bool ParseIf(ast::If& ast_if) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::if_)) return false;
+        if (!this->ParseExpression(ast_if.condition)) this->ErrorExpect("expression");
+        if (!this->ParseBlock(ast_if.then)) this->ErrorExpect("block");
+        if (this->Accept(TokenKind::else_)) {
+            // Qi会把"else_ > block"的块作为一个语句放入else_optional的块里
+            ast::Block ast_block;
+            if (!this->ParseBlock(ast_block)) this->ErrorExpect("block");
+            ast_if.else_optional = ast::Block();
+            ast_if.else_optional->statements.push_back(std::move(ast_block));
+        }
+        this->Locate(ast_if, first_index);
+        return true;
+    }
+
+    bool ParseWhile(ast::While& ast_while) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::while_)) return false;
+        if (!this->ParseExpression(ast_while.condition)) this->ErrorExpect("expression");
+        if (!this->ParseBlock(ast_while.body)) this->ErrorExpect("block");
+        this->Locate(ast_while, first_index);
+        return true;
+    }
+
+    bool ParseFor(ast::For& ast_for) {
+        auto first_index = _index;
+        this->ParseAnnotationDict(ast_for.annotation_dict);
+        if (!this->Accept(TokenKind::for_)) return this->Backtrack(first_index);
+        if (!this->ParseIdentifier(ast_for.index)) this->ErrorExpect("identifier");
+        this->Expect(TokenKind::in);
+        if (!this->ParseExpression(ast_for.first)) this->ErrorExpect("expression");
+        this->Expect(TokenKind::to);
+        if (!this->ParseExpression(ast_for.last)) this->ErrorExpect("expression");
+        if (!this->ParseBlock(ast_for.body)) this->ErrorExpect("block");
+        this->Locate(ast_for, first_index);
+        return true;
+    }
+
+    bool ParseStruct(ast::Struct& ast_struct) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::struct_)) return false;
+        if (!this->ParseIdentifier(ast_struct.name)) this->ErrorExpect("identifier");
+        if (!this->ParseFields(ast_struct.fields)) this->ErrorExpect("fields");
+        this->Locate(ast_struct, first_index);
+        return true;
+    }
+
+    bool ParseFields(std::list<ast::Field>& ast_fields) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::left_braces)) return false;
+        while (true) {
+            ast::Field ast_field;
+            if (!this->ParseField(ast_field)) break;
+            ast_fields.push_back(std::move(ast_field));
+        }
+        this->Expect(TokenKind::right_braces);
+        // Qi的SuccessHandler会把列表规则的位置设置给每个元素
+        for (auto& ast_field : ast_fields) {
+            this->Locate(ast_field, first_index);
+        }
+        return true;
+    }
+
+    bool ParseField(ast::Field& ast_field) {
+        auto first_index = _index;
+        if (!this->ParseIdentifier(ast_field.name)) return false;
+        this->Expect(TokenKind::colon);
+        if (!this->ParseType(ast_field.type)) this->ErrorExpect("type");
+        this->Expect(TokenKind::semicolon);
+        this->Locate(ast_field, first_index);
+        return true;
+    }
+
+    bool ParseInterface(ast::InterfacePrototype& ast_interface) {
+        auto first_index = _index;
+        this->ParseAnnotationDict(ast_interface.annotation_dict);
+        if (!this->Accept(TokenKind::interface)) return this->Backtrack(first_index);
+        if (!this->ParseIdentifier(ast_interface.name)) this->ErrorExpect("identifier");
+        if (!this->ParseFunctions(ast_interface.functions)) this->ErrorExpect("functions");
+        this->Locate(ast_interface, first_index);
+        return true;
+    }
+
+    /// @brief implement_interface规则全部由">>"连接, 匹配失败时回溯
+    bool ParseImplementInterface(ast::ImplementInterfaceForType& ast_implement) {
+        auto first_index = _index;
+        this->ParseAnnotationDict(ast_implement.annotation_dict);
+        if (!this->Accept(TokenKind::implement) ||
+            !this->ParseIdentifierPath(ast_implement.interface) ||
+            !this->Accept(TokenKind::for_) || !this->ParseType(ast_implement.type) ||
+            !this->ParseFunctions(ast_implement.functions)) {
+            return this->Backtrack(first_index);
+        }
+        this->Locate(ast_implement, first_index);
+        return true;
+    }
+
+    bool ParseImplementType(ast::ImplementType& ast_implement) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::implement)) return false;
+        if (!this->ParseType(ast_implement.type)) this->ErrorExpect("type");
+        this->Expect(TokenKind::left_braces);
+        do {
+            ast::Statement ast_statement;
+            if (!this->ParseInto(ast_statement, &Parser::ParseFunction) &&
+                !this->ParseInto(ast_statement, &Parser::ParseTemplateStatement)) {
+                if (ast_implement.statements.empty()) this->ErrorExpect("function");
+                break;
+            }
+            ast_implement.statements.push_back(std::move(ast_statement));
+        } while (true);
+        this->Expect(TokenKind::right_braces);
+        this->Locate(ast_implement, first_index);
+        return true;
+    }
+
+    bool ParseFunctions(std::list<ast::Function>& ast_functions) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::left_braces)) return false;
+        // 没有函数的接口(如标记接口)也是合法的
+        for (ast::Function ast_function; this->ParseFunction(ast_function);
+             ast_function = ast::Function{}) {
+            ast_functions.push_back(std::move(ast_function));
+        }
+        this->Expect(TokenKind::right_braces);
+        // Qi的SuccessHandler会把列表规则的位置设置给每个元素
+        for (auto& ast_function : ast_functions) {
+            this->Locate(ast_function, first_index);
+        }
+        return true;
+    }
+
+    bool ParseFunctionHeader(ast::FunctionHeader& ast_function_header) {
+        auto first_index = _index;
+        this->ParseAnnotationDict(ast_function_header.annotation_dict);
+        if (!this->Accept(TokenKind::func)) return this->Backtrack(first_index);
+        if (!this->ParseIdentifier(ast_function_header.name)) this->ErrorExpect("identifier");
+        if (!this->ParseParameters(ast_function_header.parameters)) {
+            this->ErrorExpect("parameters");
+        }
+        if (this->Accept(TokenKind::arrow)) {
+            ast::Type ast_type;
+            if (!this->ParseType(ast_type)) this->ErrorExpect("type");
+            ast_function_header.return_type_optional = std::move(ast_type);
+        }
+        this->Locate(ast_function_header, first_index);
+        return true;
+    }
+
+    bool ParseFunction(ast::Function& ast_function) {
+        auto first_index = _index;
+        if (!this->ParseFunctionHeader(ast_function.declaration)) return false;
+        ast::Block ast_block;
+        if (this->ParseBlock(ast_block)) {
+            ast_function.body_optional = std::move(ast_block);
+        } else if (!this->Accept(TokenKind::semicolon)) {
+            this->ErrorExpect("function implement");
+        }
+        this->Locate(ast_function, first_index);
+        return true;
+    }
+
+    bool ParseParameters(ast::Parameters& ast_parameters) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::left_bracket)) return false;
+        ast::Parameter ast_parameter;
+        if (this->ParseParameter(ast_parameter)) {
+            ast_parameters.push_back(std::move(ast_parameter));
+            while (this->Is(TokenKind::comma)) {
+                auto comma_index = _index;
+                ++_index;
+                ast::Parameter ast_next_parameter;
+                if (!this->ParseParameter(ast_next_parameter)) {
+                    this->Backtrack(comma_index);
+                    break;
+                }
+                ast_parameters.push_back(std::move(ast_next_parameter));
+            }
+        }
+        this->Expect(TokenKind::right_bracket);
+        this->Locate(ast_parameters, first_index);
+        return true;
+    }
+
+    bool ParseParameter(ast::Parameter& ast_parameter) {
+        auto first_index = _index;
+        if (!this->ParseIdentifier(ast_parameter.name)) return false;
+        this->Expect(TokenKind::colon);
+        if (!this->ParseType(ast_parameter.type)) this->ErrorExpect("type");
+        this->Locate(ast_parameter, first_index);
+        return true;
+    }
+
+    bool ParseTemplateParameter(ast::TemplateParameter& ast_template_parameter) {
+        auto first_index = _index;
+        if (!this->ParseIdentifier(ast_template_parameter.name)) return false;
+        if (this->Accept(TokenKind::colon)) {
+            ast::IdentifierPath ast_identifier_path;
+            if (!this->ParseIdentifierPath(ast_identifier_path)) {
+                this->ErrorExpect("identifier path");
+            }
+            ast_template_parameter.concept_optional = std::move(ast_identifier_path);
+        }
+        this->Locate(ast_template_parameter, first_index);
+        return true;
+    }
+
+    /// @brief 对应"<" > (template_parameter % comma) > ">", 未经过template_parameters规则,
+    /// 故列表本身没有位置
+    void ParseTemplateParameterList(ast::TemplateParameters& ast_template_parameters) {
+        this->Expect(TokenKind::less);
+        ast::TemplateParameter ast_template_parameter;
+        if (!this->ParseTemplateParameter(ast_template_parameter)) {
+            this->ErrorExpect("template parameter");
+        }
+        ast_template_parameters.push_back(std::move(ast_template_parameter));
+        while (this->Is(TokenKind::comma)) {
+            auto comma_index = _index;
+            ++_index;
+            ast::TemplateParameter ast_next_template_parameter;
+            if (!this->ParseTemplateParameter(ast_next_template_parameter)) {
+                this->Backtrack(comma_index);
+                break;
+            }
+            ast_template_parameters.push_back(std::move(ast_next_template_parameter));
+        }
+        this->Expect(TokenKind::greater);
+    }
+
+    bool ParseTemplate(ast::Template& ast_template) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::template_)) return false;
+        if (!this->ParseIdentifier(ast_template.name)) return this->Backtrack(first_index);
+        this->ParseTemplateParameterList(ast_template.template_parameters);
+        // 和Qi一样, 块整体作为模板的唯一一个语句
+        ast::Block ast_block;
+        if (!this->ParseBlock(ast_block)) this->ErrorExpect("block");
+        ast_template.statements.push_back(std::move(ast_block));
+        this->Locate(ast_template, first_index);
+        return true;
+    }
+
+    bool ParseTemplateStatement(ast::TemplateStatement& ast_template_statement) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::template_)) return false;
+        this->ParseTemplateParameterList(ast_template_statement.template_parameters);
+        if (!this->ParseTemplateAbleStatement(ast_template_statement.statement)) {
+            this->ErrorExpect("templateable statement");
+        }
+        this->Locate(ast_template_statement, first_index);
+        return true;
+    }
+
+    /// @brief 和templateable_statement规则一样不设置位置
+    bool ParseTemplateAbleStatement(ast::TemplateAbleStatement& ast_templateable_statement) {
+        return this->ParseInto(ast_templateable_statement, &Parser::ParseStruct) ||
+               this->ParseInto(ast_templateable_statement, &Parser::ParseFunction) ||
+               this->ParseInto(ast_templateable_statement, &Parser::ParseImplementInterface) ||
+               this->ParseInto(ast_templateable_statement, &Parser::ParseImplementType) ||
+               this->ParseInto(ast_templateable_statement, &Parser::ParseInterface);
+    }
+
+    bool ParseSpecialStatement(ast::SpecialStatement& ast_special_statement) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::special)) return false;
+        if (!this->ParseTemplateArguments(ast_special_statement.template_arguments)) {
+            this->ErrorExpect("template arguments");
+        }
+        ast::TemplateAbleStatement ast_templateable_statement;
+        if (!this->ParseTemplateAbleStatement(ast_templateable_statement)) {
+            this->ErrorExpect("templateable statement");
+        }
+        boost::apply_visitor(
+            [&](auto& ast_statement) { ast_special_statement.statement = ast_statement; },
+            ast_templateable_statement);
+        this->Locate(ast_special_statement, first_index);
+        return true;
+    }
+
+    bool ParseIdentifier(ast::Identifier& ast_identifier) {
+        if (!this->Is(TokenKind::identifier)) return false;
+        ast_identifier = this->MakeIdentifier(this->Current());
+        ++_index;
+        return true;
+    }
+
+    bool ParseType(ast::Type& ast_type) { return this->ParseIdentifierPath(ast_type); }
+
+    /// @brief 对应"-scope >> template_identifier % scope", "::"后不是标识符时回溯到"::"之前
+    bool ParseIdentifierPath(ast::IdentifierPath& ast_identifier_path) {
+        auto first_index = _index;
+        if (this->Is(TokenKind::scope)) {
+            ast_identifier_path.root_optional = this->MakeOperator(this->Current());
+            ++_index;
+        }
+
+        ast::TemplateIdentifier ast_template_identifier;
+        if (!this->ParseTemplateIdentifier(ast_template_identifier)) {
+            ast_identifier_path.root_optional.reset();
+            return this->Backtrack(first_index);
+        }
+        ast_identifier_path.identifiers.push_back(std::move(ast_template_identifier));
+
+        while (this->Is(TokenKind::scope)) {
+            auto scope_index = _index;
+            ++_index;
+            ast::TemplateIdentifier ast_next_template_identifier;
+            if (!this->ParseTemplateIdentifier(ast_next_template_identifier)) {
+                this->Backtrack(scope_index);
+                break;
+            }
+            ast_identifier_path.identifiers.push_back(std::move(ast_next_template_identifier));
+        }
+
+        this->Locate(ast_identifier_path, first_index);
+        return true;
+    }
+
+    bool ParseTemplateIdentifier(ast::TemplateIdentifier& ast_template_identifier) {
+        auto first_index = _index;
+        if (!this->ParseIdentifier(ast_template_identifier.identifier)) return false;
+        ast::TemplateArguments ast_template_arguments;
+        if (this->ParseTemplateArguments(ast_template_arguments)) {
+            ast_template_identifier.template_arguments_optional = std::move(ast_template_arguments);
+        }
+        this->Locate(ast_template_identifier, first_index);
+        return true;
+    }
+
+    /// @brief 模板实参全部由">>"连接, 所以"a < b"之类的比较会在这里回溯
+    bool ParseTemplateArguments(ast::TemplateArguments& ast_template_arguments) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::less)) return false;
+
+        ast::TemplateArgument ast_template_argument;
+        if (!this->ParseTemplateArgument(ast_template_argument)) {
+            return this->Backtrack(first_index);
+        }
+        ast_template_arguments.push_back(std::move(ast_template_argument));
+        while (this->Is(TokenKind::comma)) {
+            auto comma_index = _index;
+            ++_index;
+            ast::TemplateArgument ast_next_template_argument;
+            if (!this->ParseTemplateArgument(ast_next_template_argument)) {
+                this->Backtrack(comma_index);
+                break;
+            }
+            ast_template_arguments.push_back(std::move(ast_next_template_argument));
+        }
+
+        if (!this->Accept(TokenKind::greater)) {
+            ast_template_arguments.clear();
+            return this->Backtrack(first_index);
+        }
+        this->Locate(ast_template_arguments, first_index);
+        return true;
+    }
+
+    bool ParseTemplateArgument(ast::TemplateArgument& ast_template_argument) {
+        auto first_index = _index;
+        ast::Type ast_type;
+        if (this->ParseType(ast_type)) {
+            ast_template_argument = std::move(ast_type);
+        } else if (this->Is(TokenKind::int_literal)) {
+            ast_template_argument = this->MakeIntLiteral(this->Current());
+            ++_index;
+        } else {
+            return false;
+        }
+        this->Locate(ast_template_argument, first_index);
+        return true;
+    }
+
+    bool ParseExpression(ast::Expression& ast_expression) {
+        return this->ParseBinaryExpression(ast_expression, EQUALITY_LEVEL);
+    }
+
+    /// @brief 每一级都是"下一级 >> *(运算符 > 下一级)", 下一级的表达式作为操作数嵌套在里面
+    bool ParseBinaryExpression(ast::Expression& ast_expression, int level) {
+        auto first_index = _index;
+        if (!this->ParseBinaryOperand(ast_expression.first, level)) return false;
+
+        while (IsBinaryOperator(this->Current().kind, level)) {
+            ast::BinaryOperation ast_binary_operation;
+            ast_binary_operation.operator_ = this->MakeOperator(this->Current());
+            ++_index;
+            if (!this->ParseBinaryOperand(ast_binary_operation.operand, level)) {
+                this->ErrorExpect(level == MULTIPLICATIVE_LEVEL ? "unary expression"
+                                                                : "expression");
+            }
+            ast_expression.rest.push_back(std::move(ast_binary_operation));
+        }
+
+        this->Locate(ast_expression, first_index);
+        return true;
+    }
+
+    bool ParseBinaryOperand(ast::Operand& ast_operand, int level) {
+        if (level == MULTIPLICATIVE_LEVEL) {
+            return this->ParseUnaryExpression(ast_operand);
+        }
+
+        ast::Expression ast_expression;
+        if (!this->ParseBinaryExpression(ast_expression, level + 1)) return false;
+        ast_operand = std::move(ast_expression);
+        return true;
+    }
+
+    bool ParseUnaryExpression(ast::Operand& ast_operand) {
+        auto first_index = _index;
+        if (this->ParseInto(ast_operand, &Parser::ParseKernelFunctionCall)) {
+        } else if (IsUnaryOperator(this->Current().kind)) {
+            ast::Unary ast_unary;
+            ast_unary.operator_ = this->MakeOperator(this->Current());
+            ++_index;
+            if (!this->ParseUnaryExpression(ast_unary.operand)) {
+                this->ErrorExpect("unary expression");
+            }
+            ast_operand = std::move(ast_unary);
+        } else {
+            return false;
+        }
+        this->Locate(ast_operand, first_index);
+        return true;
+    }
+
+    bool ParseKernelFunctionCall(ast::KernelFunctionCall& ast_kernel_function_call) {
+        auto first_index = _index;
+        if (!this->ParseAccessCallIndexExpression(ast_kernel_function_call.kernel_function)) {
+            return false;
+        }
+
+        if (this->Accept(TokenKind::left_arrow2)) {
+            ast::KernelFunctionCallOperation ast_operation;
+            if (!this->ParseExpression(ast_operation.grid_shape)) this->ErrorExpect("expression");
+            this->Expect(TokenKind::comma);
+            if (!this->ParseExpression(ast_operation.block_shape)) {
+                this->ErrorExpect("expression");
+            }
+            this->Expect(TokenKind::right_arrow2);
+            this->Expect(TokenKind::left_bracket);
+            this->ParseArguments(ast_operation.arguments);
+            this->Expect(TokenKind::right_bracket);
+            ast_kernel_function_call.operation = std::move(ast_operation);
+        }
+
+        this->Locate(ast_kernel_function_call, first_index);
+        return true;
+    }
+
+    bool ParseAccessCallIndexExpression(ast::Expression& ast_expression) {
+        auto first_index = _index;
+        if (!this->ParsePrimaryExpression(ast_expression.first)) return false;
+
+        while (true) {
+            auto operation_index = _index;
+            ast::BinaryOperation ast_binary_operation;
+            if (this->Is(TokenKind::period) || this->Is(TokenKind::arrow)) {
+                ast_binary_operation.operator_ = this->MakeOperator(this->Current());
+                ++_index;
+                ast::IdentifierPath ast_identifier_path;
+                if (!this->ParseIdentifierPath(ast_identifier_path)) {
+                    this->ErrorExpect("identifier path");
+                }
+                ast_binary_operation.operand = std::move(ast_identifier_path);
+            } else if (this->Is(TokenKind::left_bracket) ||
+                       this->Is(TokenKind::left_square_bracket)) {
+                auto right_kind = this->Is(TokenKind::left_bracket)
+                                      ? TokenKind::right_bracket
+                                      : TokenKind::right_square_bracket;
+                ast_binary_operation.operator_ = this->MakeOperator(this->Current());
+                ++_index;
+                ast::Expressions ast_arguments;
+                this->ParseArguments(ast_arguments);
+                this->Expect(right_kind);
+                ast_binary_operation.operand = std::move(ast_arguments);
+            } else {
+                break;
+            }
+
+            this->Locate(ast_binary_operation, operation_index);
+            ast_expression.rest.push_back(std::move(ast_binary_operation));
+        }
+
+        this->Locate(ast_expression, first_index);
+        return true;
+    }
+
+    /// @brief 对应"-(expr % comma)", 总是成功
+    void ParseArguments(ast::Expressions& ast_arguments) {
+        auto first_index = _index;
+        ast::Expression ast_expression;
+        if (this->ParseExpression(ast_expression)) {
+            ast_arguments.push_back(std::move(ast_expression));
+            while (this->Is(TokenKind::comma)) {
+                auto comma_index = _index;
+                ++_index;
+                ast::Expression ast_next_expression;
+                if (!this->ParseExpression(ast_next_expression)) {
+                    this->Backtrack(comma_index);
+                    break;
+                }
+                ast_arguments.push_back(std::move(ast_next_expression));
+            }
+        }
+        this->Locate(ast_arguments, first_index);
+    }
+
+    bool ParsePrimaryExpression(ast::Operand& ast_operand) {
+        auto first_index = _index;
+        if (this->ParseLiteral(ast_operand)) {
+        } else if (this->Is(TokenKind::this_)) {
+            ast_operand = this->MakeIdentifier(this->Current());
+            ++_index;
+        } else if (this->ParseInto(ast_operand, &Parser::ParseIdentifierPath)) {
+        } else if (this->ParseInto(ast_operand, &Parser::ParseArray)) {
+        } else if (this->Accept(TokenKind::left_bracket)) {
+            // "(表达式)"和闭包都以"("开始, 和Qi的分支顺序一样先尝试前者
+            ast::Expression ast_expression;
+            if (this->ParseExpression(ast_expression) && this->Accept(TokenKind::right_bracket)) {
+                ast_operand = std::move(ast_expression);
+            } else {
+                this->Backtrack(first_index);
+                if (!this->ParseInto(ast_operand, &Parser::ParseClosure)) return false;
+            }
+        } else {
+            return false;
+        }
+        this->Locate(ast_operand, first_index);
+        return true;
+    }
+
+    bool ParseArray(ast::Array& ast_array) {
+        auto first_index = _index;
+        if (!this->Accept(TokenKind::left_square_bracket)) return false;
+        ast::Expression ast_expression;
+        if (!this->ParseExpression(ast_expression)) this->ErrorExpect("expression");
+        ast_array.values.push_back(std::move(ast_expression));
+        while (this->Is(TokenKind::comma)) {
+            auto comma_index = _index;
+            ++_index;
+            ast::Expression ast_next_expression;
+            if (!this->ParseExpression(ast_next_expression)) {
+                this->Backtrack(comma_index);
+                break;
+            }
+            ast_array.values.push_back(std::move(ast_next_expression));
+        }
+        this->Expect(TokenKind::right_square_bracket);
+        this->Locate(ast_array, first_index);
+        return true;
+    }
+
+    /// @brief closure规则没有on_success, 其位置由primary_expr设置
+    bool ParseClosure(ast::Closure& ast_closure) {
+        if (!this->ParseParameters(ast_closure.parameters)) return false;
+        if (this->Accept(TokenKind::arrow)) {
+            ast::Type ast_type;
+            if (!this->ParseType(ast_type)) this->ErrorExpect("type");
+            ast_closure.return_type_optional = std::move(ast_type);
+        }
+        if (!this->ParseBlock(ast_closure.body)) this->ErrorExpect("block");
+        return true;
+    }
+
+    bool ParseLiteral(ast::Operand& ast_operand) {
+        auto first_index = _index;
+        auto& token = this->Current();
+        switch (token.kind) {
+            case TokenKind::int_literal: {
+                if (this->Kind(1) == TokenKind::identifier) {
+                    ast::IntLiteralPostfix ast_int_literal_postfix;
+                    ast_int_literal_postfix.int_literal = this->MakeIntLiteral(token);
+                    ast_int_literal_postfix.postfix = this->MakeIdentifier(_tokens[_index + 1]);
+                    _index += 2;
+                    ast_operand = std::move(ast_int_literal_postfix);
+                } else {
+                    ast_operand = this->MakeIntLiteral(token);
+                    ++_index;
+                }
+                break;
+            }
+            case TokenKind::float_literal: {
+                if (this->Kind(1) == TokenKind::identifier) {
+                    ast::FloatLiteralPostfix ast_float_literal_postfix;
+                    ast_float_literal_postfix.float_literal = this->MakeFloatLiteral(token);
+                    ast_float_literal_postfix.postfix = this->MakeIdentifier(_tokens[_index + 1]);
+                    _index += 2;
+                    ast_operand = std::move(ast_float_literal_postfix);
+                } else {
+                    ast_operand = this->MakeFloatLiteral(token);
+                    ++_index;
+                }
+                break;
+            }
+            case TokenKind::string_literal:
+                ast_operand = this->MakeStringLiteral(token);
+                ++_index;
+                break;
+            case TokenKind::true_literal:
+            case TokenKind::false_literal:
+                ast_operand = this->MakeBoolLiteral(token);
+                ++_index;
+                break;
+            case TokenKind::char_literal:
+                ast_operand = this->MakeCharLiteral(token);
+                ++_index;
+                break;
+            default:
+                return false;
+        }
+        this->Locate(ast_operand, first_index);
+        return true;
+    }
+
+    std::string_view _code;
+    std::string _file_name;
+    std::shared_ptr<Logger> _logger;
+    std::vector<Token> _tokens;
+    int64_t _index = 0;
+};
+
+}  // namespace
+
+bool parse(std::string_view code, ast::Statements& ast, std::string file_name,
+           std::shared_ptr<Logger> logger) {
+    try {
+        Parser parser(code, std::move(file_name), logger);
+        return parser.ParseStatements(ast);
+    } catch (InvalidEscapeChar lexer_error) {
+        logger->Error("invalid escape char", lexer_error.source_position);
+        return false;
+    }
+}
+
+}  // namespace prajna::parser::recursive_descent
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "prajna/ast/ast.hpp"
+
+namespace prajna {
+class Logger;
+}
+
+namespace prajna::parser::recursive_descent {
+
+/// @brief 手写的递归下降解析, 和grammar里基于Boost.Spirit Qi的语法产生相同的ast.
+/// 语法规则和Qi的一一对应, 期望(">")失败时报错, 否则回溯尝试下一个分支.
+/// 源码位置也按Qi的on_success设置, 包括其对空匹配和列表的处理
+bool parse(std::string_view code, ast::Statements& ast, std::string file_name,
+           std::shared_ptr<Logger> logger);
+
+}  // namespace prajna::parser::recursive_descent
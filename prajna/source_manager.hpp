@@ -0,0 +1,155 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+
+namespace prajna {
+
+/// @brief 一份源码, 文件通过mmap映射而不拷贝, 解析和诊断共用同一份内容.
+/// 行表只在第一次需要行内容时(打印诊断)才建立
+class SourceBuffer {
+   protected:
+    SourceBuffer() = default;
+
+   public:
+    static std::shared_ptr<SourceBuffer> Create(std::string code, std::string file_name) {
+        std::shared_ptr<SourceBuffer> self(new SourceBuffer);
+        self->_code_string = std::move(code);
+        self->_code = self->_code_string;
+        self->_file_name = std::move(file_name);
+        return self;
+    }
+
+    /// @return 文件无法打开时返回nullptr
+    static std::shared_ptr<SourceBuffer> CreateFromFile(std::filesystem::path file_path) {
+        std::error_code error_code;
+        auto file_size = std::filesystem::file_size(file_path, error_code);
+        if (error_code || std::filesystem::is_directory(file_path)) return nullptr;
+        auto last_write_time = std::filesystem::last_write_time(file_path, error_code);
+        if (error_code) return nullptr;
+        // 空文件无法映射
+        if (file_size == 0) {
+            auto self = Create("", file_path.string());
+            self->_file_status = FileStatus{file_path, file_size, last_write_time};
+            return self;
+        }
+
+        std::shared_ptr<SourceBuffer> self(new SourceBuffer);
+        try {
+            boost::interprocess::file_mapping file_mapping(file_path.string().c_str(),
+                                                           boost::interprocess::read_only);
+            self->_mapped_region =
+                boost::interprocess::mapped_region(file_mapping, boost::interprocess::read_only);
+        } catch (boost::interprocess::interprocess_exception&) {
+            return nullptr;
+        }
+        self->_code = std::string_view(static_cast<const char*>(self->_mapped_region.get_address()),
+                                       self->_mapped_region.get_size());
+        self->_file_name = file_path.string();
+        self->_file_status = FileStatus{file_path, file_size, last_write_time};
+        return self;
+    }
+
+    /// @brief 文件在读入后是否被修改或删除(按大小和修改时间判断), 不是从文件读入的返回false
+    bool IsStale() const {
+        if (!_file_status) return false;
+
+        std::error_code error_code;
+        auto file_size = std::filesystem::file_size(_file_status->path, error_code);
+        if (error_code || file_size != _file_status->size) return true;
+        auto last_write_time = std::filesystem::last_write_time(_file_status->path, error_code);
+        return error_code || last_write_time != _file_status->last_write_time;
+    }
+
+    std::string_view Code() const { return _code; }
+
+    const std::string& FileName() const { return _file_name; }
+
+    int64_t LineCount() {
+        this->BuildLineOffsets();
+        return _line_offsets.size();
+    }
+
+    /// @brief 第line行的内容, 从1开始计数, 不包含"\n"
+    std::string_view Line(int64_t line) {
+        this->BuildLineOffsets();
+        if (line < 1 || line > static_cast<int64_t>(_line_offsets.size())) return {};
+
+        auto first = _line_offsets[line - 1];
+        auto last = line < static_cast<int64_t>(_line_offsets.size())
+                        ? _line_offsets[line] - 1
+                        : static_cast<int64_t>(_code.size());
+        return _code.substr(first, last - first);
+    }
+
+   private:
+    struct FileStatus {
+        std::filesystem::path path;
+        std::uintmax_t size;
+        std::filesystem::file_time_type last_write_time;
+    };
+
+    void BuildLineOffsets() {
+        if (!_line_offsets.empty()) return;
+
+        _line_offsets.push_back(0);
+        for (int64_t i = 0; i < static_cast<int64_t>(_code.size()); ++i) {
+            if (_code[i] == '\n') {
+                _line_offsets.push_back(i + 1);
+            }
+        }
+    }
+
+    std::string _file_name;
+    std::string _code_string;
+    boost::interprocess::mapped_region _mapped_region;
+    std::string_view _code;
+    std::vector<int64_t> _line_offsets;
+    std::optional<FileStatus> _file_status;
+};
+
+/// @brief 管理编译器读入的源文件, 文件未被修改时只映射一次.
+/// 这里只弱引用映射, 编译和诊断不再使用后映射即被释放,
+/// 以免文件之后被截断时访问映射触发SIGBUS, 或在Windows上无法保存被映射的文件
+class SourceManager {
+   protected:
+    SourceManager() = default;
+
+   public:
+    static std::shared_ptr<SourceManager> Create() {
+        return std::shared_ptr<SourceManager>(new SourceManager);
+    }
+
+    /// @return 文件无法打开时返回nullptr
+    std::shared_ptr<SourceBuffer> LoadFile(std::filesystem::path file_path) {
+        std::error_code error_code;
+        auto canonical_path = std::filesystem::weakly_canonical(file_path, error_code).string();
+        if (error_code) canonical_path = file_path.string();
+
+        auto iter = _source_buffers.find(canonical_path);
+        if (iter != _source_buffers.end()) {
+            auto source_buffer = iter->second.lock();
+            if (source_buffer && !source_buffer->IsStale()) return source_buffer;
+            _source_buffers.erase(iter);
+        }
+
+        auto source_buffer = SourceBuffer::CreateFromFile(file_path);
+        if (source_buffer) {
+            _source_buffers[canonical_path] = source_buffer;
+        }
+        return source_buffer;
+    }
+
+   private:
+    std::unordered_map<std::string, std::weak_ptr<SourceBuffer>> _source_buffers;
+};
+
+}  // namespace prajna
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <set>
+#include <utility>
+
+#include "prajna/helper.hpp"
+#include "prajna/ir/ir.hpp"
+#include "prajna/lowering/ir_builder.hpp"
+#include "prajna/transform/pass_manager.hpp"
+#include "prajna/transform/transform_pass.hpp"
+#include "prajna/transform/utility.hpp"
+
+namespace prajna::transform {
+
+/// @brief Dynamic<Interface>的成员调用去虚化. 若变量的值只可能来自同一个实现的dynamic_type_creator,
+/// 则直接调用该实现的函数而不经由虚表, 之后的llvm可以内联它.
+/// 对象指针仍从Dynamic的值里读取, 所以对象指针字段被改写时行为不变
+class DevirtualizeDynamicCallPass : public FunctionPass {
+   protected:
+    DevirtualizeDynamicCallPass() = default;
+
+   public:
+    static std::shared_ptr<DevirtualizeDynamicCallPass> Create() {
+        std::shared_ptr<DevirtualizeDynamicCallPass> self(new DevirtualizeDynamicCallPass);
+        return self;
+    }
+
+    std::string Name() const override { return "DevirtualizeDynamicCallPass"; }
+
+    bool RunOnFunction(std::shared_ptr<ir::Function> ir_function) override {
+        // 先全部分析再替换, 替换引入的使用会影响后面调用的分析
+        std::list<std::pair<std::shared_ptr<ir::Call>, std::shared_ptr<ir::Function>>>
+            ir_devirtualized_calls;
+        auto ir_value_index = analysis_manager->Get<ValueIndexAnalysis>(ir_function);
+        for (auto ir_call : ir_value_index->GetAll<ir::Call>()) {
+            auto ir_member_function = Cast<ir::Function>(ir_call->Function());
+            if (!ir_member_function || !ir_member_function->annotation_dict.count("dynamic_method"))
+                continue;
+            auto ir_get_address = Cast<ir::GetAddressOfVariableLiked>(ir_call->Argument(0));
+            if (!ir_get_address) continue;
+
+            std::set<std::shared_ptr<ir::Value>> ir_visited_set;
+            auto ir_creator = this->ResolveDynamicTypeCreator(ir_get_address->variable(),
+                                                              ir_visited_set);
+            if (!ir_creator) continue;
+            if (ir_creator->function_type->return_type != ir_get_address->variable()->type)
+                continue;
+
+            if (auto ir_implement_function =
+                    this->GetImplementFunction(ir_creator, ir_member_function)) {
+                ir_devirtualized_calls.push_back({ir_call, ir_implement_function});
+            }
+        }
+
+        for (auto [ir_call, ir_implement_function] : ir_devirtualized_calls) {
+            this->ReplaceWithDirectCall(ir_call, ir_implement_function);
+        }
+
+        return !ir_devirtualized_calls.empty();
+    }
+
+   private:
+    /// @return 值所有可能的来源都是同一个dynamic_type_creator时返回它, 否则返回nullptr
+    std::shared_ptr<ir::Function> ResolveDynamicTypeCreator(
+        std::shared_ptr<ir::Value> ir_value, std::set<std::shared_ptr<ir::Value>>& ir_visited_set) {
+        if (!ir_visited_set.insert(ir_value).second) return nullptr;
+
+        if (auto ir_call = Cast<ir::Call>(ir_value)) {
+            auto ir_callee = Cast<ir::Function>(ir_call->Function());
+            if (!ir_callee) return nullptr;
+            if (ir_callee->annotation_dict.count("dynamic_type_creator")) return ir_callee;
+            return this->ResolveReturnedDynamicTypeCreator(ir_callee);
+        }
+
+        auto ir_variable = Cast<ir::LocalVariable>(ir_value);
+        if (!ir_variable) return nullptr;
+
+        std::shared_ptr<ir::Function> ir_creator = nullptr;
+        for (auto [wp_ir_instruction, op_idx] : ir_variable->instruction_with_index_list) {
+            auto ir_instruction = Lock(wp_ir_instruction);
+            if (!ir_instruction) continue;
+
+            if (auto ir_write = Cast<ir::WriteVariableLiked>(ir_instruction)) {
+                // 作为被写入的变量
+                if (op_idx == 1) {
+                    auto ir_tmp_creator =
+                        this->ResolveDynamicTypeCreator(ir_write->Value(), ir_visited_set);
+                    if (!ir_tmp_creator || (ir_creator && ir_creator != ir_tmp_creator)) {
+                        return nullptr;
+                    }
+                    ir_creator = ir_tmp_creator;
+                }
+                continue;
+            }
+
+            // 取地址只允许作为接口成员函数的this指针, 它们不会修改Dynamic的值
+            if (auto ir_get_address = Cast<ir::GetAddressOfVariableLiked>(ir_instruction)) {
+                for (auto [wp_ir_user, user_op_idx] : ir_get_address->instruction_with_index_list) {
+                    auto ir_user_call = Cast<ir::Call>(Lock(wp_ir_user));
+                    if (!ir_user_call || user_op_idx != 1) return nullptr;
+                    auto ir_callee = Cast<ir::Function>(ir_user_call->Function());
+                    if (!ir_callee || !ir_callee->annotation_dict.count("dynamic_method")) {
+                        return nullptr;
+                    }
+                }
+                continue;
+            }
+
+            // 虚表字段之外的字段(对象指针)可以被引用计数等读写
+            if (auto ir_access_field = Cast<ir::AccessField>(ir_instruction)) {
+                if (ir_access_field->field->name == "vtable") return nullptr;
+                continue;
+            }
+
+            // 其余的使用都只读取变量的值
+            if (Is<ir::VariableLiked>(ir_instruction)) return nullptr;
+        }
+
+        return ir_creator;
+    }
+
+    /// @brief 返回Dynamic的函数(如Ptr::As, 它并不内联)的所有返回值都来自同一个dynamic_type_creator时,
+    /// 其调用结果也来自它
+    std::shared_ptr<ir::Function> ResolveReturnedDynamicTypeCreator(
+        std::shared_ptr<ir::Function> ir_callee) {
+        if (ir_callee->IsDeclaration()) return nullptr;
+        // 递归的函数无法确定
+        if (!_resolving_callee_set.insert(ir_callee).second) return nullptr;
+        auto guard = ScopeExit::Create([=]() { _resolving_callee_set.erase(ir_callee); });
+
+        std::shared_ptr<ir::Function> ir_creator = nullptr;
+        for (auto ir_return : utility::GetAll<ir::Return>(ir_callee)) {
+            std::set<std::shared_ptr<ir::Value>> ir_visited_set;
+            auto ir_tmp_creator =
+                this->ResolveDynamicTypeCreator(ir_return->Value(), ir_visited_set);
+            if (!ir_tmp_creator || (ir_creator && ir_creator != ir_tmp_creator)) return nullptr;
+            ir_creator = ir_tmp_creator;
+        }
+        return ir_creator;
+    }
+
+    std::shared_ptr<ir::Function> GetImplementFunction(
+        std::shared_ptr<ir::Function> ir_creator, std::shared_ptr<ir::Function> ir_member_function) {
+        auto ir_ptr_type = ir_creator->function_type->parameter_types.front();
+        auto iter_raw_ptr_field = std::ranges::find_if(
+            ir_ptr_type->fields, [](auto ir_field) { return ir_field->name == "raw_ptr"; });
+        if (iter_raw_ptr_field == ir_ptr_type->fields.end()) return nullptr;
+        auto ir_object_type = Cast<ir::PointerType>((*iter_raw_ptr_field)->type)->value_type;
+
+        // 接口实现以接口原型的名字存放, 接口的动态类型也以其命名
+        auto ir_dynamic_type = ir_creator->function_type->return_type;
+        auto iter_interface = ir_object_type->interface_dict.find(ir_dynamic_type->Name());
+        if (iter_interface == ir_object_type->interface_dict.end() || !iter_interface->second) {
+            return nullptr;
+        }
+
+        for (auto ir_function : iter_interface->second->functions) {
+            if (ir_function->Name() == ir_member_function->Name() &&
+                ir_function->parameters.size() == ir_member_function->parameters.size()) {
+                return ir_function;
+            }
+        }
+        return nullptr;
+    }
+
+    void ReplaceWithDirectCall(std::shared_ptr<ir::Call> ir_call,
+                               std::shared_ptr<ir::Function> ir_implement_function) {
+        auto ir_block = ir_call->GetParentBlock();
+        auto ir_builder = lowering::IrBuilder::Create();
+        auto scope = ir_builder->PushBlockRAII(ir_block);
+        ir_builder->inserter_iterator = ir_block->Find(ir_call);
+
+        auto ir_dynamic_object = ir_builder->Create<ir::DeferencePointer>(ir_call->Argument(0));
+        auto ir_raw_pointer = ir_builder->AccessField(
+            ir_builder->AccessField(ir_dynamic_object, "object_pointer"), "raw_ptr");
+        std::list<std::shared_ptr<ir::Value>> ir_arguments = {ir_builder->Create<ir::BitCast>(
+            ir_raw_pointer, ir_implement_function->parameters.front()->type)};
+        for (int64_t i = 1; i < ir_call->ArgumentSize(); ++i) {
+            ir_arguments.push_back(ir_call->Argument(i));
+        }
+        auto ir_direct_call = ir_builder->Call(ir_implement_function, ir_arguments);
+
+        ir_call->ReplaceAllUsesWith(ir_direct_call);
+        utility::RemoveFromParent(ir_call);
+        ir_call->Finalize();
+    }
+
+    std::set<std::shared_ptr<ir::Function>> _resolving_callee_set;
+};
+
+}  // namespace prajna::transform
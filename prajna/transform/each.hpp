@@ -11,14 +11,24 @@ class EachTensorVisitor : public ir::CallbackVisitor {
     EachTensorVisitor(std::function<void(std::shared_ptr<ir::Value>)> callback)
         : ir::CallbackVisitor(callback) {}
 
+    /// @param read_only 为true时callback不能修改IR, 遍历时不再拷贝块
     static std::shared_ptr<EachTensorVisitor> Create(
-        std::function<void(std::shared_ptr<ir::Value>)> callback) {
+        std::function<void(std::shared_ptr<ir::Value>)> callback, bool read_only = false) {
         auto self = std::shared_ptr<EachTensorVisitor>(new EachTensorVisitor(callback));
+        self->read_only = read_only;
         return self;
     }
 
     void Visit(std::shared_ptr<ir::Block> ir_block) override {
         this->callback(ir_block);
+        if (read_only) {
+            auto self = this->shared_from_this();
+            for (auto& ir_value : *ir_block) {
+                ir_value->ApplyVisitor(self);
+            }
+            return;
+        }
+
         for (auto ir_value : Clone(*ir_block)) {  // Each的过程中会修改
             ir_value->ApplyVisitor(this->shared_from_this());
         }
@@ -61,6 +71,9 @@ class EachTensorVisitor : public ir::CallbackVisitor {
             this->callback(ir_global_variable);
         }
     }
+
+   private:
+    bool read_only = false;
 };
 
 template <typename Value_>
@@ -74,4 +87,18 @@ inline void Each(std::shared_ptr<ir::Value> ir_tensor,
     ir_tensor->ApplyVisitor(visitor);
 }
 
+/// @brief 同Each, 但callback不能修改IR, 遍历时不拷贝块
+template <typename Value_>
+inline void EachReadOnly(std::shared_ptr<ir::Value> ir_tensor,
+                         std::function<void(std::shared_ptr<Value_>)> callback) {
+    auto visitor = EachTensorVisitor::Create(
+        [=](std::shared_ptr<ir::Value> ir_tensor) {
+            if (auto ir_value = Cast<Value_>(ir_tensor)) {
+                callback(ir_value);
+            }
+        },
+        true);
+    ir_tensor->ApplyVisitor(visitor);
+}
+
 }  // namespace prajna::transform
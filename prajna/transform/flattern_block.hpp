@@ -169,6 +169,8 @@ inline bool FlatternBlockImpl(std::shared_ptr<ir::Block> ir_block) {
             }
 
             auto ir_jump_branch = ir::internal::JumpBranch::Create(ir_label_condition_entry);
+            // 循环的标注放到回边上, codegen据此生成llvm.loop元数据
+            ir_jump_branch->annotation_dict = ir_for->annotation_dict;
             ir_for->LoopBlock()->PushBack(ir_jump_branch);
             for (auto e : *ir_for->LoopBlock()) {
                 ir_block->Insert(iter, e);
@@ -217,12 +219,7 @@ inline std::list<std::shared_ptr<ir::Block>> splitBlock(std::shared_ptr<ir::Bloc
         if (auto ir_label = Cast<ir::internal::Label>(ir_value)) {
             blocks.push_back(ir::Block::Create());
 
-            // ir_label作为操作时修改时(移除或添加), 都会改变instructions_with_index的值,
-            // 故应该先拷贝一份
-            for (auto inst_with_idx : Clone(ir_label->instruction_with_index_list)) {
-                Lock(inst_with_idx.instruction)
-                    ->SetOperand(inst_with_idx.operand_index, blocks.back());
-            }
+            ir_label->ReplaceAllUsesWith(blocks.back());
         } else {
             blocks.back()->PushBack(ir_value);
         }
@@ -233,24 +230,25 @@ inline std::list<std::shared_ptr<ir::Block>> splitBlock(std::shared_ptr<ir::Bloc
 
 }  // namespace
 
-inline bool FlatternBlock(std::shared_ptr<ir::Module> ir_module) {
-    for (auto ir_function : ir_module->functions) {
-        std::list<std::shared_ptr<ir::Block>> blocks;
-        for (auto ir_block : ir_function->blocks) {
-            FlatternBlockImpl(ir_block);
-            auto ir_new_blocks = splitBlock(ir_block);
-            blocks.insert(blocks.end(), ir_new_blocks.begin(), ir_new_blocks.end());
-        }
+/// @return 函数有函数体时总会重建其基本块, 故返回是否有函数体
+inline bool FlatternBlock(std::shared_ptr<ir::Function> ir_function) {
+    if (ir_function->IsDeclaration()) return false;
+
+    std::list<std::shared_ptr<ir::Block>> blocks;
+    for (auto ir_block : ir_function->blocks) {
+        FlatternBlockImpl(ir_block);
+        auto ir_new_blocks = splitBlock(ir_block);
+        blocks.insert(blocks.end(), ir_new_blocks.begin(), ir_new_blocks.end());
+    }
 
-        ir_function->blocks = blocks;
+    ir_function->blocks = blocks;
 
-        for (auto ir_block : ir_function->blocks) {
-            ir_block->parent = ir_function;
-            ir_block->parent.reset();
-        }
+    for (auto ir_block : ir_function->blocks) {
+        ir_block->parent = ir_function;
+        ir_block->parent.reset();
     }
 
-    return false;
+    return true;
 }
 
 }  // namespace prajna::transform
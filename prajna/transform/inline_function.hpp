@@ -5,6 +5,7 @@
 #include "prajna/ir/ir.hpp"
 #include "prajna/logger.hpp"
 #include "prajna/lowering/statement_lowering_visitor.hpp"
+#include "prajna/transform/pass_manager.hpp"
 #include "prajna/transform/utility.hpp"
 
 namespace prajna::transform {
@@ -16,10 +17,20 @@ inline bool InlineCheck(std::shared_ptr<ir::Function> ir_function) {
 /// @brief 内联其他模块的函数, 这里只处理其他模块的, 本模块的函数内联由llvm完成,
 /// 目前仅考虑简单的情况, 后续还需要考虑把函数作为参数传递的高阶函数的优化,
 /// 把函数作为变量传递后调用的情况后续有需求再做处理, 因为只有编译时确定函数调用的才能内联
-inline bool InlineFunction(std::shared_ptr<ir::Module> ir_module) {
+inline bool InlineFunction(std::shared_ptr<ir::Module> ir_module,
+                           std::shared_ptr<AnalysisManager> analysis_manager) {
     bool re = false;
     for (auto ir_function : ir_module->functions) {
-        auto ir_calls = utility::GetAll<ir::Call>(ir_function);
+        // 没有引用内联函数的函数无需遍历
+        if (std::ranges::none_of(*analysis_manager->Get<CalleeAnalysis>(ir_function),
+                                 [](std::shared_ptr<ir::Function> ir_callee) {
+                                     return !ir_callee->IsDeclaration() && InlineCheck(ir_callee);
+                                 })) {
+            continue;
+        }
+
+        auto ir_value_index = analysis_manager->Get<ValueIndexAnalysis>(ir_function);
+        auto ir_calls = ir_value_index->GetAll<ir::Call>();
         for (auto ir_call : ir_calls) {
             auto ir_callee = Cast<ir::Function>(ir_call->Function());
             if (!ir_callee || ir_callee->IsDeclaration()) continue;
@@ -27,11 +38,11 @@ inline bool InlineFunction(std::shared_ptr<ir::Module> ir_module) {
 
             re = true;
             auto iter = std::ranges::find(*ir_call->GetParentBlock(), ir_call);
-            PRAJNA_ASSERT(ir::Verify(ir_call));
+            PRAJNA_ASSERT(ir::Verify(ir_call, ir::VerifyLevel::pass));
             auto ir_clone_visitor = ir::FunctionCloner::Create(ir_module, true);
             auto ir_new_callee = Cast<ir::Function>(ir_clone_visitor->Clone(ir_callee));
             ir_module->functions.remove(ir_new_callee);  // 在module中移除, 并不需要
-            PRAJNA_ASSERT(ir::Verify(ir_new_callee));
+            PRAJNA_ASSERT(ir::Verify(ir_new_callee, ir::VerifyLevel::pass));
 
             auto ir_builder = lowering::IrBuilder::Create();
             auto scope = ir_builder->PushBlockRAII(ir_call->GetParentBlock());
@@ -42,11 +53,7 @@ inline bool InlineFunction(std::shared_ptr<ir::Module> ir_module) {
                 // 置换形参为实参
                 auto ir_parameter = *ir_parameter_iter;
                 auto ir_argument = ir_call->Argument(i);
-                auto ir_parameter_inst_idx = ir_parameter->instruction_with_index_list;
-                for (auto &inst_idx : ir_parameter_inst_idx) {
-                    auto [inst, op_idx] = inst_idx;
-                    Lock(inst)->SetOperand(op_idx, ir_argument);
-                }
+                ir_parameter->ReplaceAllUsesWith(ir_argument);
                 ir_parameter->Finalize();
             }
 
@@ -79,10 +86,9 @@ inline bool InlineFunction(std::shared_ptr<ir::Module> ir_module) {
             ir_new_callee->blocks.front()->parent.reset();
             ir_call->GetParentBlock()->Insert(iter, ir_new_callee->blocks.front());
 
-            auto ir_call_inst_idx = ir_call->instruction_with_index_list;
-            for (auto [inst, op_idx] : ir_call_inst_idx) {
+            if (!ir_call->instruction_with_index_list.empty()) {
                 PRAJNA_ASSERT(ir_return_variable);
-                Lock(inst)->SetOperand(op_idx, ir_return_variable);
+                ir_call->ReplaceAllUsesWith(ir_return_variable);
             }
 
             utility::RemoveFromParent(ir_call);
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <memory>
+#include <set>
+
+#include "prajna/helper.hpp"
+#include "prajna/ir/ir.hpp"
+#include "prajna/transform/pass_manager.hpp"
+#include "prajna/transform/transform_pass.hpp"
+#include "prajna/transform/utility.hpp"
+
+namespace prajna::transform {
+
+/// @brief 按循环的形状标注"canonical": 没有提前退出, 循环变量不被修改, 上下界在循环内不变.
+/// 这里并不检查下标是否为循环变量的仿射表达式, 也不做分块(tiling),
+/// 直接包含"canonical"循环的外层循环还会标注"unroll_and_jam".
+/// FlatternBlock会把循环的标注放到回边上, codegen据此生成llvm.loop元数据,
+/// 只有带这些元数据的循环嵌套才会运行llvm的LoopInterchange/LoopUnrollAndJam,
+/// 下标的依赖分析和变换是否合法都由llvm判断
+class MarkCanonicalLoopPass : public FunctionPass {
+   protected:
+    MarkCanonicalLoopPass() = default;
+
+   public:
+    static std::shared_ptr<MarkCanonicalLoopPass> Create() {
+        std::shared_ptr<MarkCanonicalLoopPass> self(new MarkCanonicalLoopPass);
+        return self;
+    }
+
+    std::string Name() const override { return "MarkCanonicalLoopPass"; }
+
+    /// @brief 只添加标注, 不修改函数体
+    PreservedAnalyses GetPreservedAnalyses() const override {
+        return Preserve<ValueIndexAnalysis, CalleeAnalysis>();
+    }
+
+    bool RunOnFunction(std::shared_ptr<ir::Function> ir_function) override {
+        bool changed = false;
+        // 只添加标注, 函数的索引在整个过程中都有效
+        auto ir_value_index = analysis_manager->Get<ValueIndexAnalysis>(ir_function);
+        for (auto ir_for : ir_value_index->GetAll<ir::For>()) {
+            // gpu的循环会被抽离为核函数, 不在此处理
+            if (ir_for->annotation_dict.count("nvgpu")) continue;
+            if (ir_for->annotation_dict.count("canonical")) continue;
+            if (!IsCanonicalFor(ir_for)) continue;
+
+            ir_for->annotation_dict["canonical"];
+            changed = true;
+        }
+
+        for (auto ir_for : ir_value_index->GetAll<ir::For>()) {
+            if (!ir_for->annotation_dict.count("canonical")) continue;
+            if (ir_for->annotation_dict.count("unroll_and_jam")) continue;
+
+            // 只考虑直接包含的循环, 更深的嵌套由内层的循环各自标注
+            for (auto ir_value : *ir_for->LoopBlock()) {
+                auto ir_inner_for = Cast<ir::For>(ir_value);
+                if (ir_inner_for && ir_inner_for->annotation_dict.count("canonical")) {
+                    ir_for->annotation_dict["unroll_and_jam"];
+                    changed = true;
+                    break;
+                }
+            }
+        }
+
+        return changed;
+    }
+
+   private:
+    /// @brief 循环内没有提前退出, 循环变量没有被修改, 且上下界在循环内不变
+    static bool IsCanonicalFor(std::shared_ptr<ir::For> ir_for) {
+        auto ir_loop_values = utility::GetAll<ir::Value>(ir_for->LoopBlock());
+        std::set<std::shared_ptr<ir::Value>> ir_loop_value_set(ir_loop_values.begin(),
+                                                                ir_loop_values.end());
+
+        for (auto ir_value : ir_loop_values) {
+            if (Is<ir::Break>(ir_value) || Is<ir::Return>(ir_value) || Is<ir::While>(ir_value)) {
+                return false;
+            }
+        }
+
+        if (!IsLoopInvariant(ir_for->IndexVariable(), ir_loop_value_set)) return false;
+        if (!IsLoopInvariant(ir_for->First(), ir_loop_value_set)) return false;
+        if (!IsLoopInvariant(ir_for->Last(), ir_loop_value_set)) return false;
+
+        return true;
+    }
+
+    static bool IsLoopInvariant(std::shared_ptr<ir::Value> ir_value,
+                                const std::set<std::shared_ptr<ir::Value>>& ir_loop_value_set) {
+        if (Is<ir::Constant>(ir_value)) return true;
+        if (ir_loop_value_set.count(ir_value)) return false;
+
+        if (auto ir_variable_liked = Cast<ir::VariableLiked>(ir_value)) {
+            for (auto [ir_inst, op_idx] : ir_variable_liked->instruction_with_index_list) {
+                auto ir_instruction = Lock(ir_inst);
+                // 取地址后可能被间接修改, 保守处理
+                if (Is<ir::GetAddressOfVariableLiked>(ir_instruction)) return false;
+                if (!ir_loop_value_set.count(ir_instruction)) continue;
+
+                if (Is<ir::VariableLiked>(ir_instruction)) return false;
+                if (Is<ir::WriteVariableLiked>(ir_instruction) && op_idx == 1) return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+}  // namespace prajna::transform
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <boost/algorithm/string.hpp>
+#include <chrono>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+
+#include "fmt/format.h"
+#include "prajna/global_config.hpp"
+#include "prajna/ir/ir.hpp"
+#include "prajna/transform/transform_pass.hpp"
+#include "prajna/transform/utility.hpp"
+
+namespace prajna::transform {
+
+/// @brief 函数内所有值的索引(按程序顺序), 按类型筛选的结果也会被缓存,
+/// 同一函数未被修改时多次获取某类值无需重新遍历IR
+class ValueIndex {
+   public:
+    template <typename Value_>
+    const std::list<std::shared_ptr<Value_>>& GetAll() {
+        auto& ir_typed_values = _typed_values_dict[std::type_index(typeid(Value_))];
+        if (!ir_typed_values) {
+            auto ir_tmp_values = std::make_shared<std::list<std::shared_ptr<Value_>>>();
+            for (auto& ir_value : values) {
+                if (auto ir_typed_value = Cast<Value_>(ir_value)) {
+                    ir_tmp_values->push_back(ir_typed_value);
+                }
+            }
+            ir_typed_values = ir_tmp_values;
+        }
+        return *std::static_pointer_cast<std::list<std::shared_ptr<Value_>>>(ir_typed_values);
+    }
+
+   public:
+    std::list<std::shared_ptr<ir::Value>> values;
+
+   private:
+    std::unordered_map<std::type_index, std::shared_ptr<void>> _typed_values_dict;
+};
+
+struct ValueIndexAnalysis {
+    using Result = ValueIndex;
+
+    static std::shared_ptr<Result> Run(std::shared_ptr<ir::Function> ir_function) {
+        auto result = std::make_shared<Result>();
+        result->values = utility::GetAll<ir::Value>(ir_function);
+        return result;
+    }
+};
+
+/// @brief 函数内直接引用的函数(调用或作为值使用), 按首次引用的顺序排列
+struct CalleeAnalysis {
+    using Result = std::list<std::shared_ptr<ir::Function>>;
+
+    static std::shared_ptr<Result> Run(std::shared_ptr<ir::Function> ir_function) {
+        auto result = std::make_shared<Result>();
+        std::set<std::shared_ptr<ir::Function>> ir_callee_set;
+        for (auto ir_instruction : utility::GetAll<ir::Instruction>(ir_function)) {
+            for (int64_t i = 0; i < ir_instruction->OperandSize(); ++i) {
+                auto ir_callee = Cast<ir::Function>(ir_instruction->GetOperand(i));
+                if (ir_callee && ir_callee_set.insert(ir_callee).second) {
+                    result->push_back(ir_callee);
+                }
+            }
+        }
+        return result;
+    }
+};
+
+/// @brief 按顺序执行pass, 统计每个pass的耗时, 并根据配置打印pass执行后的IR.
+/// prajna.print_after为逗号分隔的pass名, "all"表示所有pass; prajna.time_passes为是否打印耗时.
+/// prajna.verify_level为pass时, 每个pass后验证其修改过的函数, 见VerifyChanged
+class PassManager {
+   protected:
+    PassManager() = default;
+
+   public:
+    static std::shared_ptr<PassManager> Create() {
+        std::shared_ptr<PassManager> self(new PassManager);
+        self->analysis_manager = AnalysisManager::Create();
+        auto print_after = GlobalConfig::Instance().get<std::string>("prajna.print_after", "");
+        boost::split(self->print_after_set, print_after, boost::is_any_of(","));
+        self->print_after_set.erase("");
+        self->time_passes = GlobalConfig::Instance().get<bool>("prajna.time_passes", false);
+        return self;
+    }
+
+    void AddPass(std::shared_ptr<Pass> pass) { passes.push_back(pass); }
+
+    /// @brief 以函数为参数的变换包装为FunctionTransformPass, 以module为参数的包装为ModuleFunctionPass
+    template <typename Function_>
+    void AddPass(std::string name, Function_ function, PreservedAnalyses preserved_analyses = {}) {
+        if constexpr (std::is_invocable_v<Function_, std::shared_ptr<ir::Function>>) {
+            this->AddPass(FunctionTransformPass::Create(name, function, preserved_analyses));
+        } else {
+            // ModuleFunctionPass修改后所有的分析都会失效
+            PRAJNA_ASSERT(preserved_analyses.empty());
+            this->AddPass(ModuleFunctionPass::Create(name, function));
+        }
+    }
+
+    bool Run(std::shared_ptr<ir::Module> ir_module) {
+        bool changed = false;
+        for (auto pass : passes) {
+            auto name = pass->Name();
+            auto t0 = std::chrono::steady_clock::now();
+            auto pass_changed = pass->RunOnModule(ir_module, analysis_manager);
+            duration_dict[name] += std::chrono::steady_clock::now() - t0;
+            analysis_manager->RemoveExpired();
+            changed = pass_changed || changed;
+
+            if (pass_changed) {
+                this->VerifyChanged(ir_module, pass);
+            }
+
+            if (print_after_set.count("all") || print_after_set.count(name)) {
+                fmt::print("; IR after {} on {}\n{}", name, ir_module->Fullname(),
+                           ir::IRPrinter::Create()->Print(ir_module));
+            }
+        }
+
+        if (time_passes) {
+            this->PrintTimeReport(ir_module);
+        }
+
+        return changed;
+    }
+
+    /// @brief FunctionPass只验证其修改过的函数. ModuleFunctionPass不报告修改过的函数,
+    /// 只能验证整个模块
+    void VerifyChanged(std::shared_ptr<ir::Module> ir_module, std::shared_ptr<Pass> pass) {
+        if (ir::GetVerifyLevel() < ir::VerifyLevel::pass) return;
+
+        if (pass->changed_functions.empty()) {
+            ir::Verify(ir_module);
+            return;
+        }
+        for (auto ir_function : pass->changed_functions) {
+            PRAJNA_VERIFY(Lock(ir_function->parent) == ir_module);
+            ir::Verify(ir_function);
+        }
+    }
+
+    void PrintTimeReport(std::shared_ptr<ir::Module> ir_module) {
+        std::chrono::duration<double, std::milli> total(0);
+        fmt::print("; pass timing for {}\n", ir_module->Fullname());
+        std::set<std::string> reported_name_set;
+        for (auto pass : passes) {
+            // 同名的pass可能执行多次, 合并统计
+            if (!reported_name_set.insert(pass->Name()).second) continue;
+
+            std::chrono::duration<double, std::milli> duration = duration_dict[pass->Name()];
+            fmt::print("{:>12.3f} ms  {}\n", duration.count(), pass->Name());
+            total += duration;
+        }
+        fmt::print("{:>12.3f} ms  total\n", total.count());
+    }
+
+   public:
+    std::list<std::shared_ptr<Pass>> passes;
+    std::shared_ptr<AnalysisManager> analysis_manager = nullptr;
+    std::set<std::string> print_after_set;
+    bool time_passes = false;
+
+   private:
+    std::map<std::string, std::chrono::steady_clock::duration> duration_dict;
+};
+
+}  // namespace prajna::transform
@@ -1,12 +1,15 @@
 #pragma once
 
+#include <map>
 #include <memory>
+#include <set>
 #include <stack>
 
 #include "prajna/ir/ir.hpp"
 #include "prajna/logger.hpp"
 #include "prajna/lowering/statement_lowering_visitor.hpp"
 #include "prajna/parser/parse.h"
+#include "prajna/transform/pass_manager.hpp"
 #include "prajna/transform/transform_pass.hpp"
 #include "prajna/transform/utility.hpp"
 
@@ -23,6 +26,7 @@ namespace prajna::transform {
 namespace {
 
 const std::string DISABLE_REFERENCE_COUNT = "DisableReferenceCount";
+const std::string NAMED_RETURN_VALUE = "NamedReturnValue";
 
 std::shared_ptr<lowering::IrBuilder> MakeIRbuilder() {
     auto ir_builder = lowering::IrBuilder::Create();
@@ -86,7 +90,8 @@ inline void InsertFinalizeLocalVariableForBlock(std::shared_ptr<ir::Block> ir_bl
     }
 
     ir_local_variable_list.remove_if([](std::shared_ptr<ir::LocalVariable> ir_local_variable) {
-        return ir_local_variable->annotation_dict.count(DISABLE_REFERENCE_COUNT);
+        return ir_local_variable->annotation_dict.count(DISABLE_REFERENCE_COUNT) ||
+               ir_local_variable->annotation_dict.count(NAMED_RETURN_VALUE);
     });
     while (!ir_local_variable_list.empty()) {
         auto ir_local_variable = ir_local_variable_list.front();
@@ -128,10 +133,15 @@ inline void InsertVariableIncrementReferenceCount(std::shared_ptr<ir::Module> ir
     }
 }
 
-inline void InsertDestroyForCall(std::shared_ptr<ir::Module> ir_module) {
-    auto ir_calls = utility::GetAll<ir::Call>(ir_module);
-    for (auto ir_call : ir_calls) {
-        if (lowering::HasFinalize(ir_call->type)) {
+inline void InsertDestroyForCall(std::shared_ptr<ir::Module> ir_module,
+                                 std::shared_ptr<AnalysisManager> analysis_manager) {
+    for (auto ir_function : ir_module->functions) {
+        // 插入指令后函数的索引会失效, 故复制一份
+        auto ir_calls = analysis_manager->Get<ValueIndexAnalysis>(ir_function)->GetAll<ir::Call>();
+        bool changed = false;
+        for (auto ir_call : ir_calls) {
+            if (!lowering::HasFinalize(ir_call->type)) continue;
+
             auto ir_builder = MakeIRbuilder();
             auto scope = ir_builder->PushBlockRAII(ir_call->GetParentBlock());
 
@@ -141,6 +151,7 @@ inline void InsertDestroyForCall(std::shared_ptr<ir::Module> ir_module) {
                 auto iter = std::ranges::find(*ir_call->GetParentBlock(), ir_call);
                 ir_builder->inserter_iterator = std::next(iter);
                 FinalizeVariableLikedCallback(ir_call, ir_builder);
+                changed = true;
             } else {
                 auto ir_instruction_use_call =
                     Lock(ir_call->instruction_with_index_list.back().instruction);
@@ -164,8 +175,12 @@ inline void InsertDestroyForCall(std::shared_ptr<ir::Module> ir_module) {
                 ir_builder->inserter_iterator =
                     std::next(ir_instruction_use_call->GetBlockIterator());
                 FinalizeVariableLikedCallback(ir_call, ir_builder);
+                changed = true;
             }
         }
+        if (changed) {
+            analysis_manager->Invalidate(ir_function);
+        }
     }
 }
 
@@ -178,6 +193,10 @@ inline void InsertCopyForReturn(std::shared_ptr<ir::Module> ir_module) {
                 if (Is<ir::Call>(ir_return->Value())) {
                     continue;
                 }
+                // 具名返回值的引用直接转移给调用方
+                if (ir_return->annotation_dict.count(NAMED_RETURN_VALUE)) {
+                    continue;
+                }
 
                 auto ir_builder = MakeIRbuilder();
                 auto parent = ir_return->GetParentBlock();
@@ -190,14 +209,249 @@ inline void InsertCopyForReturn(std::shared_ptr<ir::Module> ir_module) {
     }
 }
 
+/// @brief 由@borrow参数写入的局部变量(包括VariableLikedNormalize产生的临时变量)若不会再被写入,
+/// 则只是参数的别名, 参数的生命周期由调用方保证, 故无需__initialize__/__copy__/__finalize__
+inline void DisableReferenceCountForBorrowedParameters(
+    std::shared_ptr<ir::Module> ir_module, std::shared_ptr<AnalysisManager> analysis_manager) {
+    for (auto ir_function : ir_module->functions) {
+        if (std::ranges::none_of(ir_function->parameters, [](std::shared_ptr<ir::Parameter> x) {
+                return x->is_borrowed;
+            })) {
+            continue;
+        }
+
+        std::list<std::shared_ptr<ir::WriteVariableLiked>> ir_borrow_writes;
+        std::map<std::shared_ptr<ir::Value>, int64_t> ir_borrow_write_count_dict;
+        std::set<std::shared_ptr<ir::Value>> ir_written_variable_set;
+        // 只添加标注, 不修改函数体, 函数的索引仍然有效
+        auto ir_value_index = analysis_manager->Get<ValueIndexAnalysis>(ir_function);
+        for (auto ir_write_variable_liked : ir_value_index->GetAll<ir::WriteVariableLiked>()) {
+            auto ir_parameter = Cast<ir::Parameter>(ir_write_variable_liked->Value());
+            if (ir_parameter && ir_parameter->is_borrowed &&
+                Is<ir::LocalVariable>(ir_write_variable_liked->variable())) {
+                ir_borrow_writes.push_back(ir_write_variable_liked);
+                ++ir_borrow_write_count_dict[ir_write_variable_liked->variable()];
+                continue;
+            }
+
+            // 写入字段或元素也视为写入了变量本身
+            std::shared_ptr<ir::Value> ir_variable = ir_write_variable_liked->variable();
+            while (true) {
+                if (auto ir_access_field = Cast<ir::AccessField>(ir_variable)) {
+                    ir_variable = ir_access_field->object();
+                    continue;
+                }
+                if (auto ir_index_array = Cast<ir::IndexArray>(ir_variable)) {
+                    ir_variable = ir_index_array->object();
+                    continue;
+                }
+                break;
+            }
+            ir_written_variable_set.insert(ir_variable);
+        }
+
+        for (auto ir_write_variable_liked : ir_borrow_writes) {
+            std::shared_ptr<ir::Value> ir_local_variable = ir_write_variable_liked->variable();
+            if (ir_written_variable_set.count(ir_local_variable) ||
+                ir_borrow_write_count_dict[ir_local_variable] > 1) {
+                continue;
+            }
+
+            ir_local_variable->annotation_dict[DISABLE_REFERENCE_COUNT];
+            ir_write_variable_liked->annotation_dict[DISABLE_REFERENCE_COUNT];
+        }
+    }
+}
+
+/// @brief 所有return都返回同一个函数顶层的局部变量时(如Create函数里的self),
+/// 该变量持有的引用直接转移给调用方, 省去return时的__copy__和离开作用域时的__finalize__
+inline void MarkNamedReturnValue(std::shared_ptr<ir::Module> ir_module,
+                                 std::shared_ptr<AnalysisManager> analysis_manager) {
+    for (auto ir_function : ir_module->functions) {
+        if (ir_function->blocks.empty()) {
+            continue;
+        }
+
+        auto ir_value_index = analysis_manager->Get<ValueIndexAnalysis>(ir_function);
+        auto& ir_returns = ir_value_index->GetAll<ir::Return>();
+        if (ir_returns.empty()) {
+            continue;
+        }
+        auto ir_local_variable = Cast<ir::LocalVariable>(ir_returns.front()->Value());
+        // 借用参数的别名本身不持有引用, 无法转移
+        if (!ir_local_variable ||
+            ir_local_variable->annotation_dict.count(DISABLE_REFERENCE_COUNT) ||
+            ir_local_variable->GetParentBlock() != ir_function->blocks.front()) {
+            continue;
+        }
+        if (!std::ranges::all_of(ir_returns, [=](std::shared_ptr<ir::Return> ir_return) {
+                return ir_return->Value() == ir_local_variable;
+            })) {
+            continue;
+        }
+
+        ir_local_variable->annotation_dict[NAMED_RETURN_VALUE];
+        for (auto ir_return : ir_returns) {
+            ir_return->annotation_dict[NAMED_RETURN_VALUE];
+        }
+    }
+}
+
+/// @brief 局部变量p = Ptr<T>::New()若只被写入这一次(和p在同一个块里, 且在p的其他使用之前),
+/// 且只作为下列成员函数的this指针使用,
+/// 则其指向的对象不会逃逸出p的作用域, 可改为栈上的局部变量, 省去malloc/free和引用计数.
+/// 栈上对象和p在同一个块里, 其__initialize__/__finalize__由局部变量的规则插入
+inline void PromoteNonEscapingPtrToStack(std::shared_ptr<ir::Module> ir_module,
+                                         std::shared_ptr<AnalysisManager> analysis_manager) {
+    if (!ir_module->symbol_table) return;
+
+    auto ir_builder = lowering::IrBuilder::Create(ir_module->symbol_table, ir_module, nullptr);
+    // Ptr定义之前的内建模块里不会有Ptr
+    auto ptr_template_struct =
+        lowering::SymbolGet<lowering::TemplateStruct>(ir_builder->GetSymbolByPath(false, {"Ptr"}));
+    if (!ptr_template_struct) return;
+
+    for (auto ir_function : ir_module->functions) {
+        // 改写后函数的索引会失效, 故复制一份
+        auto ir_calls = analysis_manager->Get<ValueIndexAnalysis>(ir_function)->GetAll<ir::Call>();
+        bool changed = false;
+        for (auto ir_call : ir_calls) {
+            auto ir_ptr_type = ir_call->type;
+            if (ir_ptr_type->template_struct != ptr_template_struct) continue;
+            auto iter_new_function = ir_ptr_type->static_function_dict.find("New");
+            if (iter_new_function == ir_ptr_type->static_function_dict.end() ||
+                ir_call->Function() != iter_new_function->second) {
+                continue;
+            }
+
+            if (ir_call->instruction_with_index_list.size() != 1) continue;
+            auto ir_write_variable_liked = Cast<ir::WriteVariableLiked>(
+                Lock(ir_call->instruction_with_index_list.front().instruction));
+            if (!ir_write_variable_liked) continue;
+            auto ir_local_variable = Cast<ir::LocalVariable>(ir_write_variable_liked->variable());
+            if (!ir_local_variable) continue;
+            // 栈上对象在写入所在的块结束时析构, 故写入需和p在同一个块里(不能在分支或循环里),
+            // 且p的其他使用都在写入之后
+            auto parent = ir_write_variable_liked->GetParentBlock();
+            if (parent != ir_local_variable->GetParentBlock()) continue;
+            std::set<std::shared_ptr<ir::Value>> ir_values_before_write;
+            for (auto ir_value : *parent) {
+                if (ir_value == ir_write_variable_liked) break;
+                ir_values_before_write.insert(ir_value);
+            }
+            // 使用所在的, 直接位于parent里的语句; 不在parent里时返回nullptr
+            auto get_statement_in_parent = [=](std::shared_ptr<ir::Value> ir_value) {
+                while (ir_value) {
+                    auto ir_parent_value = Lock(ir_value->parent);
+                    if (ir_parent_value == parent) return ir_value;
+                    ir_value = ir_parent_value;
+                }
+                return std::shared_ptr<ir::Value>(nullptr);
+            };
+            auto is_after_write = [&](ir::InstructionAndOperandIndex instruction_with_index) {
+                auto ir_statement =
+                    get_statement_in_parent(Lock(instruction_with_index.instruction));
+                return ir_statement && !ir_values_before_write.count(ir_statement);
+            };
+            if (!std::ranges::all_of(ir_local_variable->instruction_with_index_list,
+                                     is_after_write)) {
+                continue;
+            }
+
+            std::set<std::shared_ptr<ir::Value>> ir_non_escaping_functions;
+            for (auto member_function_name : {"__arrow__", "__get_linear_index__",
+                                              "__set_linear_index__", "IsNull", "IsValid",
+                                              "ReferenceCount"}) {
+                ir_non_escaping_functions.insert(
+                    ir_builder->GetMemberFunction(ir_ptr_type, member_function_name));
+            }
+            ir_non_escaping_functions.erase(nullptr);
+            auto is_escaping = [&](ir::InstructionAndOperandIndex instruction_with_index) {
+                auto ir_instruction = Lock(instruction_with_index.instruction);
+                if (ir_instruction == ir_write_variable_liked) return false;
+                auto ir_get_address = Cast<ir::GetAddressOfVariableLiked>(ir_instruction);
+                if (!ir_get_address) return true;
+                return std::ranges::any_of(
+                    ir_get_address->instruction_with_index_list,
+                    [&](ir::InstructionAndOperandIndex this_pointer_with_index) {
+                        auto ir_member_call = Cast<ir::Call>(
+                            Lock(this_pointer_with_index.instruction));
+                        return !ir_member_call || this_pointer_with_index.operand_index != 1 ||
+                               !ir_non_escaping_functions.count(ir_member_call->Function());
+                    });
+            };
+            if (std::ranges::any_of(ir_local_variable->instruction_with_index_list,
+                                    is_escaping)) {
+                continue;
+            }
+
+            auto get_pointee_field_type = [=](std::string field_name) {
+                auto iter_field = std::ranges::find_if(ir_ptr_type->fields, [=](auto ir_field) {
+                    return ir_field->name == field_name;
+                });
+                PRAJNA_ASSERT(iter_field != ir_ptr_type->fields.end());
+                return Cast<ir::PointerType>((*iter_field)->type)->value_type;
+            };
+
+            {
+                // 对象本身需要正常的初始化和析构
+                auto scope = ir_builder->PushBlockRAII(parent);
+                ir_builder->inserter_iterator = ir_write_variable_liked->GetBlockIterator();
+                auto ir_object =
+                    ir_builder->Create<ir::LocalVariable>(get_pointee_field_type("raw_ptr"));
+                auto ir_control_block = ir_builder->Create<ir::LocalVariable>(
+                    get_pointee_field_type("_control_block"));
+
+                auto ir_no_count_builder = MakeIRbuilder();
+                ir_no_count_builder->symbol_table = ir_module->symbol_table;
+                auto no_count_scope = ir_no_count_builder->PushBlockRAII(parent);
+                ir_no_count_builder->inserter_iterator = ir_builder->inserter_iterator;
+                ir_no_count_builder->Create<ir::WriteVariableLiked>(
+                    ir_no_count_builder->GetConstant<int64_t>(1),
+                    ir_no_count_builder->AccessField(ir_control_block, "strong_count"));
+                ir_no_count_builder->Create<ir::WriteVariableLiked>(
+                    ir_no_count_builder->GetConstant<int64_t>(0),
+                    ir_no_count_builder->AccessField(ir_control_block, "weak_count"));
+                ir_no_count_builder->Create<ir::WriteVariableLiked>(
+                    ir_no_count_builder->GetAddressOf(ir_object),
+                    ir_no_count_builder->AccessField(ir_local_variable, "raw_ptr"));
+                ir_no_count_builder->Create<ir::WriteVariableLiked>(
+                    ir_no_count_builder->GetConstant<int64_t>(1),
+                    ir_no_count_builder->AccessField(ir_local_variable, "size"));
+                ir_no_count_builder->Create<ir::WriteVariableLiked>(
+                    ir_no_count_builder->GetAddressOf(ir_control_block),
+                    ir_no_count_builder->AccessField(ir_local_variable, "_control_block"));
+            }
+
+            ir_local_variable->annotation_dict[DISABLE_REFERENCE_COUNT];
+            utility::RemoveFromParent(ir_write_variable_liked);
+            ir_write_variable_liked->Finalize();
+            utility::RemoveFromParent(ir_call);
+            ir_call->Finalize();
+            changed = true;
+        }
+        if (changed) {
+            analysis_manager->Invalidate(ir_function);
+        }
+    }
+}
+
 }  // namespace
 
-inline void InsertReferenceCount(std::shared_ptr<ir::Module> ir_module) {
-    InsertDestroyForCall(ir_module);  // 放在第一个, 否则插入的指令会影响
+/// @note 前面几步共用analysis_manager里函数的索引, 修改了函数的步骤需使其失效
+/// @return 总是视为修改了函数体, 之后所有的分析都会失效
+inline bool InsertReferenceCount(std::shared_ptr<ir::Module> ir_module,
+                                 std::shared_ptr<AnalysisManager> analysis_manager) {
+    PromoteNonEscapingPtrToStack(ir_module, analysis_manager);
+    // 放在插入引用计数之前, 否则插入的指令会影响
+    InsertDestroyForCall(ir_module, analysis_manager);
+    DisableReferenceCountForBorrowedParameters(ir_module, analysis_manager);
+    MarkNamedReturnValue(ir_module, analysis_manager);
     InsertLocalVariableInitialize(ir_module);
     InsertVariableIncrementReferenceCount(ir_module);
     InsertCopyForReturn(ir_module);
     InsertLoacalVariableScopeDecrementReferenceCount(ir_module);
+    return true;
 }
 
 }  // namespace prajna::transform
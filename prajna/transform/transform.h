@@ -2,15 +2,20 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <stack>
+#include <vector>
 
 #include "prajna/ir/ir.hpp"
 #include "prajna/logger.hpp"
 #include "prajna/lowering/statement_lowering_visitor.hpp"
 #include "prajna/mangle_name.hpp"
 #include "prajna/parser/parse.h"
+#include "prajna/transform/devirtualize_dynamic_call_pass.hpp"
+#include "prajna/transform/mark_canonical_loop_pass.hpp"
 #include "prajna/transform/flattern_block.hpp"
 #include "prajna/transform/inline_function.hpp"
+#include "prajna/transform/pass_manager.hpp"
 #include "prajna/transform/reference_count.hpp"
 #include "prajna/transform/transform_pass.hpp"
 #include "prajna/transform/utility.hpp"
@@ -24,8 +29,8 @@ class Statements;
 
 namespace prajna::transform {
 
-inline bool ConvertPropertyToFunctionCall(std::shared_ptr<ir::Module> ir_module) {
-    auto ir_access_properties = utility::GetAll<ir::AccessProperty>(ir_module);
+inline bool ConvertPropertyToFunctionCall(std::shared_ptr<ir::Function> ir_function) {
+    auto ir_access_properties = utility::GetAll<ir::AccessProperty>(ir_function);
     for (auto ir_access_property : ir_access_properties) {
         auto ir_block = ir_access_property->GetParentBlock();
         auto ir_builder = lowering::IrBuilder::Create();
@@ -80,33 +85,107 @@ inline bool ConvertPropertyToFunctionCall(std::shared_ptr<ir::Module> ir_module)
     return !ir_access_properties.empty();
 }
 
-inline bool DeclareExternalFunction(std::shared_ptr<ir::Module> ir_module) {
-    Each<ir::Instruction>(ir_module, [=](std::shared_ptr<ir::Instruction> ir_instruction) {
-        for (int64_t i = 0; i < ir_instruction->OperandSize(); ++i) {
-            auto ir_operand = ir_instruction->GetOperand(i);
+/// @brief 剪除不可达的模板实例. 模板是按实参整体实例化的, 大部分实例并不会被用到.
+/// 非模板实例的函数, 测试, 核函数, 命令及Main函数作为根, 从根出发不可达的实例不参与codegen.
+/// 被剪除的实例会标注"pruned"并保留在模板的实例缓存里, 之后的模块(如REPL)再引用时会把它收养过来
+inline bool PruneUnreachableTemplateInstances(std::shared_ptr<ir::Module> ir_module) {
+    auto is_root = [](std::shared_ptr<ir::Function> ir_function) {
+        if (ir_function->IsDeclaration()) return true;
+        if (!ir_function->annotation_dict.count("template_instance")) return true;
+        if (ir_function->Name() == "Main") return true;
+        for (auto annotation : {"test", "kernel", "target", "\\command"}) {
+            if (ir_function->annotation_dict.count(annotation)) return true;
+        }
+        // 全局变量属于原模块, 收养到其他模块后无法引用, 不剪除
+        for (auto ir_instruction : utility::GetAll<ir::Instruction>(ir_function)) {
+            for (int64_t i = 0; i < ir_instruction->OperandSize(); ++i) {
+                if (Is<ir::GlobalAlloca>(ir_instruction->GetOperand(i))) return true;
+            }
+        }
+        return false;
+    };
 
-            if (auto ir_function = Cast<ir::Function>(ir_operand)) {
-                if (ir_function->GetParentModule() != ir_module) {
-                    std::shared_ptr<ir::Function> ir_decl_function = nullptr;
-                    auto iter_fun = std::ranges::find_if(ir_module->functions, [=](auto ir_x) {
-                        return ir_x->Fullname() == ir_function->Fullname();
-                    });
-                    // 声明过了, 就不在声明了
-                    if (iter_fun != ir_module->functions.end()) {
-                        ir_decl_function = *iter_fun;
-                    } else {
-                        ir_decl_function = ir::Function::Create(ir_function->function_type);
-                        ir_decl_function->Fullname(ir_function->Fullname());
-                        ir_decl_function->Name(ir_function->Name());
-                        ir_decl_function->parent = ir_module;
-                        ir_module->functions.push_front(ir_decl_function);
-                    }
+    std::set<std::shared_ptr<ir::Function>> ir_reachable_function_set;
+    std::list<std::shared_ptr<ir::Function>> ir_worklist;
+    for (auto ir_function : ir_module->functions) {
+        if (is_root(ir_function)) {
+            ir_reachable_function_set.insert(ir_function);
+            ir_worklist.push_back(ir_function);
+        }
+    }
+    // 虚表的初始值引用的函数同样是根
+    for (auto ir_global_alloca : ir_module->global_allocas) {
+        for (auto ir_function : ir_global_alloca->initialize_functions) {
+            if (ir_function->GetParentModule() != ir_module) continue;
+            if (ir_reachable_function_set.insert(ir_function).second) {
+                ir_worklist.push_back(ir_function);
+            }
+        }
+    }
 
-                    ir_instruction->SetOperand(i, ir_decl_function);
+    while (!ir_worklist.empty()) {
+        auto ir_function = ir_worklist.front();
+        ir_worklist.pop_front();
+        for (auto ir_callee : *CalleeAnalysis::Run(ir_function)) {
+            if (ir_callee->GetParentModule() != ir_module) continue;
+            if (ir_reachable_function_set.insert(ir_callee).second) {
+                ir_worklist.push_back(ir_callee);
+            }
+        }
+    }
+
+    bool changed = false;
+    for (auto ir_function : Clone(ir_module->functions)) {
+        if (ir_reachable_function_set.count(ir_function)) continue;
+
+        ir_function->annotation_dict["pruned"];
+        ir_module->RemoveFunction(ir_function);
+        changed = true;
+    }
+
+    return changed;
+}
+
+inline bool DeclareExternalFunction(std::shared_ptr<ir::Module> ir_module) {
+    // 收养过来的函数也需要处理其引用的外部函数
+    auto ir_functions = ir_module->functions;
+    while (!ir_functions.empty()) {
+        auto ir_function = ir_functions.front();
+        ir_functions.pop_front();
+
+        for (auto ir_instruction : utility::GetAll<ir::Instruction>(ir_function)) {
+            for (int64_t i = 0; i < ir_instruction->OperandSize(); ++i) {
+                auto ir_operand = ir_instruction->GetOperand(i);
+                auto ir_callee = Cast<ir::Function>(ir_operand);
+                if (!ir_callee || ir_callee->GetParentModule() == ir_module) continue;
+
+                // 被剪除的模板实例没有生成代码, 将其收养到当前模块
+                if (ir_callee->annotation_dict.count("pruned")) {
+                    ir_callee->annotation_dict.erase("pruned");
+                    ir_module->AddFunction(ir_callee);
+                    ir_functions.push_back(ir_callee);
+                    continue;
                 }
+
+                std::shared_ptr<ir::Function> ir_decl_function = nullptr;
+                auto iter_fun = std::ranges::find_if(ir_module->functions, [=](auto ir_x) {
+                    return ir_x->Fullname() == ir_callee->Fullname();
+                });
+                // 声明过了, 就不在声明了
+                if (iter_fun != ir_module->functions.end()) {
+                    ir_decl_function = *iter_fun;
+                } else {
+                    ir_decl_function = ir::Function::Create(ir_callee->function_type);
+                    ir_decl_function->Fullname(ir_callee->Fullname());
+                    ir_decl_function->Name(ir_callee->Name());
+                    ir_decl_function->parent = ir_module;
+                    ir_module->functions.push_front(ir_decl_function);
+                }
+
+                ir_instruction->SetOperand(i, ir_decl_function);
             }
         }
-    });
+    }
 
     return true;
 }
@@ -205,9 +284,7 @@ inline void PartitionGpuKernelsAndMarkTargets(std::shared_ptr<ir::Module> ir_mod
             ir_global_variable->is_external = false;
             ir_module->AddGlobalVariable(ir_global_variable);
             // 替换所有对 kernel 函数的引用为这个 GlobalVariable
-            for (auto [ir_instruction, op_idx] : Clone(ir_function->instruction_with_index_list)) {
-                Lock(ir_instruction)->SetOperand(op_idx, ir_global_variable);
-            }
+            ir_function->ReplaceAllUsesWith(ir_global_variable);
         }
     }
 
@@ -219,7 +296,7 @@ inline void PartitionGpuKernelsAndMarkTargets(std::shared_ptr<ir::Module> ir_mod
         for (auto ir_function : ir_module->functions) {
             if (std::ranges::count(ir_function->annotation_dict["target"], target_str)) {
                 auto ir_function_new = Cast<ir::Function>(function_cloner->Clone(ir_function));
-                PRAJNA_ASSERT(ir::Verify(ir_function_new));
+                PRAJNA_ASSERT(ir::Verify(ir_function_new, ir::VerifyLevel::pass));
             }
         }
     }
@@ -308,6 +385,7 @@ inline void ConvertGlobalVariableToGlobalAlloca(std::shared_ptr<ir::Module> ir_m
         ir_global_alloca->Fullname(ir_global_variable->Fullname());
         // ir_global_variable->is_external默认为false
         ir_global_alloca->is_external = ir_global_variable->is_external;
+        ir_global_alloca->initialize_functions = ir_global_variable->initialize_functions;
         ir_module->AddGlobalAlloca(ir_global_alloca);
 
         for (auto [wp_ir_instruction, op_idx] :
@@ -325,87 +403,394 @@ inline void ConvertGlobalVariableToGlobalAlloca(std::shared_ptr<ir::Module> ir_m
 }
 
 // @brief 移除return后面的指令. 若不移除, 会存在未知错误
-inline void RemoveValuesAfterReturn(std::shared_ptr<ir::Module> ir_module) {
-    for (auto ir_function : ir_module->functions) {
-        for (auto ir_block : ir_function->blocks) {
-            auto iter_return = std::ranges::find_if(*ir_block, [](auto x) {
-                return Is<ir::Return>(x) || Is<ir::internal::JumpBranch>(x) ||
-                       Is<ir::internal::ConditionBranch>(x);
-            });
-            if (iter_return != ir_block->end()) {
-                ir_block->erase(std::next(iter_return), ir_block->end());
-            }
+inline bool RemoveValuesAfterReturn(std::shared_ptr<ir::Function> ir_function) {
+    bool changed = false;
+    for (auto ir_block : ir_function->blocks) {
+        auto iter_return = std::ranges::find_if(*ir_block, [](auto x) {
+            return Is<ir::Return>(x) || Is<ir::internal::JumpBranch>(x) ||
+                   Is<ir::internal::ConditionBranch>(x);
+        });
+        if (iter_return != ir_block->end() && std::next(iter_return) != ir_block->end()) {
+            ir_block->erase(std::next(iter_return), ir_block->end());
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+/// @brief 将多维循环线性化为一个一维循环, 每次迭代通过Layout将线性索引换算为数组索引
+inline void ConvertForMultiDimToLinearFor(std::shared_ptr<ir::For> ir_for,
+                                          std::shared_ptr<ir::Module> ir_module) {
+    auto ir_builder = lowering::IrBuilder::Create();
+    ir_builder->symbol_table = ir_module->symbol_table;
+    auto parent = ir_for->GetParentBlock();
+    auto scope = ir_builder->PushBlockRAII(parent);
+    ir_builder->inserter_iterator = parent->Find(ir_for);
+    auto ir_layout_template_struct = lowering::SymbolGet<lowering::TemplateStruct>(
+        ir_builder->GetSymbolByPath(true, {"tensor", "Layout"}));
+    PRAJNA_ASSERT(ir_layout_template_struct);
+    auto ir_array_first = ir_for->First();
+    auto ir_array_last = ir_for->Last();
+    auto ir_array_type = ir_array_last->type;
+    auto ir_array_template_arguments =
+        std::any_cast<std::list<lowering::Symbol>>(ir_array_type->template_arguments_any);
+    auto ir_rank = lowering::SymbolGet<ir::ConstantInt>(ir_array_template_arguments.back());
+    std::list<lowering::Symbol> template_arguments = {ir_rank};
+    auto ir_layout_type = ir_layout_template_struct->Instantiate(template_arguments, ir_module);
+    // TODO: should use static_function_dict
+    auto ir_layout =
+        ir_builder->Create<ir::Call>(ir_builder->GetStaticFunction(ir_layout_type, "Create"),
+                                     std::list<std::shared_ptr<ir::Value>>{ir_for->Last()});
+    auto ir_linear_first = ir_builder->GetConstant<int64_t>(0);
+
+    // auto ir_array_one = lowering::SymbolGet<lowering::Template
+    // ir_builder->GetSymbolByPath(true, {"_array", "Array"}); auto ir_arra
+
+    auto ir_array_one_template = lowering::SymbolGet<lowering::Template>(
+        ir_builder->GetSymbolByPath(true, {"_array", "__ArrayOne"}));
+    PRAJNA_ASSERT(ir_array_one_template);
+    auto ir_array_one_fun = lowering::SymbolGet<ir::Value>(
+        ir_array_one_template->Instantiate({ir_array_template_arguments.back()}, ir_module));
+
+    // TODO: 可能涉及模板特化, 后面再做处理
+    auto ir_array_one = ir_builder->Call(ir_array_one_fun);
+    auto ir_array_range = ir_builder->CallBinaryOperator(
+        ir_builder->CallBinaryOperator(ir_array_last, "-", ir_array_first), "-", ir_array_one);
+    auto ir_linear_last = ir_builder->CallBinaryOperator(
+        ir_builder->CallMemberFunction(ir_layout, "ArrayIndexToLinearIndex", {ir_array_range}),
+        "+", ir_builder->GetConstant<int64_t>(1));
+
+    ir_for->First(ir_linear_first);
+    ir_for->Last(ir_linear_last);
+    auto ir_array_index = ir_for->IndexVariable();
+    auto ir_linear_index = ir_builder->Create<ir::LocalVariable>(ir::i64);
+    ir_for->IndexVariable(ir_linear_index);
+
+    auto ir_array_first_variable = ir_builder->VariableLikedNormalize(ir_array_first);
+    auto ir_layout_variable = ir_builder->VariableLikedNormalize(ir_layout);
+
+    {
+        auto scope = ir_builder->PushBlockRAII(ir_for->LoopBlock());
+        ir_builder->inserter_iterator = ir_for->LoopBlock()->begin();
+
+        utility::RemoveFromParent(ir_array_index);
+        ir_builder->Insert(ir_array_index);
+        ir_builder->Create<ir::WriteVariableLiked>(
+            ir_builder->CallBinaryOperator(
+                ir_builder->CallMemberFunction(ir_layout_variable, "LinearIndexToArrayIndex",
+                                               {ir_linear_index}),
+                "+", ir_array_first_variable),
+            ir_array_index);
+    }
+}
+
+/// @brief 将多维循环展开为逐维嵌套的一维循环, 最内层循环对应最后一维(内存连续),
+/// 避免每次迭代都要做除法和取模. 原循环作为最外层, 故break可直接跳出整个嵌套
+inline void ConvertForMultiDimToLoopNest(std::shared_ptr<ir::For> ir_for,
+                                         std::shared_ptr<ir::Module> ir_module) {
+    auto ir_builder = lowering::IrBuilder::Create();
+    ir_builder->symbol_table = ir_module->symbol_table;
+    auto parent = ir_for->GetParentBlock();
+    auto scope = ir_builder->PushBlockRAII(parent);
+    ir_builder->inserter_iterator = parent->Find(ir_for);
+
+    auto ir_array_first = ir_for->First();
+    auto ir_array_last = ir_for->Last();
+    auto ir_array_index = ir_for->IndexVariable();
+    auto ir_array_template_arguments =
+        std::any_cast<std::list<lowering::Symbol>>(ir_array_last->type->template_arguments_any);
+    auto rank = lowering::SymbolGet<ir::ConstantInt>(ir_array_template_arguments.back())->value;
+
+    // 各维的范围在循环外计算
+    std::vector<std::shared_ptr<ir::LocalVariable>> ir_firsts;
+    std::vector<std::shared_ptr<ir::LocalVariable>> ir_lasts;
+    for (int64_t i = 0; i < rank; ++i) {
+        ir_firsts.push_back(ir_builder->CloneValue(
+            ir_builder->AccessLinearIndex(ir_array_first, ir_builder->GetConstant<int64_t>(i))));
+        ir_lasts.push_back(ir_builder->CloneValue(
+            ir_builder->AccessLinearIndex(ir_array_last, ir_builder->GetConstant<int64_t>(i))));
+    }
+
+    std::vector<std::shared_ptr<ir::LocalVariable>> ir_indices;
+    ir_indices.push_back(ir_builder->Create<ir::LocalVariable>(ir::i64));
+    ir_for->IndexVariable(ir_indices.front());
+    ir_for->First(ir_firsts.front());
+    ir_for->Last(ir_lasts.front());
+
+    // 循环体移到最内层
+    auto ir_loop_block = ir_for->LoopBlock();
+    auto ir_body = Clone(*ir_loop_block);
+    ir_loop_block->clear();
+
+    auto ir_innermost_for = ir_for;
+    for (int64_t i = 1; i < rank; ++i) {
+        auto scope = ir_builder->PushBlockRAII(ir_innermost_for->LoopBlock());
+        ir_indices.push_back(ir_builder->Create<ir::LocalVariable>(ir::i64));
+        ir_innermost_for = ir_builder->Create<ir::For>(ir_indices.back(), ir_firsts[i],
+                                                       ir_lasts[i], ir::Block::Create());
+    }
+
+    {
+        auto scope = ir_builder->PushBlockRAII(ir_innermost_for->LoopBlock());
+        utility::RemoveFromParent(ir_array_index);
+        ir_builder->Insert(ir_array_index);
+        for (int64_t i = 0; i < rank; ++i) {
+            ir_builder->Create<ir::WriteProperty>(
+                ir_indices[i],
+                ir_builder->AccessLinearIndex(ir_array_index, ir_builder->GetConstant<int64_t>(i)));
+        }
+        for (auto ir_value : ir_body) {
+            ir_innermost_for->LoopBlock()->PushBack(ir_value);
+        }
+    }
+
+    // continue应进入下一个元素, 即最内层循环的下一次迭代
+    for (auto [ir_instruction, op_idx] : Clone(ir_for->instruction_with_index_list)) {
+        if (auto ir_continue = Cast<ir::Continue>(Lock(ir_instruction))) {
+            ir_continue->SetOperand(op_idx, ir_innermost_for);
         }
     }
 }
 
-inline void ConvertForMultiDimToFor1Dim(std::shared_ptr<ir::Module> ir_module) {
-    auto ir_fors = utility::GetAll<ir::For>(ir_module);
+/// @brief 多维循环默认展开为嵌套循环, 标注了linear的循环和gpu循环保持线性化的形式
+inline bool ConvertForMultiDimToFor1Dim(std::shared_ptr<ir::Function> ir_function) {
+    bool changed = false;
+    auto ir_module = ir_function->GetParentModule();
+    auto ir_fors = utility::GetAll<ir::For>(ir_function);
     for (auto ir_for : ir_fors) {
         auto ir_builder = lowering::IrBuilder::Create();
         ir_builder->symbol_table = ir_module->symbol_table;
         // 只需要对数组循环进行处理
         if (!ir_builder->IsArrayI64Type(ir_for->IndexVariable()->type)) continue;
-        auto parent = ir_for->GetParentBlock();
-        auto scope = ir_builder->PushBlockRAII(parent);
-        ir_builder->inserter_iterator = parent->Find(ir_for);
-        auto ir_layout_template_struct = lowering::SymbolGet<lowering::TemplateStruct>(
-            ir_builder->GetSymbolByPath(true, {"tensor", "Layout"}));
-        PRAJNA_ASSERT(ir_layout_template_struct);
-        auto ir_array_first = ir_for->First();
-        auto ir_array_last = ir_for->Last();
-        auto ir_array_type = ir_array_last->type;
-        auto ir_array_template_arguments =
-            std::any_cast<std::list<lowering::Symbol>>(ir_array_type->template_arguments_any);
-        auto ir_rank = lowering::SymbolGet<ir::ConstantInt>(ir_array_template_arguments.back());
-        std::list<lowering::Symbol> template_arguments = {ir_rank};
-        auto ir_layout_type = ir_layout_template_struct->Instantiate(template_arguments, ir_module);
-        // TODO: should use static_function_dict
-        auto ir_layout =
-            ir_builder->Create<ir::Call>(ir_builder->GetStaticFunction(ir_layout_type, "Create"),
-                                         std::list<std::shared_ptr<ir::Value>>{ir_for->Last()});
-        auto ir_linear_first = ir_builder->GetConstant<int64_t>(0);
-
-        // auto ir_array_one = lowering::SymbolGet<lowering::Template
-        // ir_builder->GetSymbolByPath(true, {"_array", "Array"}); auto ir_arra
-
-        auto ir_array_one_template = lowering::SymbolGet<lowering::Template>(
-            ir_builder->GetSymbolByPath(true, {"_array", "__ArrayOne"}));
-        PRAJNA_ASSERT(ir_array_one_template);
-        auto ir_array_one_fun = lowering::SymbolGet<ir::Value>(
-            ir_array_one_template->Instantiate({ir_array_template_arguments.back()}, ir_module));
-
-        // TODO: 可能涉及模板特化, 后面再做处理
-        auto ir_array_one = ir_builder->Call(ir_array_one_fun);
-        auto ir_array_range = ir_builder->CallBinaryOperator(
-            ir_builder->CallBinaryOperator(ir_array_last, "-", ir_array_first), "-", ir_array_one);
-        auto ir_linear_last = ir_builder->CallBinaryOperator(
-            ir_builder->CallMemberFunction(ir_layout, "ArrayIndexToLinearIndex", {ir_array_range}),
-            "+", ir_builder->GetConstant<int64_t>(1));
-
-        ir_for->First(ir_linear_first);
-        ir_for->Last(ir_linear_last);
-        auto ir_array_index = ir_for->IndexVariable();
-        auto ir_linear_index = ir_builder->Create<ir::LocalVariable>(ir::i64);
-        ir_for->IndexVariable(ir_linear_index);
-
-        auto ir_array_first_variable = ir_builder->VariableLikedNormalize(ir_array_first);
-        auto ir_layout_variable = ir_builder->VariableLikedNormalize(ir_layout);
-
-        {
-            auto scope = ir_builder->PushBlockRAII(ir_for->LoopBlock());
-            ir_builder->inserter_iterator = ir_for->LoopBlock()->begin();
-
-            utility::RemoveFromParent(ir_array_index);
-            ir_builder->Insert(ir_array_index);
-            ir_builder->Create<ir::WriteVariableLiked>(
-                ir_builder->CallBinaryOperator(
-                    ir_builder->CallMemberFunction(ir_layout_variable, "LinearIndexToArrayIndex",
-                                                   {ir_linear_index}),
-                    "+", ir_array_first_variable),
-                ir_array_index);
+
+        if (ir_for->annotation_dict.count("linear") || ir_for->annotation_dict.count("nvgpu")) {
+            ConvertForMultiDimToLinearFor(ir_for, ir_module);
+        } else {
+            ConvertForMultiDimToLoopNest(ir_for, ir_module);
         }
+        changed = true;
     }
+
+    return changed;
+}
+
+/// @brief 并行循环体依赖的外部值, 按首次使用的顺序排列
+inline std::list<std::shared_ptr<ir::Value>> GetParallelForExternalValues(
+    std::shared_ptr<ir::For> ir_for) {
+    auto ir_loop_values = utility::GetAll<ir::Value>(ir_for->LoopBlock());
+    std::set<std::shared_ptr<ir::Value>> ir_loop_value_set(ir_loop_values.begin(),
+                                                            ir_loop_values.end());
+    std::list<std::shared_ptr<ir::Value>> ir_external_values;
+    std::set<std::shared_ptr<ir::Value>> ir_external_value_set;
+    for (auto ir_value : ir_loop_values) {
+        auto ir_instruction = Cast<ir::Instruction>(ir_value);
+        if (!ir_instruction) continue;
+        for (int64_t i = 0; i < ir_instruction->OperandSize(); ++i) {
+            auto ir_operand = ir_instruction->GetOperand(i);
+            if (!ir_operand || ir::IsGlobal(ir_operand)) continue;
+            if (ir_loop_value_set.count(ir_operand)) continue;
+            if (ir_operand == ir_for || ir_operand == ir_for->IndexVariable()) continue;
+            if (ir_external_value_set.insert(ir_operand).second) {
+                ir_external_values.push_back(ir_operand);
+            }
+        }
+    }
+
+    return ir_external_values;
+}
+
+/// @brief 引用计数不是原子的, 有__copy__或__finalize__的外部值在并行循环体里只能被借用:
+/// 取地址(成员函数和属性的this指针), 访问字段, 或写入只被写入一次的局部变量作为别名.
+/// 别名的写入会被收集到ir_alias_writes里, 以便关闭它们的引用计数
+inline bool IsOnlyBorrowedInParallelFor(
+    std::shared_ptr<ir::Value> ir_value,
+    const std::set<std::shared_ptr<ir::Value>>& ir_loop_value_set,
+    std::list<std::shared_ptr<ir::WriteVariableLiked>>& ir_alias_writes,
+    std::shared_ptr<ir::WriteVariableLiked> ir_alias_write = nullptr) {
+    if (!lowering::HasCopy(ir_value->type) && !lowering::HasFinalize(ir_value->type)) {
+        return true;
+    }
+
+    for (auto [ir_instruction, op_idx] : Clone(ir_value->instruction_with_index_list)) {
+        auto ir_user = Lock(ir_instruction);
+        if (!ir_loop_value_set.count(ir_user) || ir_user == ir_alias_write) continue;
+        if (Is<ir::GetAddressOfVariableLiked>(ir_user)) continue;
+        if ((Is<ir::AccessField>(ir_user) || Is<ir::IndexArray>(ir_user)) && op_idx == 0) {
+            if (!IsOnlyBorrowedInParallelFor(ir_user, ir_loop_value_set, ir_alias_writes)) {
+                return false;
+            }
+            continue;
+        }
+        if (auto ir_write_variable_liked = Cast<ir::WriteVariableLiked>(ir_user);
+            ir_write_variable_liked && op_idx == 0) {
+            auto ir_local_variable = Cast<ir::LocalVariable>(ir_write_variable_liked->variable());
+            if (!ir_local_variable || !ir_loop_value_set.count(ir_local_variable)) return false;
+            // 别名的其他写入会落到最后的分支而被拒绝
+            ir_alias_writes.push_back(ir_write_variable_liked);
+            if (!IsOnlyBorrowedInParallelFor(ir_local_variable, ir_loop_value_set,
+                                             ir_alias_writes, ir_write_variable_liked)) {
+                return false;
+            }
+            continue;
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+/// @brief 将并行循环的循环体抽离为函数(context, first, last), 由运行时的线程池分块执行.
+/// 循环体用到的外部值按地址捕获, 多个线程修改同一外部值时需用户自己保证没有数据竞争
+inline void OutlineParallelFor(std::shared_ptr<ir::For> ir_for,
+                               std::shared_ptr<ir::Module> ir_module, int64_t parallel_for_id) {
+    auto ir_builder = lowering::IrBuilder::Create(ir_module->symbol_table, ir_module, nullptr);
+    auto ir_parallel_for_function = Cast<ir::Function>(lowering::SymbolGet<ir::Value>(
+        ir_builder->GetSymbolByPath(true, {"bindings", "parallel_for"})));
+    PRAJNA_ASSERT(ir_parallel_for_function);
+    auto ir_undef_pointer_type = ir::PointerType::Create(ir::UndefType::Create());
+
+    int64_t grain_size = 0;
+    int64_t schedule = 1;  // 0: static, 1: dynamic, 与运行时的ThreadPool::Schedule一致
+    for (auto value : ir_for->annotation_dict["parallel"]) {
+        if (value == "static") {
+            schedule = 0;
+        } else if (value == "dynamic") {
+            schedule = 1;
+        } else {
+            grain_size = std::stoll(value);
+        }
+    }
+
+    auto ir_loop_values = utility::GetAll<ir::Value>(ir_for->LoopBlock());
+    std::set<std::shared_ptr<ir::Value>> ir_loop_value_set(ir_loop_values.begin(),
+                                                            ir_loop_values.end());
+    auto ir_external_values = GetParallelForExternalValues(ir_for);
+
+    // 在原循环的位置把外部值的地址写入context, 并调用运行时
+    auto ir_block = ir_for->GetParentBlock();
+    auto scope = ir_builder->PushBlockRAII(ir_block);
+    ir_builder->inserter_iterator = ir_block->Find(ir_for);
+    auto ir_context = ir_builder->Create<ir::LocalVariable>(ir::ArrayType::Create(
+        ir_undef_pointer_type, std::max<int64_t>(ir_external_values.size(), 1)));
+    int64_t context_index = 0;
+    for (auto ir_value : ir_external_values) {
+        auto ir_address = ir_builder->Create<ir::BitCast>(
+            ir_builder->Create<ir::GetAddressOfVariableLiked>(
+                ir_builder->VariableLikedNormalize(ir_value)),
+            ir_undef_pointer_type);
+        ir_builder->Create<ir::WriteVariableLiked>(
+            ir_address, ir_builder->Create<ir::IndexArray>(
+                            ir_context, ir_builder->GetConstant<int64_t>(context_index++)));
+    }
+
+    auto ir_body_function = ir::Function::Create(ir::FunctionType::Create(
+        {ir_undef_pointer_type, ir::i64, ir::i64}, ir::VoidType::Create()));
+    auto body_function_name = "__parallel_for_" + std::to_string(parallel_for_id);
+    ir_body_function->Name(body_function_name);
+    ir_body_function->Fullname(ir_for->GetParentFunction()->Fullname() + "::" +
+                               body_function_name);
+    ir_module->AddFunction(ir_body_function);
+
+    auto ir_body_function_parameter_type =
+        *std::next(ir_parallel_for_function->function_type->parameter_types.begin(), 4);
+    ir_builder->Call(
+        ir_parallel_for_function, ir_for->First(), ir_for->Last(),
+        ir_builder->GetConstant<int64_t>(grain_size), ir_builder->GetConstant<int64_t>(schedule),
+        ir_builder->Create<ir::BitCast>(ir_body_function, ir_body_function_parameter_type),
+        ir_builder->Create<ir::BitCast>(
+            ir_builder->Create<ir::GetAddressOfVariableLiked>(ir_builder->Create<ir::IndexArray>(
+                ir_context, ir_builder->GetConstant<int64_t>(0))),
+            ir_undef_pointer_type));
+
+    // 循环体移入新函数, 在[first, last)上串行执行
+    auto ir_body_builder = lowering::IrBuilder::Create(ir_module->symbol_table, ir_module, nullptr);
+    ir_body_builder->CreateTopBlockForFunction(ir_body_function);
+    auto iter_parameter = ir_body_function->parameters.begin();
+    auto ir_context_parameter = *iter_parameter++;
+    auto ir_first_parameter = *iter_parameter++;
+    auto ir_last_parameter = *iter_parameter++;
+    auto ir_context_pointer = ir_body_builder->VariableLikedNormalize(
+        ir_body_builder->Create<ir::BitCast>(ir_context_parameter,
+                                             ir::PointerType::Create(ir_undef_pointer_type)));
+    context_index = 0;
+    for (auto ir_value : ir_external_values) {
+        auto ir_address = ir_body_builder->Create<ir::IndexPointer>(
+            ir_context_pointer, ir_body_builder->GetConstant<int64_t>(context_index++));
+        auto ir_captured_value =
+            ir_body_builder->Create<ir::DeferencePointer>(ir_body_builder->Create<ir::BitCast>(
+                ir_address, ir::PointerType::Create(ir_value->type)));
+        for (auto [ir_instruction, op_idx] : Clone(ir_value->instruction_with_index_list)) {
+            auto iter_ir_instruction = Lock(ir_instruction);
+            if (ir_loop_value_set.count(iter_ir_instruction)) {
+                iter_ir_instruction->SetOperand(op_idx, ir_captured_value);
+            }
+        }
+    }
+
+    auto ir_index = ir_body_builder->Create<ir::LocalVariable>(ir::i64);
+    auto ir_old_index = ir_for->IndexVariable();
+    for (auto [ir_instruction, op_idx] : Clone(ir_old_index->instruction_with_index_list)) {
+        auto iter_ir_instruction = Lock(ir_instruction);
+        if (ir_loop_value_set.count(iter_ir_instruction)) {
+            iter_ir_instruction->SetOperand(op_idx, ir_index);
+        }
+    }
+    auto ir_body_for = ir_body_builder->Create<ir::For>(ir_index, ir_first_parameter,
+                                                        ir_last_parameter, ir_for->LoopBlock());
+    ir_body_for->annotation_dict = ir_for->annotation_dict;
+    ir_body_for->annotation_dict.erase("parallel");
+    for (auto [ir_instruction, op_idx] : Clone(ir_for->instruction_with_index_list)) {
+        if (auto ir_continue = Cast<ir::Continue>(Lock(ir_instruction))) {
+            ir_continue->SetOperand(op_idx, ir_body_for);
+        }
+    }
+    ir_body_builder->ReturnVoid();
+
+    utility::RemoveFromParent(ir_for);
+    ir_for->Finalize();
+}
+
+/// @brief 处理标注了parallel的循环,
+/// 标注的参数可为调度方式("static"或"dynamic", 默认为dynamic)和每块的迭代数.
+/// 需在InsertReferenceCount之前执行, 借用的外部值及其别名不会被插入__copy__/__finalize__
+inline bool ConvertParallelForToCall(std::shared_ptr<ir::Module> ir_module) {
+    bool changed = false;
+    int64_t parallel_for_id = 0;
+    for (auto ir_function : Clone(ir_module->functions)) {
+        for (auto ir_for : utility::GetAll<ir::For>(ir_function)) {
+            if (!ir_for->annotation_dict.count("parallel")) continue;
+            // break和return无法在线程间传递, 这样的循环仍然串行执行
+            auto ir_loop_values = utility::GetAll<ir::Value>(ir_for->LoopBlock());
+            if (std::ranges::any_of(ir_loop_values, [](std::shared_ptr<ir::Value> ir_value) {
+                    return Is<ir::Break>(ir_value) || Is<ir::Return>(ir_value);
+                })) {
+                continue;
+            }
+
+            // 复制或释放外部值会在线程间竞争地修改引用计数, 这样的循环也串行执行
+            std::set<std::shared_ptr<ir::Value>> ir_loop_value_set(ir_loop_values.begin(),
+                                                                    ir_loop_values.end());
+            std::list<std::shared_ptr<ir::WriteVariableLiked>> ir_alias_writes;
+            if (!std::ranges::all_of(GetParallelForExternalValues(ir_for),
+                                     [&](std::shared_ptr<ir::Value> ir_value) {
+                                         return IsOnlyBorrowedInParallelFor(
+                                             ir_value, ir_loop_value_set, ir_alias_writes);
+                                     })) {
+                continue;
+            }
+            for (auto ir_write_variable_liked : ir_alias_writes) {
+                ir_write_variable_liked->variable()->annotation_dict[DISABLE_REFERENCE_COUNT];
+                ir_write_variable_liked->annotation_dict[DISABLE_REFERENCE_COUNT];
+            }
+
+            OutlineParallelFor(ir_for, ir_module, parallel_for_id++);
+            changed = true;
+        }
+    }
+
+    return changed;
 }
 
 inline bool WrapIntrinsicFunction(std::shared_ptr<ir::Module> ir_module) {
@@ -442,10 +827,12 @@ inline bool WrapIntrinsicFunction(std::shared_ptr<ir::Module> ir_module) {
 }
 
 inline bool ConvertClosure(std::shared_ptr<ir::Module> ir_module) {
+    bool changed = false;
     for (auto iter_function = ir_module->functions.rbegin();
          iter_function != ir_module->functions.rend(); ++iter_function) {
         auto ir_function = *iter_function;
         if (!ir_function->closure) continue;
+        changed = true;
 
         auto ir_external_values = utility::CaptureExternalValueInClosure(ir_function);
         std::map<std::shared_ptr<ir::Value>, std::shared_ptr<ir::Field>> ir_value_field_map;
@@ -497,57 +884,50 @@ inline bool ConvertClosure(std::shared_ptr<ir::Module> ir_module) {
         }
     }
 
-    return false;
+    return changed;
 }
 
-inline bool ExternCFunction(std::shared_ptr<ir::Module> ir_module) {
-    for (auto ir_function : ir_module->functions) {
-        if (ir_function->annotation_dict.count("extern")) {
-            // @extern的全名不加前缀
-            ir_function->Fullname(ir_function->Name());
-            // auto ir_decl_function = ir::Function::Create(ir_function->function_type);
-            // ir_decl_function->Fullname(ir_function->Name());
-            // ir_decl_function->parent_module = ir_module;
-            // ir_module->functions.push_front(ir_decl_function);
-
-            // ir_function->annotation_dict["inline"];
-
-            // PRAJNA_ASSERT(ir_function->blocks.empty());
-            // auto ir_builder = lowering::IrBuilder::Create();
-            // ir_builder->CreateTopBlockForFunction(ir_function);
-            // auto ir_call = ir_builder->Create<ir::Call>(ir_decl_function,
-            // ir_function->parameters); if
-            // (!Is<ir::VoidType>(ir_decl_function->function_type->return_type)) {
-            //     ir_builder->Create<ir::Return>(ir_call);
-            // }
-
-            ir_function->annotation_dict.erase("extern");
-        }
-    }
-
-    return false;
+/// @brief 只修改函数的名字和标注, 不影响函数体的分析
+inline bool ExternCFunction(std::shared_ptr<ir::Function> ir_function) {
+    if (!ir_function->annotation_dict.count("extern")) return false;
+
+    // @extern的全名不加前缀
+    ir_function->Fullname(ir_function->Name());
+    // auto ir_decl_function = ir::Function::Create(ir_function->function_type);
+    // ir_decl_function->Fullname(ir_function->Name());
+    // ir_decl_function->parent_module = ir_module;
+    // ir_module->functions.push_front(ir_decl_function);
+
+    // ir_function->annotation_dict["inline"];
+
+    // PRAJNA_ASSERT(ir_function->blocks.empty());
+    // auto ir_builder = lowering::IrBuilder::Create();
+    // ir_builder->CreateTopBlockForFunction(ir_function);
+    // auto ir_call = ir_builder->Create<ir::Call>(ir_decl_function,
+    // ir_function->parameters); if
+    // (!Is<ir::VoidType>(ir_decl_function->function_type->return_type)) {
+    //     ir_builder->Create<ir::Return>(ir_call);
+    // }
+
+    ir_function->annotation_dict.erase("extern");
+    return true;
 }
 
 inline void TopologicalSortFunctionVisit(
     std::shared_ptr<ir::Function> ir_function,
     std::list<std::shared_ptr<ir::Function>>& ir_function_list,
-    std::set<std::shared_ptr<ir::Function>>& ir_gray_function_set) {
+    std::set<std::shared_ptr<ir::Function>>& ir_gray_function_set,
+    std::shared_ptr<AnalysisManager> analysis_manager) {
     // 标记要访问的函数
     ir_gray_function_set.insert(ir_function);
-    auto ir_instructions = utility::GetAll<ir::Instruction>(ir_function);
-    for (auto ir_instruction : ir_instructions) {
-        for (int64_t i = 0; i < ir_instruction->OperandSize(); ++i) {
-            auto ir_operand = ir_instruction->GetOperand(i);
-            if (auto ir_tmp_function = Cast<ir::Function>(ir_operand)) {
-                // 值排序同一个module里的函数
-                if (ir_tmp_function->parent.lock() == ir_function->parent.lock()) {
-                    // 没访问的进行深度搜索
-                    if (ir_gray_function_set.count(ir_tmp_function)) continue;
-
-                    TopologicalSortFunctionVisit(ir_tmp_function, ir_function_list,
-                                                 ir_gray_function_set);
-                }
-            }
+    for (auto ir_tmp_function : *analysis_manager->Get<CalleeAnalysis>(ir_function)) {
+        // 值排序同一个module里的函数
+        if (ir_tmp_function->parent.lock() == ir_function->parent.lock()) {
+            // 没访问的进行深度搜索
+            if (ir_gray_function_set.count(ir_tmp_function)) continue;
+
+            TopologicalSortFunctionVisit(ir_tmp_function, ir_function_list, ir_gray_function_set,
+                                         analysis_manager);
         }
     }
 
@@ -555,19 +935,23 @@ inline void TopologicalSortFunctionVisit(
     ir_function_list.push_back(ir_function);
 }
 
-inline void TopologicalSortFunction(std::shared_ptr<ir::Module> ir_module) {
+/// @note 只调整函数的顺序, 不修改函数体
+inline bool TopologicalSortFunction(std::shared_ptr<ir::Module> ir_module,
+                                    std::shared_ptr<AnalysisManager> analysis_manager) {
     std::list<std::shared_ptr<ir::Function>> ir_function_list;
     std::set<std::shared_ptr<ir::Function>> ir_gray_function_set;
     for (auto ir_function : ir_module->functions) {
         if (ir_gray_function_set.count(ir_function)) continue;
 
-        TopologicalSortFunctionVisit(ir_function, ir_function_list, ir_gray_function_set);
+        TopologicalSortFunctionVisit(ir_function, ir_function_list, ir_gray_function_set,
+                                     analysis_manager);
     }
 
     ir_module->functions.remove_if(
         [=](auto ir_function) { return std::ranges::count(ir_function_list, ir_function); });
     ir_module->functions.insert(ir_module->functions.end(), ir_function_list.begin(),
                                 ir_function_list.end());
+    return false;
 }
 
 inline bool TopAlloca(std::shared_ptr<ir::Module> ir_module) {
@@ -653,18 +1037,17 @@ inline void ConvertSharedMemoryLocalVariableToGlobalAllocaWithAddressSpace3(
                                                     ir_global_alloca, ir_global_alloca->type);
         auto ir_deference_pointer = ir_builder->Create<ir::DeferencePointer>(ir_address_cast);
 
-        for (auto [ir_instruction, op_idx] :
-             Clone(ir_shared_variable->instruction_with_index_list)) {
-            Lock(ir_instruction)->SetOperand(op_idx, ir_deference_pointer);
-        }
+        ir_shared_variable->ReplaceAllUsesWith(ir_deference_pointer);
 
         utility::RemoveFromParent(ir_shared_variable);
         ir_shared_variable->Finalize();
     }
 }
 
-inline bool InsertLocationForAssert(std::shared_ptr<ir::Module> ir_module) {
-    auto ir_calls = utility::GetAll<ir::Call>(ir_module);
+inline bool InsertLocationForAssert(std::shared_ptr<ir::Function> ir_function) {
+    bool changed = false;
+    auto ir_module = ir_function->GetParentModule();
+    auto ir_calls = utility::GetAll<ir::Call>(ir_function);
     for (auto ir_call : ir_calls) {
         if (auto ir_callee = Cast<ir::Function>(ir_call->Function())) {
             if (ir_callee->Fullname() == "::test::Assert") {
@@ -684,6 +1067,7 @@ inline bool InsertLocationForAssert(std::shared_ptr<ir::Module> ir_module) {
                     std::list<std::shared_ptr<ir::Value>>{ir_condition, filename, line});
                 utility::RemoveFromParent(ir_call);
                 ir_call->Finalize();
+                changed = true;
                 continue;
             }
             if (ir_callee->Fullname() == "::debug::Assert") {
@@ -703,61 +1087,74 @@ inline bool InsertLocationForAssert(std::shared_ptr<ir::Module> ir_module) {
                     std::list<std::shared_ptr<ir::Value>>{ir_condition, filename, line});
                 utility::RemoveFromParent(ir_call);
                 ir_call->Finalize();
+                changed = true;
                 continue;
             }
         }
     }
 
-    return false;
+    return changed;
 }
 
 inline void ApplySSATransformations(std::shared_ptr<ir::Module> ir_module) {
-    bool changed = true;
-    while (changed) {
-        changed = InsertValueToBlock(ir_module);
-        changed = ConvertVariableToDeferencePointer(ir_module) || changed;
-        changed = ConvertAccessFieldToGetStructElementPointer(ir_module) || changed;
-        changed = ConvertIndexArrayToGetArrayElementPointer(ir_module) || changed;
-        changed = ConvertIndexPointerToGetPointerElementPointer(ir_module) || changed;
-        changed = ConvertGetAddressOfVaraibleLikedToPointer(ir_module) || changed;
-    }
+    InsertValueToBlock(ir_module);
+    ConvertVariableLikedToPointer(ir_module);
     // 需要全部转为Deference才能进行, 因为上面的转换是围绕其进行的
     ConvertDeferencePointerToStoreAndLoadPointer(ir_module);
     TopAlloca(ir_module);
 }
 
 inline std::shared_ptr<ir::Module> Transform(std::shared_ptr<ir::Module> ir_module) {
-    PRAJNA_ASSERT(ir::Verify(ir_module));
-    ConvertClosure(ir_module);
-    WrapIntrinsicFunction(ir_module);
-    ExternCFunction(ir_module);
-    InsertLocationForAssert(ir_module);
-    ConvertForMultiDimToFor1Dim(ir_module);
-    ConvertPropertyToFunctionCall(ir_module);
-    InsertReferenceCount(ir_module);
-    TopologicalSortFunction(ir_module);
-    InlineFunction(ir_module);
-    FlatternBlock(ir_module);
-    RemoveValuesAfterReturn(ir_module);
-    ConvertPropertyToFunctionCall(ir_module);
-    ConvertKernelFunctionCallToKernelLaunch(ir_module);
-    PartitionGpuKernelsAndMarkTargets(ir_module);
-    ConvertGlobalVariableToGlobalAlloca(ir_module);
-    ApplySSATransformations(ir_module);
+    PRAJNA_ASSERT(ir::Verify(ir_module, ir::VerifyLevel::module));
+    auto pass_manager = PassManager::Create();
+    pass_manager->AddPass("ConvertClosure", ConvertClosure);
+    pass_manager->AddPass("WrapIntrinsicFunction", WrapIntrinsicFunction);
+    pass_manager->AddPass("ExternCFunction", ExternCFunction,
+                          Preserve<ValueIndexAnalysis, CalleeAnalysis>());
+    pass_manager->AddPass("InsertLocationForAssert", InsertLocationForAssert);
+    pass_manager->AddPass("ConvertForMultiDimToFor1Dim", ConvertForMultiDimToFor1Dim);
+    pass_manager->AddPass("ConvertParallelForToCall", ConvertParallelForToCall);
+    pass_manager->AddPass("ConvertPropertyToFunctionCall", ConvertPropertyToFunctionCall);
+    pass_manager->AddPass("InsertReferenceCount", InsertReferenceCount);
+    pass_manager->AddPass("TopologicalSortFunction", TopologicalSortFunction);
+    pass_manager->AddPass("InlineFunction", InlineFunction);
+    pass_manager->AddPass(DevirtualizeDynamicCallPass::Create());
+    pass_manager->AddPass(MarkCanonicalLoopPass::Create());
+    // 只把结构化的控制流改写为跳转, 不增删调用
+    pass_manager->AddPass("FlatternBlock", FlatternBlock, Preserve<CalleeAnalysis>());
+    pass_manager->AddPass("RemoveValuesAfterReturn", RemoveValuesAfterReturn);
+    pass_manager->AddPass("ConvertPropertyToFunctionCall", ConvertPropertyToFunctionCall);
+    pass_manager->AddPass("ConvertKernelFunctionCallToKernelLaunch",
+                          ConvertKernelFunctionCallToKernelLaunch);
+    pass_manager->AddPass("PartitionGpuKernelsAndMarkTargets", PartitionGpuKernelsAndMarkTargets);
+    pass_manager->AddPass("ConvertGlobalVariableToGlobalAlloca",
+                          ConvertGlobalVariableToGlobalAlloca);
+    pass_manager->AddPass("ApplySSATransformations", ApplySSATransformations);
+    pass_manager->AddPass("PruneUnreachableTemplateInstances",
+                          PruneUnreachableTemplateInstances);
     // 只申明host module的外部函数, gPU module目前不引用外部函数
-    DeclareExternalFunction(ir_module);
-    PRAJNA_ASSERT(ir::Verify(ir_module));
-
+    pass_manager->AddPass("DeclareExternalFunction", DeclareExternalFunction);
+    pass_manager->Run(ir_module);
+    PRAJNA_ASSERT(ir::Verify(ir_module, ir::VerifyLevel::module));
+
+    auto sub_module_pass_manager = PassManager::Create();
+    sub_module_pass_manager->AddPass(
+        "ConvertSharedMemoryLocalVariableToGlobalAllocaWithAddressSpace3",
+        ConvertSharedMemoryLocalVariableToGlobalAllocaWithAddressSpace3);
+    sub_module_pass_manager->AddPass("ApplySSATransformations", ApplySSATransformations);
+    sub_module_pass_manager->AddPass(
+        "ConvertLLVMIntrinsicToLibdevice", [](std::shared_ptr<ir::Module> ir_sub_module) {
+            if (ir_sub_module->target == ir::Target::nvptx) {
+                ConvertLLVMIntrinsicToNVVMLibdevice(ir_sub_module);
+            } else if (ir_sub_module->target == ir::Target::amdgpu) {
+                ConvertLLVMIntrinsicToAmdGPULibdevice(ir_sub_module);
+            }
+        });
     for (auto ir_sub_module : ir_module->modules) {
         if (!ir_sub_module) continue;
 
-        ConvertSharedMemoryLocalVariableToGlobalAllocaWithAddressSpace3(ir_sub_module);
-        ApplySSATransformations(ir_sub_module);
-        if (ir_sub_module->target == ir::Target::nvptx) {
-            ConvertLLVMIntrinsicToNVVMLibdevice(ir_sub_module);
-        } else if (ir_sub_module->target == ir::Target::amdgpu) {
-            ConvertLLVMIntrinsicToAmdGPULibdevice(ir_sub_module);
-        }
+        sub_module_pass_manager->Run(ir_sub_module);
+        PRAJNA_ASSERT(ir::Verify(ir_sub_module, ir::VerifyLevel::module));
     }
 
     // 确保所有IR都合法, 规则并不完善
@@ -1,16 +1,192 @@
 #pragma once
 
-namespace prajna::ir {
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
 
-class Function;
+#include "prajna/ir/ir.hpp"
 
+namespace prajna::transform {
+
+/// @brief 函数被修改后仍然有效的分析
+using PreservedAnalyses = std::set<std::type_index>;
+
+template <typename... Analysis_>
+inline PreservedAnalyses Preserve() {
+    return {std::type_index(typeid(Analysis_))...};
 }
 
-namespace prajna::transform {
+/// @brief 缓存函数级的分析结果, 函数被修改后需调用Invalidate使其失效.
+/// 分析需定义Result类型和static std::shared_ptr<Result> Run(std::shared_ptr<ir::Function>).
+/// 以weak_ptr为键, 缓存不会延长被移除的函数(如被剪除的模板实例)的生命周期
+class AnalysisManager {
+   protected:
+    AnalysisManager() = default;
+
+   public:
+    static std::shared_ptr<AnalysisManager> Create() {
+        std::shared_ptr<AnalysisManager> self(new AnalysisManager);
+        return self;
+    }
+
+    template <typename Analysis_>
+    std::shared_ptr<typename Analysis_::Result> Get(std::shared_ptr<ir::Function> ir_function) {
+        auto& result = _result_dict[ir_function][std::type_index(typeid(Analysis_))];
+        if (!result) {
+            result = Analysis_::Run(ir_function);
+        }
+        return std::static_pointer_cast<typename Analysis_::Result>(result);
+    }
+
+    void Invalidate(std::shared_ptr<ir::Function> ir_function) { _result_dict.erase(ir_function); }
+
+    /// @brief 使函数的分析结果失效, preserved_analyses里的除外
+    void Invalidate(std::shared_ptr<ir::Function> ir_function,
+                    const PreservedAnalyses& preserved_analyses) {
+        auto iter = _result_dict.find(ir_function);
+        if (iter == _result_dict.end()) return;
+        std::erase_if(iter->second, [&](auto& analysis_result) {
+            return !preserved_analyses.count(analysis_result.first);
+        });
+    }
+
+    void InvalidateAll() { _result_dict.clear(); }
+
+    /// @brief 移除已被释放的函数的分析结果, 结果里可能还持有这些函数的值
+    void RemoveExpired() {
+        std::erase_if(_result_dict, [](auto& function_result) {
+            return function_result.first.expired();
+        });
+    }
+
+   private:
+    std::map<std::weak_ptr<ir::Function>,
+             std::unordered_map<std::type_index, std::shared_ptr<void>>, std::owner_less<>>
+        _result_dict;
+};
+
+class Pass {
+   public:
+    virtual ~Pass() = default;
+
+    /// @brief pass的名字, 用于耗时统计和prajna.print_after
+    virtual std::string Name() const = 0;
+
+    /// @return 是否修改了函数体
+    virtual bool RunOnModule(std::shared_ptr<ir::Module> ir_module,
+                             std::shared_ptr<AnalysisManager> analysis_manager) = 0;
+
+    /// @brief 上次执行修改过的函数, 用于增量验证. 为空而RunOnModule返回true时视为整个模块都可能被修改.
+    /// 只有FunctionPass会填写, ModuleFunctionPass包装的变换不知道修改了哪些函数, 总是为空
+    std::list<std::shared_ptr<ir::Function>> changed_functions;
+};
 
-class FunctionPass {
+/// @brief 逐函数执行的pass, RunOnFunction只能修改传入的函数.
+/// 只有被修改的函数的分析结果会失效, GetPreservedAnalyses返回的分析除外
+class FunctionPass : public Pass {
    public:
     virtual bool RunOnFunction(std::shared_ptr<ir::Function> ir_function) = 0;
+
+    /// @brief 默认修改函数后所有的分析都失效
+    virtual PreservedAnalyses GetPreservedAnalyses() const { return {}; }
+
+    bool RunOnModule(std::shared_ptr<ir::Module> ir_module,
+                     std::shared_ptr<AnalysisManager> analysis_manager) override {
+        this->analysis_manager = analysis_manager;
+        this->changed_functions.clear();
+        auto preserved_analyses = this->GetPreservedAnalyses();
+        for (auto ir_function : ir_module->functions) {
+            if (this->RunOnFunction(ir_function)) {
+                analysis_manager->Invalidate(ir_function, preserved_analyses);
+                this->changed_functions.push_back(ir_function);
+            }
+        }
+        return !this->changed_functions.empty();
+    }
+
+   protected:
+    std::shared_ptr<AnalysisManager> analysis_manager = nullptr;
+};
+
+/// @brief 将以函数为参数的变换函数包装为FunctionPass
+class FunctionTransformPass : public FunctionPass {
+   protected:
+    FunctionTransformPass() = default;
+
+   public:
+    template <typename Function_>
+    static std::shared_ptr<FunctionTransformPass> Create(
+        std::string name, Function_ function, PreservedAnalyses preserved_analyses = {}) {
+        std::shared_ptr<FunctionTransformPass> self(new FunctionTransformPass);
+        self->name = name;
+        self->function = function;
+        self->preserved_analyses = preserved_analyses;
+        return self;
+    }
+
+    std::string Name() const override { return name; }
+
+    bool RunOnFunction(std::shared_ptr<ir::Function> ir_function) override {
+        return function(ir_function);
+    }
+
+    PreservedAnalyses GetPreservedAnalyses() const override { return preserved_analyses; }
+
+   private:
+    std::string name;
+    std::function<bool(std::shared_ptr<ir::Function>)> function;
+    PreservedAnalyses preserved_analyses;
+};
+
+/// @brief 将以module(及AnalysisManager)为参数的变换函数包装为pass,
+/// 返回true时所有的分析结果都会失效, 且verify_level为pass时会验证整个模块.
+/// 只修改个别函数的变换应写成FunctionPass, 以便只失效和验证被修改的函数
+class ModuleFunctionPass : public Pass {
+   protected:
+    ModuleFunctionPass() = default;
+
+   public:
+    template <typename Function_>
+    static std::shared_ptr<ModuleFunctionPass> Create(std::string name, Function_ function) {
+        std::shared_ptr<ModuleFunctionPass> self(new ModuleFunctionPass);
+        self->name = name;
+        self->function = [=](std::shared_ptr<ir::Module> ir_module,
+                             std::shared_ptr<AnalysisManager> analysis_manager) -> bool {
+            if constexpr (std::is_invocable_v<Function_, std::shared_ptr<ir::Module>,
+                                              std::shared_ptr<AnalysisManager>>) {
+                return function(ir_module, analysis_manager);
+            } else if constexpr (std::is_void_v<std::invoke_result_t<
+                                     Function_, std::shared_ptr<ir::Module>>>) {
+                function(ir_module);
+                // 没有返回值的变换无法知道是否修改了函数体, 故视为已修改
+                return true;
+            } else {
+                return function(ir_module);
+            }
+        };
+        return self;
+    }
+
+    std::string Name() const override { return name; }
+
+    bool RunOnModule(std::shared_ptr<ir::Module> ir_module,
+                     std::shared_ptr<AnalysisManager> analysis_manager) override {
+        auto changed = function(ir_module, analysis_manager);
+        if (changed) {
+            analysis_manager->InvalidateAll();
+        }
+        return changed;
+    }
+
+   private:
+    std::string name;
+    std::function<bool(std::shared_ptr<ir::Module>, std::shared_ptr<AnalysisManager>)> function;
 };
 
 }  // namespace prajna::transform
@@ -3,6 +3,7 @@
 #include <list>
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "prajna/ir/ir.hpp"
 #include "prajna/logger.hpp"
@@ -43,178 +44,117 @@ inline bool InsertValueToBlock(std::shared_ptr<ir::Module> ir_module) {
     return changed;
 }
 
-inline bool ConvertVariableToDeferencePointer(std::shared_ptr<ir::Module> ir_module) {
-    bool changed = false;
-
-    for (auto ir_function : ir_module->functions) {
-        //
-        auto ir_variables = utility::GetAll<ir::LocalVariable>(ir_function);
-
-        for (auto ir_variable : ir_variables) {
-            // 改变它自己
-            changed = true;
-            auto ir_constant_1 = ir::ConstantInt::Create(ir::u64, 1);
-            std::shared_ptr<ir::Value> ir_alloca =
-                ir::Alloca::Create(ir_variable->type, ir_constant_1);
-            ir_alloca->Name(ir_variable->Name());
-            ir_alloca->Fullname(ir_variable->Name());
-
-            // @note ir::Alloca不应该出现在循环体内部, 故直接再将其放在函数的第一个块
-            ir_function->blocks.front()->PushFront(ir_alloca);
-            ir_function->blocks.front()->PushFront(ir_constant_1);
-            ir_variable->GetParentBlock()->remove(ir_variable);
-
-            // 改变使用它的
-            for (auto instruction_with_index_list :
-                 Clone(ir_variable->instruction_with_index_list)) {
-                auto ir_inst = Lock(instruction_with_index_list.instruction);
-                int64_t op_idx = instruction_with_index_list.operand_index;
-
-                auto ir_deference_pointer = ir::DeferencePointer::Create(ir_alloca);
-                auto ir_block = ir_inst->GetParentBlock();
-                auto iter = std::ranges::find(*ir_block, ir_inst);
-                ir_block->Insert(iter, ir_deference_pointer);
-                ir_inst->SetOperand(op_idx, ir_deference_pointer);
-            }
-
-            ir_variable->Finalize();
-        }
+/// @brief 在ir_value的每个使用处插入DeferencePointer(ir_pointer)并替换之, 使用者加入工作队列
+inline void ReplaceUsesWithDeferencePointer(std::shared_ptr<ir::Value> ir_value,
+                                            std::shared_ptr<ir::Value> ir_pointer,
+                                            std::list<std::shared_ptr<ir::Value>>& ir_worklist) {
+    for (auto instruction_with_index_list : Clone(ir_value->instruction_with_index_list)) {
+        auto ir_inst = Lock(instruction_with_index_list.instruction);
+        int64_t op_idx = instruction_with_index_list.operand_index;
+
+        auto ir_deference_pointer = ir::DeferencePointer::Create(ir_pointer);
+        auto parent = ir_inst->GetParentBlock();
+        auto iter_inst = std::ranges::find(*parent, ir_inst);
+        parent->Insert(iter_inst, ir_deference_pointer);
+        ir_inst->SetOperand(op_idx, ir_deference_pointer);
+        ir_worklist.push_back(ir_inst);
     }
-
-    return changed;
 }
 
-inline bool ConvertAccessFieldToGetStructElementPointer(std::shared_ptr<ir::Module> ir_module) {
-    bool changed = false;
-    for (auto ir_function : ir_module->functions) {
-        auto ir_access_fields = utility::GetAll<ir::AccessField>(ir_function);
-
-        for (auto ir_access_field : ir_access_fields) {
-            auto ir_object_deference_ptr0 = (ir_access_field->object());
-            auto ir_object_deference_ptr = Cast<ir::DeferencePointer>(ir_object_deference_ptr0);
-            if (!ir_object_deference_ptr) continue;
-
-            changed = true;
-            auto ir_struct_get_element_ptr = ir::GetStructElementPointer::Create(
-                ir_object_deference_ptr->Pointer(), ir_access_field->field);
-
-            for (auto instruction_with_index_list :
-                 Clone(ir_access_field->instruction_with_index_list)) {
-                auto ir_inst = Lock(instruction_with_index_list.instruction);
-                int64_t op_idx = instruction_with_index_list.operand_index;
-
-                auto ir_deference_pointer = ir::DeferencePointer::Create(ir_struct_get_element_ptr);
-                auto parent = ir_inst->GetParentBlock();
-                auto iter_inst = std::ranges::find(*parent, ir_inst);
-                parent->Insert(iter_inst, ir_deference_pointer);
-                ir_inst->SetOperand(op_idx, ir_deference_pointer);
-            }
-
-            utility::ReplaceInBlock(ir_access_field, ir_struct_get_element_ptr);
-            ir_access_field->Finalize();
-        }
+/// @brief 将单个变量类的值转换为基于指针的形式
+/// @return 是否转换, AccessField等需要其对象先转换为DeferencePointer
+inline bool ConvertVariableLikedValueToPointer(std::shared_ptr<ir::Function> ir_function,
+                                               std::shared_ptr<ir::Value> ir_value,
+                                               std::list<std::shared_ptr<ir::Value>>& ir_worklist) {
+    if (auto ir_variable = Cast<ir::LocalVariable>(ir_value)) {
+        auto ir_constant_1 = ir::ConstantInt::Create(ir::u64, 1);
+        std::shared_ptr<ir::Value> ir_alloca = ir::Alloca::Create(ir_variable->type, ir_constant_1);
+        ir_alloca->Name(ir_variable->Name());
+        ir_alloca->Fullname(ir_variable->Name());
+
+        // @note ir::Alloca不应该出现在循环体内部, 故直接再将其放在函数的第一个块
+        ir_function->blocks.front()->PushFront(ir_alloca);
+        ir_function->blocks.front()->PushFront(ir_constant_1);
+        ir_variable->GetParentBlock()->remove(ir_variable);
+
+        ReplaceUsesWithDeferencePointer(ir_variable, ir_alloca, ir_worklist);
+        ir_variable->Finalize();
+        return true;
     }
 
-    return changed;
-}
-
-inline bool ConvertIndexArrayToGetArrayElementPointer(std::shared_ptr<ir::Module> ir_module) {
-    bool changed = false;
-
-    for (auto ir_function : ir_module->functions) {
-        //
-        auto ir_index_arrays = utility::GetAll<ir::IndexArray>(ir_function);
-
-        for (auto ir_index_array : ir_index_arrays) {
-            changed = true;
-
-            auto ir_object_deference_ptr = Cast<ir::DeferencePointer>(ir_index_array->object());
-            if (!ir_object_deference_ptr) continue;
-
-            auto ir_array_get_element_ptr = ir::GetArrayElementPointer::Create(
-                ir_object_deference_ptr->Pointer(), ir_index_array->IndexVariable());
-
-            for (auto instruction_with_index_list :
-                 Clone(ir_index_array->instruction_with_index_list)) {
-                auto ir_inst = Lock(instruction_with_index_list.instruction);
-                int64_t op_idx = instruction_with_index_list.operand_index;
-
-                auto ir_deference_pointer = ir::DeferencePointer::Create(ir_array_get_element_ptr);
-                auto parent = ir_inst->GetParentBlock();
-                auto iter_inst = std::ranges::find(*parent, ir_inst);
-                parent->Insert(iter_inst, ir_deference_pointer);
-                ir_inst->SetOperand(op_idx, ir_deference_pointer);
-            }
+    if (auto ir_access_field = Cast<ir::AccessField>(ir_value)) {
+        auto ir_object_deference_ptr = Cast<ir::DeferencePointer>(ir_access_field->object());
+        if (!ir_object_deference_ptr) return false;
 
-            utility::ReplaceInBlock(ir_index_array, ir_array_get_element_ptr);
-            ir_index_array->Finalize();
-        }
+        auto ir_struct_get_element_ptr = ir::GetStructElementPointer::Create(
+            ir_object_deference_ptr->Pointer(), ir_access_field->field);
+        ReplaceUsesWithDeferencePointer(ir_access_field, ir_struct_get_element_ptr, ir_worklist);
+        utility::ReplaceInBlock(ir_access_field, ir_struct_get_element_ptr);
+        return true;
     }
 
-    return changed;
-}
-
-inline bool ConvertIndexPointerToGetPointerElementPointer(std::shared_ptr<ir::Module> ir_module) {
-    bool changed = false;
-
-    for (auto ir_function : ir_module->functions) {
-        //
-        auto ir_index_pointers = utility::GetAll<ir::IndexPointer>(ir_function);
+    if (auto ir_index_array = Cast<ir::IndexArray>(ir_value)) {
+        auto ir_object_deference_ptr = Cast<ir::DeferencePointer>(ir_index_array->object());
+        if (!ir_object_deference_ptr) return false;
 
-        for (auto ir_index_pointer : ir_index_pointers) {
-            changed = true;
+        auto ir_array_get_element_ptr = ir::GetArrayElementPointer::Create(
+            ir_object_deference_ptr->Pointer(), ir_index_array->IndexVariable());
+        ReplaceUsesWithDeferencePointer(ir_index_array, ir_array_get_element_ptr, ir_worklist);
+        utility::ReplaceInBlock(ir_index_array, ir_array_get_element_ptr);
+        return true;
+    }
 
-            auto ir_object_deference_ptr = Cast<ir::DeferencePointer>(ir_index_pointer->object());
-            if (!ir_object_deference_ptr) continue;
+    if (auto ir_index_pointer = Cast<ir::IndexPointer>(ir_value)) {
+        auto ir_object_deference_ptr = Cast<ir::DeferencePointer>(ir_index_pointer->object());
+        if (!ir_object_deference_ptr) return false;
 
-            auto ir_pointer_get_element_ptr = ir::GetPointerElementPointer::Create(
-                ir_object_deference_ptr->Pointer(), ir_index_pointer->IndexVariable());
+        auto ir_pointer_get_element_ptr = ir::GetPointerElementPointer::Create(
+            ir_object_deference_ptr->Pointer(), ir_index_pointer->IndexVariable());
+        ReplaceUsesWithDeferencePointer(ir_index_pointer, ir_pointer_get_element_ptr, ir_worklist);
+        utility::ReplaceInBlock(ir_index_pointer, ir_pointer_get_element_ptr);
+        return true;
+    }
 
-            for (auto instruction_with_index_list :
-                 Clone(ir_index_pointer->instruction_with_index_list)) {
-                auto ir_inst = Lock(instruction_with_index_list.instruction);
-                int64_t op_idx = instruction_with_index_list.operand_index;
+    if (auto ir_get_address = Cast<ir::GetAddressOfVariableLiked>(ir_value)) {
+        auto ir_deference_pointer = Cast<ir::DeferencePointer>(ir_get_address->variable());
+        if (!ir_deference_pointer) return false;
 
-                auto ir_deference_pointer =
-                    ir::DeferencePointer::Create(ir_pointer_get_element_ptr);
-                auto parent = ir_inst->GetParentBlock();
-                auto iter_inst = std::ranges::find(*parent, ir_inst);
-                parent->Insert(iter_inst, ir_deference_pointer);
-                ir_inst->SetOperand(op_idx, ir_deference_pointer);
-            }
+        PRAJNA_ASSERT(ir_deference_pointer->Pointer());
+        ir_get_address->ReplaceAllUsesWith(ir_deference_pointer->Pointer());
 
-            utility::ReplaceInBlock(ir_index_pointer, ir_pointer_get_element_ptr);
-            ir_index_pointer->Finalize();
-        }
+        utility::RemoveFromParent(ir_get_address);
+        ir_get_address->Finalize();
+        return true;
     }
 
-    return changed;
+    return false;
 }
 
-inline bool ConvertGetAddressOfVaraibleLikedToPointer(std::shared_ptr<ir::Module> ir_module) {
+/// @brief 将LocalVariable, AccessField, IndexArray, IndexPointer和GetAddressOfVariableLiked
+/// 转换为基于指针的形式. 值转换后其使用者会被重新加入工作队列, 故只需遍历一次函数
+inline bool ConvertVariableLikedToPointer(std::shared_ptr<ir::Module> ir_module) {
     bool changed = false;
-
     for (auto ir_function : ir_module->functions) {
-        //
-        auto ir_get_addresses = utility::GetAll<ir::GetAddressOfVariableLiked>(ir_function);
-
-        for (auto ir_get_address : ir_get_addresses) {
-            auto ir_deference_pointer = Cast<ir::DeferencePointer>(ir_get_address->variable());
-            if (!ir_deference_pointer) continue;
-
-            changed = true;
-            for (auto instruction_with_index_list :
-                 Clone(ir_get_address->instruction_with_index_list)) {
-                auto ir_inst = Lock(instruction_with_index_list.instruction);
-                int64_t op_idx = instruction_with_index_list.operand_index;
-
-                ir_deference_pointer->Pointer();
-                PRAJNA_ASSERT(ir_deference_pointer->Pointer());
-                ir_inst->SetOperand(op_idx, ir_deference_pointer->Pointer());
+        std::list<std::shared_ptr<ir::Value>> ir_worklist;
+        EachReadOnly<ir::Value>(ir_function, [&](std::shared_ptr<ir::Value> ir_value) {
+            if (Is<ir::LocalVariable>(ir_value) || Is<ir::AccessField>(ir_value) ||
+                Is<ir::IndexArray>(ir_value) || Is<ir::IndexPointer>(ir_value) ||
+                Is<ir::GetAddressOfVariableLiked>(ir_value)) {
+                ir_worklist.push_back(ir_value);
+            }
+        });
+
+        std::unordered_set<std::shared_ptr<ir::Value>> ir_converted_set;
+        while (!ir_worklist.empty()) {
+            auto ir_value = ir_worklist.front();
+            ir_worklist.pop_front();
+            // 已经转换的值会被Finalize, 不能再处理
+            if (ir_converted_set.count(ir_value)) continue;
+
+            if (ConvertVariableLikedValueToPointer(ir_function, ir_value, ir_worklist)) {
+                ir_converted_set.insert(ir_value);
+                changed = true;
             }
-
-            utility::RemoveFromParent(ir_get_address);
-            ir_get_address->Finalize();
         }
     }
 
@@ -11,7 +11,7 @@ namespace prajna::transform::utility {
 template <typename Value_>
 inline std::list<std::shared_ptr<Value_>> GetAll(std::shared_ptr<ir::Value> ir_value) {
     std::list<std::shared_ptr<Value_>> ir_values;
-    Each<ir::Value>(ir_value, [&ir_values](std::shared_ptr<ir::Value> ir_value) {
+    EachReadOnly<ir::Value>(ir_value, [&ir_values](std::shared_ptr<ir::Value> ir_value) {
         if (auto ir_target_value = Cast<Value_>(ir_value)) {
             ir_values.push_back(ir_target_value);
         }
@@ -39,7 +39,7 @@ inline std::list<std::shared_ptr<ir::Value>> CaptureExternalValueInClosure(
 
     if (!ir_function->closure) return ir_values;
 
-    Each<ir::Value>(ir_function, [&](std::shared_ptr<ir::Value> ir_value) {
+    EachReadOnly<ir::Value>(ir_function, [&](std::shared_ptr<ir::Value> ir_value) {
         if (auto ir_instruction = Cast<ir::Instruction>(ir_value)) {
             for (int64_t i = 0; i < ir_instruction->OperandSize(); ++i) {
                 auto ir_operand = ir_instruction->GetOperand(i);
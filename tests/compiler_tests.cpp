@@ -1,13 +1,23 @@
 
 
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <unordered_map>
 
 #include "fmt/printf.h"
 #include "gtest/gtest.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/InstIterator.h"
+#include "prajna/codegen/llvm_codegen.h"
 #include "prajna/compiler/compiler.h"
 #include "prajna/exception.hpp"
+#include "prajna/logger.hpp"
+#include "prajna/lowering/lower.h"
+#include "prajna/parser/parse.h"
+#include "prajna/source_manager.hpp"
+#include "prajna/transform/transform.h"
 
 using namespace prajna;
 
@@ -60,3 +70,392 @@ TEST_P(PrajnaTests, TestSourceFile) {
 // 会遍历整个文件夹里的文件
 INSTANTIATE_TEST_SUITE_P(PrajnaTestsInstance, PrajnaTests,
                          testing::ValuesIn(getFiles("tests/prajna_sources")), PrintFileName());
+
+TEST(ReplTests, IncrementalReexecution) {
+    auto compiler = Compiler::Create();
+    compiler->CompileBuiltinSourceFiles("builtin_packages");
+
+    std::string output;
+    auto print_callback_backup = print_callback;
+    print_callback = [&output](std::string str) { output += str; };
+    auto execute = [&](std::string code) {
+        output.clear();
+        compiler->ExecuteCodeInRelp(code);
+        return output;
+    };
+
+    EXPECT_EQ(execute("func Value()->i64 { return 1; }\n"), "");
+    // 未修改的定义被复用, 不会报重复定义
+    EXPECT_EQ(execute("func Value()->i64 { return 1; }\nValue().ToString().Print();\n"), "1");
+    // 修改后的定义替换之前的
+    EXPECT_EQ(execute("func Value()->i64 { return 2; }\nValue().ToString().Print();\n"), "2");
+    // 撤销修改后, 之前的定义需重新生效
+    EXPECT_EQ(execute("func Value()->i64 { return 1; }\nValue().ToString().Print();\n"), "1");
+    // 编译失败的重新定义不影响当前的定义
+    EXPECT_NE(execute("func Value()->i64 { return undefined_symbol; }\n"), "");
+    EXPECT_EQ(execute("Value().ToString().Print();\n"), "1");
+    // 只求值的输入会被释放, 反复执行仍然正确
+    for (int64_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(execute("Value().ToString().Print();\n"), "1");
+    }
+    // 源码未变但引用了修改过的函数的定义需重新编译, 否则仍会调用之前的定义
+    EXPECT_EQ(execute("func G()->i64 { return 1; }\n"
+                      "func F()->i64 { return G(); }\n"
+                      "F().ToString().Print();\n"),
+              "1");
+    EXPECT_EQ(execute("func G()->i64 { return 2; }\n"
+                      "func F()->i64 { return G(); }\n"
+                      "F().ToString().Print();\n"),
+              "2");
+    // 反复重新定义时, 被替换的定义会被释放, 结果仍然正确
+    for (int64_t i = 3; i < 6; ++i) {
+        auto value = std::to_string(i);
+        EXPECT_EQ(execute("func G()->i64 { return " + value + "; }\n"
+                          "func F()->i64 { return G(); }\n"
+                          "F().ToString().Print();\n"),
+                  value);
+    }
+    print_callback = print_callback_backup;
+}
+
+TEST(TransformTests, DevirtualizeDynamicCall) {
+    auto compiler = Compiler::Create();
+    compiler->CompileBuiltinSourceFiles("builtin_packages");
+
+    auto ir_module = compiler->CompileCode(
+        "interface Number { func Value()->i64; }\n"
+        "struct Seven {}\n"
+        "implement Number for Seven { func Value()->i64 { return 7; } }\n"
+        "func DirectValue(seven: Ptr<Seven>)->i64 { return seven.As<Number>().Value(); }\n"
+        "func VariableValue(seven: Ptr<Seven>)->i64 {\n"
+        "    var number: Dynamic<Number> = seven.As<Number>();\n"
+        "    return number.Value();\n"
+        "}\n",
+        compiler->_symbol_table, "devirtualize_test", false);
+    ASSERT_TRUE(ir_module);
+
+    int64_t checked_function_count = 0;
+    for (auto ir_function : ir_module->functions) {
+        if (ir_function->Name() != "DirectValue" && ir_function->Name() != "VariableValue") {
+            continue;
+        }
+        ++checked_function_count;
+        // Dynamic的值来自Ptr::As, 虚调用应被替换为对实现的直接调用
+        for (auto ir_call : transform::utility::GetAll<ir::Call>(ir_function)) {
+            auto ir_callee = Cast<ir::Function>(ir_call->Function());
+            EXPECT_FALSE(ir_callee && ir_callee->annotation_dict.count("dynamic_method"))
+                << ir_function->Name();
+        }
+    }
+    EXPECT_EQ(checked_function_count, 2);
+}
+
+TEST(TransformTests, ConvertParallelForToCall) {
+    auto compiler = Compiler::Create();
+    compiler->CompileBuiltinSourceFiles("builtin_packages");
+
+    auto ir_module = compiler->CompileCode(
+        "func ParallelFill() {\n"
+        "    var ts = Tensor<i64, 1>::Create([1000]);\n"
+        "    @parallel\n"
+        "    for i in 0 to 1000 {\n"
+        "        ts[i] = i;\n"
+        "    }\n"
+        "}\n"
+        "func SerialBreak() {\n"
+        "    var ts = Tensor<i64, 1>::Create([1000]);\n"
+        "    @parallel\n"
+        "    for i in 0 to 1000 {\n"
+        "        if (i == 500) {\n"
+        "            break;\n"
+        "        }\n"
+        "        ts[i] = i;\n"
+        "    }\n"
+        "}\n",
+        compiler->_symbol_table, "parallel_for_test", false);
+    ASSERT_TRUE(ir_module);
+
+    auto is_calling_parallel_for = [=](std::string function_name) {
+        auto iter_function =
+            std::ranges::find_if(ir_module->functions, [=](std::shared_ptr<ir::Function> x) {
+                return x->Name() == function_name;
+            });
+        EXPECT_NE(iter_function, ir_module->functions.end()) << function_name;
+        if (iter_function == ir_module->functions.end()) return false;
+        return std::ranges::any_of(transform::utility::GetAll<ir::Call>(*iter_function),
+                                   [](std::shared_ptr<ir::Call> ir_call) {
+                                       auto ir_callee = Cast<ir::Function>(ir_call->Function());
+                                       return ir_callee && ir_callee->Fullname() ==
+                                                               "::bindings::parallel_for";
+                                   });
+    };
+    // 循环体被抽离为函数, 交由运行时并行执行
+    EXPECT_TRUE(is_calling_parallel_for("ParallelFill"));
+    // break无法在线程间传递, 这样的循环仍然串行执行
+    EXPECT_FALSE(is_calling_parallel_for("SerialBreak"));
+    EXPECT_EQ(std::ranges::count_if(ir_module->functions,
+                                    [](std::shared_ptr<ir::Function> ir_function) {
+                                        return ir_function->Name().starts_with("__parallel_for_");
+                                    }),
+              1);
+}
+
+TEST(CodegenTests, CanonicalLoopMetadata) {
+    auto compiler = Compiler::Create();
+    compiler->CompileBuiltinSourceFiles("builtin_packages");
+
+    auto source_buffer = SourceBuffer::Create(
+        "func NestedSum(m: i64, n: i64)->i64 {\n"
+        "    var sum = 0;\n"
+        "    for i in 0 to m {\n"
+        "        for j in 0 to n {\n"
+        "            sum = sum + i * j;\n"
+        "        }\n"
+        "    }\n"
+        "    return sum;\n"
+        "}\n",
+        "canonical_loop_test");
+    auto logger = Logger::Create(source_buffer);
+    auto ast = parser::parse(source_buffer->Code(), source_buffer->FileName(), logger);
+    ASSERT_TRUE(ast);
+    auto ir_module = lowering::lower(ast, compiler->_symbol_table, logger, compiler, false);
+    ir_module = codegen::LlvmCodegen(transform::Transform(ir_module));
+    // 只检查codegen生成的元数据, 不交给jit
+    std::unique_ptr<llvm::Module> up_llvm_module(ir_module->llvm_module);
+
+    int64_t canonical_loop_count = 0;
+    int64_t unroll_and_jam_loop_count = 0;
+    for (auto& llvm_function : *up_llvm_module) {
+        if (llvm_function.getName().find("NestedSum") == llvm::StringRef::npos) continue;
+        for (auto& llvm_instruction : llvm::instructions(llvm_function)) {
+            auto llvm_loop_id = llvm_instruction.getMetadata(llvm::LLVMContext::MD_loop);
+            if (!llvm_loop_id) continue;
+            if (llvm::findOptionMDForLoopID(llvm_loop_id, codegen::CANONICAL_LOOP_METADATA)) {
+                ++canonical_loop_count;
+            }
+            if (llvm::findOptionMDForLoopID(llvm_loop_id, "llvm.loop.unroll_and_jam.enable")) {
+                ++unroll_and_jam_loop_count;
+            }
+        }
+    }
+    // 两层循环都会被标注, 只有外层循环直接包含标注过的循环
+    EXPECT_EQ(canonical_loop_count, 2);
+    EXPECT_EQ(unroll_and_jam_loop_count, 1);
+}
+
+TEST(SourceManagerTests, Line) {
+    auto source_buffer = SourceBuffer::Create("a\nbc\n\nd", "line_test");
+    EXPECT_EQ(source_buffer->LineCount(), 4);
+    EXPECT_EQ(source_buffer->Line(1), "a");
+    EXPECT_EQ(source_buffer->Line(2), "bc");
+    EXPECT_EQ(source_buffer->Line(3), "");
+    EXPECT_EQ(source_buffer->Line(4), "d");
+    EXPECT_EQ(source_buffer->Line(0), "");
+    EXPECT_EQ(source_buffer->Line(5), "");
+    EXPECT_FALSE(source_buffer->IsStale());
+}
+
+TEST(SourceManagerTests, LoadFile) {
+    auto file_path = std::filesystem::temp_directory_path() / "prajna_source_manager_test.prajna";
+    auto write_file = [=](std::string code) {
+        std::ofstream ofs(file_path, std::ios::binary | std::ios::trunc);
+        ofs << code;
+    };
+    auto source_manager = SourceManager::Create();
+
+    write_file("func A(){}\nfunc B(){}\n");
+    auto source_buffer = source_manager->LoadFile(file_path);
+    ASSERT_TRUE(source_buffer);
+    EXPECT_EQ(source_buffer->Code(), "func A(){}\nfunc B(){}\n");
+    EXPECT_EQ(source_buffer->Line(2), "func B(){}");
+    // 文件未被修改时复用同一份映射
+    EXPECT_EQ(source_manager->LoadFile(file_path), source_buffer);
+
+    // 文件被截断后重新读入, 而不是访问旧的映射
+    write_file("func C(){}");
+    EXPECT_TRUE(source_buffer->IsStale());
+    auto new_source_buffer = source_manager->LoadFile(file_path);
+    ASSERT_TRUE(new_source_buffer);
+    EXPECT_NE(new_source_buffer, source_buffer);
+    EXPECT_EQ(new_source_buffer->Code(), "func C(){}");
+
+    // 不再使用的映射会被释放, 之后重新映射
+    std::weak_ptr<SourceBuffer> weak_source_buffer = new_source_buffer;
+    source_buffer.reset();
+    new_source_buffer.reset();
+    EXPECT_TRUE(weak_source_buffer.expired());
+
+    write_file("");
+    auto empty_source_buffer = source_manager->LoadFile(file_path);
+    ASSERT_TRUE(empty_source_buffer);
+    EXPECT_EQ(empty_source_buffer->Code(), "");
+
+    std::filesystem::remove(file_path);
+    EXPECT_TRUE(empty_source_buffer->IsStale());
+    EXPECT_FALSE(source_manager->LoadFile(file_path));
+}
+
+TEST(SymbolTableTests, GetByPathCache) {
+    auto ir_bool = ir::BoolType::Create();
+    auto ir_f32 = ir::FloatType::Create(32);
+    auto ir_f64 = ir::FloatType::Create(64);
+
+    auto root_symbol_table = lowering::SymbolTable::Create(nullptr);
+    auto tensor_symbol_table = lowering::SymbolTable::Create(root_symbol_table);
+    root_symbol_table->Set(tensor_symbol_table, "tensor");
+    tensor_symbol_table->Set(ir_bool, "Layout");
+    auto local_symbol_table = lowering::SymbolTable::Create(root_symbol_table);
+
+    auto get_layout = [=]() {
+        return lowering::SymbolGet<ir::Type>(local_symbol_table->GetByPath({"tensor", "Layout"}));
+    };
+    EXPECT_EQ(get_layout(), ir_bool);
+    EXPECT_EQ(get_layout(), ir_bool);
+    EXPECT_TRUE(std::holds_alternative<std::nullptr_t>(
+        local_symbol_table->GetByPath({"tensor", "Shape"})));
+    EXPECT_TRUE(std::holds_alternative<std::nullptr_t>(
+        local_symbol_table->GetByPath({"Layout", "tensor"})));
+
+    // 修改路径上的子符号表
+    tensor_symbol_table->Set(ir_f32, "Layout");
+    EXPECT_EQ(get_layout(), ir_f32);
+
+    // 修改无关的符号表不影响结果
+    root_symbol_table->Set(ir_f64, "Other");
+    EXPECT_EQ(get_layout(), ir_f32);
+
+    // 更近的符号表遮蔽了上层的同名符号
+    auto shadow_symbol_table = lowering::SymbolTable::Create(root_symbol_table);
+    shadow_symbol_table->Set(ir_f64, "Layout");
+    local_symbol_table->Set(shadow_symbol_table, "tensor");
+    EXPECT_EQ(get_layout(), ir_f64);
+
+    local_symbol_table->Remove("tensor");
+    EXPECT_EQ(get_layout(), ir_f32);
+
+    root_symbol_table->Remove("tensor");
+    EXPECT_FALSE(get_layout());
+}
+
+/// @brief 按结构比较函数体, 函数里的参数, 块和指令按出现的顺序一一对应
+inline void ExpectSameFunctionBody(std::shared_ptr<ir::Function> ir_function,
+                                   std::shared_ptr<ir::Function> ir_loaded_function) {
+    ASSERT_EQ(ir_function->parameters.size(), ir_loaded_function->parameters.size());
+    ASSERT_EQ(ir_function->blocks.size(), ir_loaded_function->blocks.size());
+    std::unordered_map<std::shared_ptr<ir::Value>, std::shared_ptr<ir::Value>> loaded_value_dict;
+    auto iter_loaded_parameter = ir_loaded_function->parameters.begin();
+    for (auto ir_parameter : ir_function->parameters) {
+        loaded_value_dict[ir_parameter] = *iter_loaded_parameter++;
+    }
+    std::list<std::pair<std::shared_ptr<ir::Value>, std::shared_ptr<ir::Value>>> value_pairs;
+    auto iter_loaded_block = ir_loaded_function->blocks.begin();
+    for (auto ir_block : ir_function->blocks) {
+        auto ir_loaded_block = *iter_loaded_block++;
+        loaded_value_dict[ir_block] = ir_loaded_block;
+        ASSERT_EQ(ir_block->size(), ir_loaded_block->size());
+        auto iter_loaded_value = ir_loaded_block->begin();
+        for (auto ir_value : *ir_block) {
+            loaded_value_dict[ir_value] = *iter_loaded_value;
+            value_pairs.push_back({ir_value, *iter_loaded_value++});
+        }
+    }
+
+    for (auto [ir_value, ir_loaded_value] : value_pairs) {
+        EXPECT_STREQ(ir_value->tag, ir_loaded_value->tag);
+        EXPECT_EQ(ir_value->type, ir_loaded_value->type);
+        EXPECT_EQ(ir_value->annotation_dict, ir_loaded_value->annotation_dict);
+        auto ir_instruction = Cast<ir::Instruction>(ir_value);
+        if (!ir_instruction) continue;
+        auto ir_loaded_instruction = Cast<ir::Instruction>(ir_loaded_value);
+        ASSERT_TRUE(ir_loaded_instruction);
+        ASSERT_EQ(ir_instruction->OperandSize(), ir_loaded_instruction->OperandSize());
+        for (int64_t i = 0; i < ir_instruction->OperandSize(); ++i) {
+            auto ir_operand = ir_instruction->GetOperand(i);
+            auto ir_loaded_operand = ir_loaded_instruction->GetOperand(i);
+            if (loaded_value_dict.count(ir_operand)) {
+                EXPECT_EQ(loaded_value_dict[ir_operand], ir_loaded_operand);
+            } else {
+                // 全局变量和函数属于不同的模块, 按名字比较; 内联的常量按类型比较
+                EXPECT_STREQ(ir_operand->tag, ir_loaded_operand->tag);
+                EXPECT_EQ(ir_operand->type, ir_loaded_operand->type);
+                EXPECT_EQ(ir_operand->Fullname(), ir_loaded_operand->Fullname());
+            }
+        }
+    }
+}
+
+TEST(BinaryIRTests, RoundTrip) {
+    auto compiler = Compiler::Create();
+    compiler->CompileBuiltinSourceFiles("builtin_packages");
+
+    auto ir_module = compiler->CompileCode(
+        "template <T>\n"
+        "func Identity(value: T)->T { return value; }\n"
+        "interface Number { func Value()->i64; }\n"
+        "struct Seven {}\n"
+        "implement Number for Seven { func Value()->i64 { return 7; } }\n"
+        "func Sum(n: i64)->i64 {\n"
+        "    var sum = 0;\n"
+        "    for i in 0 to n {\n"
+        "        if (i % 2 == 0) { sum = sum + Identity<i64>(i); }\n"
+        "    }\n"
+        "    var number: Dynamic<Number> = Ptr<Seven>::New().As<Number>();\n"
+        "    return sum + number.Value();\n"
+        "}\n",
+        compiler->_symbol_table, "binary_ir_test", false);
+    ASSERT_TRUE(ir_module);
+
+    auto file_path = std::filesystem::temp_directory_path() / "prajna_binary_ir_test.prir";
+    ir::SaveBinaryIR(ir_module, file_path);
+    auto reader = ir::OpenBinaryIR(file_path);
+    std::filesystem::remove(file_path);
+    auto ir_loaded_module = reader->ReadModule();
+    EXPECT_EQ(ir_loaded_module->Fullname(), ir_module->Fullname());
+
+    // 类型, 函数签名及标注直接读出, 函数体按需加载
+    ASSERT_EQ(ir_loaded_module->functions.size(), ir_module->functions.size());
+    int64_t template_instance_count = 0;
+    auto iter_loaded_function = ir_loaded_module->functions.begin();
+    for (auto ir_function : ir_module->functions) {
+        auto ir_loaded_function = *iter_loaded_function++;
+        EXPECT_EQ(ir_loaded_function->Fullname(), ir_function->Fullname());
+        EXPECT_EQ(ir_loaded_function->function_type, ir_function->function_type);
+        EXPECT_EQ(ir_loaded_function->annotation_dict, ir_function->annotation_dict);
+        EXPECT_TRUE(ir_loaded_function->blocks.empty());
+        EXPECT_EQ(reader->IsLoaded(ir_loaded_function), ir_function->blocks.empty());
+
+        auto iter_template_instance = ir_function->annotation_dict.find("template_instance");
+        if (iter_template_instance != ir_function->annotation_dict.end()) {
+            ++template_instance_count;
+            auto ir_instance_functions =
+                reader->GetTemplateInstanceFunctions(iter_template_instance->second);
+            EXPECT_EQ(std::ranges::count(ir_instance_functions, ir_loaded_function), 1)
+                << ir_function->Fullname();
+        }
+
+        reader->LoadFunction(ir_loaded_function);
+        EXPECT_TRUE(reader->IsLoaded(ir_loaded_function));
+        ExpectSameFunctionBody(ir_function, ir_loaded_function);
+    }
+    EXPECT_GT(template_instance_count, 0);
+
+    // 虚表的初始值引用的函数
+    ASSERT_EQ(ir_loaded_module->global_allocas.size(), ir_module->global_allocas.size());
+    int64_t vtable_count = 0;
+    auto iter_loaded_global_alloca = ir_loaded_module->global_allocas.begin();
+    for (auto ir_global_alloca : ir_module->global_allocas) {
+        auto ir_loaded_global_alloca = *iter_loaded_global_alloca++;
+        EXPECT_EQ(ir_loaded_global_alloca->Fullname(), ir_global_alloca->Fullname());
+        EXPECT_EQ(ir_loaded_global_alloca->type, ir_global_alloca->type);
+        ASSERT_EQ(ir_loaded_global_alloca->initialize_functions.size(),
+                  ir_global_alloca->initialize_functions.size());
+        if (!ir_global_alloca->initialize_functions.empty()) ++vtable_count;
+        auto iter_loaded_initialize_function =
+            ir_loaded_global_alloca->initialize_functions.begin();
+        for (auto ir_initialize_function : ir_global_alloca->initialize_functions) {
+            EXPECT_EQ((*iter_loaded_initialize_function++)->Fullname(),
+                      ir_initialize_function->Fullname());
+        }
+    }
+    EXPECT_GT(vtable_count, 0);
+}
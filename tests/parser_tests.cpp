@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "boost/fusion/include/for_each.hpp"
+#include "boost/fusion/include/is_sequence.hpp"
+#include "gtest/gtest.h"
+#include "prajna/ast/ast.hpp"
+#include "prajna/exception.hpp"
+#include "prajna/logger.hpp"
+#include "prajna/parser/parse.h"
+
+using namespace prajna;
+
+/// @brief 将ast打印为文本, 只比较叶子节点的位置, 组合节点的位置由其叶子决定
+class AstDumper {
+   public:
+    std::string str() const { return _ss.str(); }
+
+    void operator()(const ast::Blank&) { _ss << "Blank"; }
+
+    void operator()(const ast::Break&) { _ss << "Break"; }
+
+    void operator()(const ast::Continue&) { _ss << "Continue"; }
+
+    void operator()(const ast::Identifier& ast_identifier) {
+        _ss << "Identifier(" << static_cast<const std::string&>(ast_identifier);
+        this->DumpLocation(ast_identifier);
+    }
+
+    void operator()(const ast::Operator& ast_operator) {
+        _ss << "Operator(" << ast_operator.string_token;
+        this->DumpLocation(ast_operator);
+    }
+
+    void operator()(const ast::BoolLiteral& ast_bool_literal) {
+        _ss << "BoolLiteral(" << ast_bool_literal.value;
+        this->DumpLocation(ast_bool_literal);
+    }
+
+    void operator()(const ast::IntLiteral& ast_int_literal) {
+        _ss << "IntLiteral(" << ast_int_literal.value;
+        this->DumpLocation(ast_int_literal);
+    }
+
+    void operator()(const ast::FloatLiteral& ast_float_literal) {
+        _ss << "FloatLiteral(" << fmt::format("{}", ast_float_literal.value);
+        this->DumpLocation(ast_float_literal);
+    }
+
+    void operator()(const ast::CharLiteral& ast_char_literal) {
+        _ss << "CharLiteral(" << static_cast<int>(ast_char_literal.value);
+        this->DumpLocation(ast_char_literal);
+    }
+
+    void operator()(const ast::StringLiteral& ast_string_literal) {
+        _ss << "StringLiteral(" << ast_string_literal.value;
+        this->DumpLocation(ast_string_literal);
+    }
+
+    void operator()(const ast::Operand& ast_operand) { this->DumpVariant(ast_operand); }
+
+    void operator()(const ast::Statement& ast_statement) { this->DumpVariant(ast_statement); }
+
+    void operator()(const ast::TemplateArgument& ast_template_argument) {
+        this->DumpVariant(ast_template_argument);
+    }
+
+    void operator()(const ast::TemplateAbleStatement& ast_templateable_statement) {
+        this->DumpVariant(ast_templateable_statement);
+    }
+
+    template <typename T>
+    void operator()(const boost::recursive_wrapper<T>& ast_wrapper) {
+        (*this)(ast_wrapper.get());
+    }
+
+    template <typename T>
+    void operator()(const boost::optional<T>& ast_optional) {
+        if (ast_optional) {
+            (*this)(*ast_optional);
+        } else {
+            _ss << "none";
+        }
+    }
+
+    template <typename T>
+    void operator()(const std::list<T>& ast_list) {
+        _ss << "[";
+        for (auto& ast_element : ast_list) {
+            (*this)(ast_element);
+            _ss << ",";
+        }
+        _ss << "]";
+    }
+
+    template <typename T>
+        requires boost::fusion::traits::is_sequence<T>::value
+    void operator()(const T& ast_node) {
+        _ss << "{";
+        boost::fusion::for_each(ast_node, [this](const auto& ast_field) {
+            (*this)(ast_field);
+            _ss << ";";
+        });
+        _ss << "}";
+    }
+
+   private:
+    template <typename Variant>
+    void DumpVariant(const Variant& ast_variant) {
+        _ss << ast_variant.which() << ":";
+        boost::apply_visitor([this](const auto& ast_node) { (*this)(ast_node); }, ast_variant);
+    }
+
+    void DumpLocation(const ast::SourceLocation& ast_source_location) {
+        _ss << "@" << ast_source_location.first_position.line << ":"
+            << ast_source_location.first_position.column << "-"
+            << ast_source_location.last_position.line << ":"
+            << ast_source_location.last_position.column << ")";
+    }
+
+    std::stringstream _ss;
+};
+
+inline std::string DumpAst(const ast::Statements& ast) {
+    AstDumper dumper;
+    dumper(ast);
+    return dumper.str();
+}
+
+inline std::vector<std::string> getPrajnaFiles(std::vector<std::string> dirs) {
+    std::vector<std::string> files;
+    for (auto dir : dirs) {
+        for (const auto& file : std::filesystem::recursive_directory_iterator(dir)) {
+            if (file.path().extension() != ".prajna") continue;
+            files.push_back(file.path().string());
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+struct PrintFileName {
+    template <class ParamType>
+    std::string operator()(const testing::TestParamInfo<ParamType>& info) const {
+        auto name = std::filesystem::path(info.param).replace_extension("").string();
+        std::replace_if(
+            name.begin(), name.end(), [](char c) { return !std::isalnum(c); }, '_');
+        return name;
+    }
+};
+
+class ParserTests : public testing::TestWithParam<std::string> {};
+TEST_P(ParserTests, RecursiveDescentMatchesQi) {
+    std::string file_name = GetParam();
+    std::ifstream ifs(file_name);
+    std::string code((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    auto logger = Logger::Create(code);
+
+    ast::Statements qi_ast;
+    try {
+        ASSERT_TRUE(parser::parse(code, qi_ast, file_name, logger, parser::ParserKind::qi));
+    } catch (CompileError) {
+        ast::Statements recursive_descent_ast;
+        EXPECT_THROW(parser::parse(code, recursive_descent_ast, file_name, logger,
+                                   parser::ParserKind::recursive_descent),
+                     CompileError);
+        return;
+    }
+
+    ast::Statements recursive_descent_ast;
+    ASSERT_TRUE(parser::parse(code, recursive_descent_ast, file_name, logger,
+                              parser::ParserKind::recursive_descent));
+    EXPECT_EQ(DumpAst(qi_ast), DumpAst(recursive_descent_ast));
+}
+
+INSTANTIATE_TEST_SUITE_P(ParserTestsInstance, ParserTests,
+                         testing::ValuesIn(getPrajnaFiles({"tests/prajna_sources",
+                                                           "builtin_packages"})),
+                         PrintFileName());
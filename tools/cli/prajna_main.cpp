@@ -10,17 +10,40 @@
 #include "fmt/format.h"
 #include "nlohmann/json.hpp"
 #include "prajna/compiler/compiler.h"
+#include "prajna/global_config.hpp"
 #include "prajna/helper.hpp"
 #include "repl/repl.h"
 
+void AddTransformOptions(cxxopts::Options& options) {
+    options.add_options()("print-after", "print the IR after the passes, comma separated or all",
+                          cxxopts::value<std::string>())(
+        "time-passes", "print the time spent in each transform pass")(
+        "parser", "the parser to use, qi or recursive_descent", cxxopts::value<std::string>());
+}
+
+void ApplyTransformOptions(const cxxopts::ParseResult& result) {
+    if (result.count("print-after")) {
+        prajna::GlobalConfig::Instance().put("prajna.print_after",
+                                             result["print-after"].as<std::string>());
+    }
+    if (result.count("time-passes")) {
+        prajna::GlobalConfig::Instance().put("prajna.time_passes", true);
+    }
+    if (result.count("parser")) {
+        prajna::GlobalConfig::Instance().put("prajna.parser", result["parser"].as<std::string>());
+    }
+}
+
 int prajna_exe_main(int argc, char* argv[]) {
     cxxopts::Options options("prajna exe");
     options.allow_unrecognised_options().positional_help("program").custom_help("[options]");
     options.add_options()("h,help", "prajna exe help")("program", "program file",
                                                        cxxopts::value<std::string>())(
         "without_builtin_lib", "without builtin lib", cxxopts::value<std::string>());
+    AddTransformOptions(options);
     options.parse_positional({"program"});
     auto result = options.parse(argc, argv);
+    ApplyTransformOptions(result);
 
     if (result.count("program")) {
         auto compiler = prajna::Compiler::Create();
@@ -118,7 +141,9 @@ int main(int argc, char* argv[]) {
                 .allow_unrecognised_options()
                 .positional_help("subcommand");
             options.add_options()("h,help", "prajna repl help");
+            AddTransformOptions(options);
             auto result = options.parse(sub_argc, sub_argv.data());
+            ApplyTransformOptions(result);
 
             return prajna_repl_main(sub_argc, sub_argv.data());
         }
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "cxxopts.hpp"
+#include "fmt/format.h"
+#include "prajna/exception.hpp"
+#include "prajna/logger.hpp"
+#include "prajna/parser/parse.h"
+
+struct SourceFile {
+    std::string name;
+    std::string code;
+    int64_t line_count;
+};
+
+std::vector<SourceFile> LoadSourceFiles(std::vector<std::string> paths) {
+    std::vector<std::string> file_names;
+    for (auto path : paths) {
+        if (std::filesystem::is_directory(path)) {
+            for (const auto& file : std::filesystem::recursive_directory_iterator(path)) {
+                if (file.path().extension() != ".prajna") continue;
+                file_names.push_back(file.path().string());
+            }
+        } else {
+            file_names.push_back(path);
+        }
+    }
+    std::sort(file_names.begin(), file_names.end());
+
+    std::vector<SourceFile> source_files;
+    for (auto file_name : file_names) {
+        std::ifstream ifs(file_name);
+        std::string code((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+        auto line_count = std::count(code.begin(), code.end(), '\n') + 1;
+        source_files.push_back({file_name, std::move(code), line_count});
+    }
+    return source_files;
+}
+
+/// @brief 返回每秒解析的行数, 解析失败的文件不计入
+double Benchmark(const std::vector<SourceFile>& source_files, prajna::parser::ParserKind parser_kind,
+                 int64_t repeat) {
+    int64_t line_count = 0;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (int64_t i = 0; i < repeat; ++i) {
+        for (auto& source_file : source_files) {
+            auto logger = prajna::Logger::Create(source_file.code);
+            prajna::ast::Statements ast;
+            try {
+                prajna::parser::parse(source_file.code, ast, source_file.name, logger,
+                                      parser_kind);
+            } catch (prajna::CompileError) {
+                continue;
+            }
+            line_count += source_file.line_count;
+        }
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = t1 - t0;
+    return line_count / duration.count();
+}
+
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("prajna_parser_benchmark", "measure the parse throughput");
+    options.positional_help("paths").custom_help("[options]");
+    options.add_options()("h,help", "prajna parser benchmark help")(
+        "paths", "source files or directories",
+        cxxopts::value<std::vector<std::string>>()->default_value("builtin_packages"))(
+        "repeat", "parse all sources repeat times",
+        cxxopts::value<int64_t>()->default_value("10"))(
+        "parser", "the parser to benchmark, qi, recursive_descent or all",
+        cxxopts::value<std::string>()->default_value("all"));
+    options.parse_positional({"paths"});
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    auto source_files = LoadSourceFiles(result["paths"].as<std::vector<std::string>>());
+    int64_t total_line_count = 0;
+    for (auto& source_file : source_files) {
+        total_line_count += source_file.line_count;
+    }
+    fmt::print("{} files, {} lines\n", source_files.size(), total_line_count);
+
+    auto repeat = result["repeat"].as<int64_t>();
+    auto parser = result["parser"].as<std::string>();
+    if (parser == "all" || parser == "qi") {
+        fmt::print("qi: {:.0f} lines/s\n",
+                   Benchmark(source_files, prajna::parser::ParserKind::qi, repeat));
+    }
+    if (parser == "all" || parser == "recursive_descent") {
+        fmt::print("recursive_descent: {:.0f} lines/s\n",
+                   Benchmark(source_files, prajna::parser::ParserKind::recursive_descent,
+                             repeat));
+    }
+
+    return 0;
+}